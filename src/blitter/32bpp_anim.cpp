@@ -24,6 +24,69 @@ static FBlitter_32bppAnim iFBlitter_32bppAnim;
 Blitter_32bppAnim::~Blitter_32bppAnim()
 {
 	free(this->anim_buf);
+	free(this->anim_spans);
+}
+
+/**
+ * Mark an area of the screen as possibly containing palette animated pixels.
+ * @param video Pointer to the top left pixel of the area on the screen.
+ * @param width Width of the area.
+ * @param height Height of the area.
+ */
+void Blitter_32bppAnim::MarkAnimated(const void *video, int width, int height)
+{
+	if (width <= 0 || height <= 0 || this->anim_spans == nullptr) return;
+
+	const int offset = this->ScreenToAnimOffset((const uint32 *)video);
+	const int left = max(offset % this->anim_buf_pitch, 0);
+	const int top = max(offset / this->anim_buf_pitch, 0);
+	const int right = min(offset % this->anim_buf_pitch + width, this->anim_buf_width);
+	const int bottom = min(offset / this->anim_buf_pitch + height, this->anim_buf_height);
+	if (left >= right || top >= bottom) return;
+
+	for (int y = top; y < bottom; y++) {
+		AnimSpan &span = this->anim_spans[y];
+		span.left = min(span.left, left);
+		span.right = max(span.right, right);
+	}
+	this->anim_span_top = min(this->anim_span_top, top);
+	this->anim_span_bottom = max(this->anim_span_bottom, bottom);
+}
+
+/**
+ * Mark the area a sprite is about to be drawn to as possibly containing palette animated pixels.
+ * @param bp The parameters the sprite will be drawn with.
+ * @param mode The mode the sprite will be drawn with.
+ * @param sprite_flags The flags of the sprite.
+ */
+void Blitter_32bppAnim::MarkSpriteAnimated(const Blitter::BlitterParams *bp, BlitterMode mode, BlitterSpriteFlags sprite_flags)
+{
+	switch (mode) {
+		case BM_TRANSPARENT:
+		case BM_BLACK_REMAP:
+			/* These only ever clear the animation buffer. */
+			return;
+
+		case BM_NORMAL:
+			if (sprite_flags & SF_NO_ANIM) return;
+			break;
+
+		default:
+			break;
+	}
+
+	this->MarkAnimated((const uint32 *)bp->dst + bp->top * bp->pitch + bp->left, bp->width, bp->height);
+}
+
+/** Mark all lines of the animation buffer as not containing any palette animated pixels. */
+void Blitter_32bppAnim::ResetAnimSpans()
+{
+	for (int y = 0; y < this->anim_buf_height; y++) {
+		this->anim_spans[y].left = this->anim_buf_width;
+		this->anim_spans[y].right = 0;
+	}
+	this->anim_span_top = this->anim_buf_height;
+	this->anim_span_bottom = 0;
 }
 
 template <BlitterMode mode, bool fast_path>
@@ -284,6 +347,7 @@ void Blitter_32bppAnim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomL
 	}
 
 	const BlitterSpriteFlags sprite_flags = ((const SpriteData *)bp->sprite)->flags;
+	this->MarkSpriteAnimated(bp, mode, sprite_flags);
 
 	switch (mode) {
 		default: NOT_REACHED();
@@ -360,8 +424,9 @@ void Blitter_32bppAnim::SetPixel(void *video, int x, int y, uint8 colour)
 	if (_screen_disable_anim) return;
 	assert(_screen.pitch == this->anim_buf_pitch); // precondition for translating 'video' into an 'anim_buf' offset below.
 	this->anim_buf[((uint32 *)video - (uint32 *)_screen.dst_ptr) + x + y * this->anim_buf_pitch] = colour | (DEFAULT_BRIGHTNESS << 8);
+	if (colour >= PALETTE_ANIM_START) this->MarkAnimated((uint32 *)video + x + y * _screen.pitch, 1, 1);
 }
- 
+
 void Blitter_32bppAnim::DrawLine(void *video, int x, int y, int x2, int y2, int screen_width, int screen_height, uint8 colour, int width, int dash)
 {
 	const Colour c = LookupColourInPalette(colour);
@@ -373,6 +438,14 @@ void Blitter_32bppAnim::DrawLine(void *video, int x, int y, int x2, int y2, int
 	} else {
 		uint16 * const offset_anim_buf = this->anim_buf + this->ScreenToAnimOffset((uint32 *)video);
 		const uint16 anim_colour = colour | (DEFAULT_BRIGHTNESS << 8);
+		if (colour >= PALETTE_ANIM_START) {
+			/* Thick lines extend up to width pixels beyond their end points. */
+			const int left = Clamp(min(x, x2) - width, 0, screen_width);
+			const int right = Clamp(max(x, x2) + width + 1, 0, screen_width);
+			const int top = Clamp(min(y, y2) - width, 0, screen_height);
+			const int bottom = Clamp(max(y, y2) + width + 1, 0, screen_height);
+			this->MarkAnimated((uint32 *)video + left + top * _screen.pitch, right - left, bottom - top);
+		}
 		this->DrawLineGeneric(x, y, x2, y2, screen_width, screen_height, width, dash, [&](int x, int y) {
 			*((Colour *)video + x + y * _screen.pitch) = c;
 			offset_anim_buf[x + y * this->anim_buf_pitch] = anim_colour;
@@ -393,6 +466,7 @@ void Blitter_32bppAnim::SetLine(void *video, int x, int y, uint8 *colours, uint
 	}
 	else {
 		uint16 *dstanim = (uint16 *)(&this->anim_buf[(uint32 *)video - (uint32 *)_screen.dst_ptr + x + y * _screen.pitch]);
+		this->MarkAnimated(dst, width, 1);
 		do {
 			*dstanim = *colours | (DEFAULT_BRIGHTNESS << 8);
 			*dst = LookupColourInPalette(*colours);
@@ -438,6 +512,7 @@ void Blitter_32bppAnim::DrawRect(void *video, int width, int height, uint8 colou
 	Colour colour32 = LookupColourInPalette(colour);
 	assert(_screen.pitch == this->anim_buf_pitch); // precondition for translating 'video' into an 'anim_buf' offset below.
 	uint16 *anim_line = ((uint32 *)video - (uint32 *)_screen.dst_ptr) + this->anim_buf;
+	if (colour >= PALETTE_ANIM_START) this->MarkAnimated(video, width, height);
 
 	do {
 		Colour *dst = (Colour *)video;
@@ -463,6 +538,7 @@ void Blitter_32bppAnim::CopyFromBuffer(void *video, const void *src, int width,
 	const uint32 *usrc = (const uint32 *)src;
 	assert(_screen.pitch == this->anim_buf_pitch); // precondition for translating 'video' into an 'anim_buf' offset below.
 	uint16 *anim_line = ((uint32 *)video - (uint32 *)_screen.dst_ptr) + this->anim_buf;
+	this->MarkAnimated(video, width, height);
 
 	for (; height > 0; height--) {
 		/* We need to keep those for palette animation. */
@@ -525,6 +601,9 @@ void Blitter_32bppAnim::ScrollBuffer(void *video, int &left, int &top, int &widt
 	assert(video >= _screen.dst_ptr && video <= (uint32 *)_screen.dst_ptr + _screen.width + _screen.height * _screen.pitch);
 	uint16 *dst, *src;
 
+	/* Animated pixels can move anywhere within the scrolled area. */
+	this->MarkAnimated((uint32 *)_screen.dst_ptr + left + top * _screen.pitch, width, height);
+
 	/* We need to scroll the anim-buffer too */
 	if (scroll_y > 0) {
 		dst = this->anim_buf + left + (top + height - 1) * this->anim_buf_pitch;
@@ -575,6 +654,31 @@ int Blitter_32bppAnim::BufferSize(int width, int height)
 	return width * height * (sizeof(uint32) + sizeof(uint16));
 }
 
+/**
+ * Update the palette animated pixels within a span of a single line.
+ * @param dst First pixel of the span on the screen.
+ * @param anim First pixel of the span in the animation buffer.
+ * @param width Number of pixels in the span.
+ * @param[out] first Offset of the first palette animated pixel within the span.
+ * @param[out] last Offset one past the last palette animated pixel within the span.
+ * @return Whether the span contains any palette animated pixels.
+ */
+bool Blitter_32bppAnim::PaletteAnimateSpan(Colour *dst, const uint16 *anim, int width, int &first, int &last)
+{
+	first = width;
+	last = 0;
+	for (int x = 0; x < width; x++) {
+		uint colour = GB(anim[x], 0, 8);
+		if (colour >= PALETTE_ANIM_START) {
+			/* Update this pixel */
+			dst[x] = this->AdjustBrightness(LookupColourInPalette(colour), GB(anim[x], 8, 8));
+			first = min(first, x);
+			last = x + 1;
+		}
+	}
+	return first < last;
+}
+
 void Blitter_32bppAnim::PaletteAnimate(const Palette &palette)
 {
 	assert(!_screen_disable_anim);
@@ -585,26 +689,34 @@ void Blitter_32bppAnim::PaletteAnimate(const Palette &palette)
 	 *  Especially when going between toyland and non-toyland. */
 	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
 
-	const uint16 *anim = this->anim_buf;
-	Colour *dst = (Colour *)_screen.dst_ptr;
-
-	/* Let's walk the anim buffer and try to find the pixels */
-	for (int y = this->anim_buf_height; y != 0 ; y--) {
-		for (int x = this->anim_buf_width; x != 0 ; x--) {
-			uint colour = GB(*anim, 0, 8);
-			if (colour >= PALETTE_ANIM_START) {
-				/* Update this pixel */
-				*dst = this->AdjustBrightness(LookupColourInPalette(colour), GB(*anim, 8, 8));
-			}
-			dst++;
-			anim++;
+	/* Only walk the spans that may hold animated pixels, and shrink them
+	 * to the animated pixels that are actually there while doing so. */
+	int dirty_left = this->anim_buf_width;
+	int dirty_right = 0;
+	int top = this->anim_buf_height;
+	int bottom = 0;
+	for (int y = this->anim_span_top; y < this->anim_span_bottom; y++) {
+		AnimSpan &span = this->anim_spans[y];
+		if (span.left >= span.right) continue;
+
+		int first, last;
+		if (this->PaletteAnimateSpan((Colour *)_screen.dst_ptr + y * _screen.pitch + span.left, this->anim_buf + y * this->anim_buf_pitch + span.left, span.right - span.left, first, last)) {
+			span.right = span.left + last;
+			span.left += first;
+			dirty_left = min(dirty_left, span.left);
+			dirty_right = max(dirty_right, span.right);
+			top = min(top, y);
+			bottom = y + 1;
+		} else {
+			span.left = this->anim_buf_width;
+			span.right = 0;
 		}
-		dst += _screen.pitch - this->anim_buf_width;
-		anim += this->anim_buf_pitch - this->anim_buf_width;
 	}
+	this->anim_span_top = top;
+	this->anim_span_bottom = bottom;
 
-	/* Make sure the backend redraws the whole screen */
-	VideoDriver::GetInstance()->MakeDirty(0, 0, _screen.width, _screen.height);
+	/* Make sure the backend redraws the animated part of the screen */
+	if (top < bottom) VideoDriver::GetInstance()->MakeDirty(dirty_left, top, dirty_right - dirty_left, bottom - top);
 }
 
 Blitter::PaletteAnimation Blitter_32bppAnim::UsePaletteAnimation()
@@ -618,9 +730,12 @@ void Blitter_32bppAnim::PostResize()
 			_screen.pitch != this->anim_buf_pitch) {
 		/* The size of the screen changed; we can assume we can wipe all data from our buffer */
 		free(this->anim_buf);
+		free(this->anim_spans);
 		this->anim_buf_width = _screen.width;
 		this->anim_buf_height = _screen.height;
 		this->anim_buf_pitch = _screen.pitch;
 		this->anim_buf = CallocT<uint16>(this->anim_buf_height * this->anim_buf_pitch);
+		this->anim_spans = MallocT<AnimSpan>(this->anim_buf_height);
+		this->ResetAnimSpans();
 	}
 }
@@ -17,18 +17,39 @@
 /** The optimised 32 bpp blitter with palette animation. */
 class Blitter_32bppAnim : public Blitter_32bppOptimized {
 protected:
-	uint16 *anim_buf;    ///< In this buffer we keep track of the 8bpp indexes so we can do palette animation
-	int anim_buf_width;  ///< The width of the animation buffer.
-	int anim_buf_height; ///< The height of the animation buffer.
-	int anim_buf_pitch;  ///< The pitch of the animation buffer.
-	Palette palette;     ///< The current palette.
+	/**
+	 * The columns of a line of the animation buffer that may contain palette animated pixels.
+	 * A span is empty when left >= right; empty spans are stored as [anim_buf_width, 0) so
+	 * they can be widened with plain min/max.
+	 */
+	struct AnimSpan {
+		int left;  ///< First column that may contain palette animated pixels.
+		int right; ///< One past the last column that may contain palette animated pixels.
+	};
+
+	uint16 *anim_buf;     ///< In this buffer we keep track of the 8bpp indexes so we can do palette animation
+	int anim_buf_width;   ///< The width of the animation buffer.
+	int anim_buf_height;  ///< The height of the animation buffer.
+	int anim_buf_pitch;   ///< The pitch of the animation buffer.
+	AnimSpan *anim_spans; ///< For each line of the animation buffer the span that may contain palette animated pixels.
+	int anim_span_top;    ///< First line that may contain palette animated pixels.
+	int anim_span_bottom; ///< One past the last line that may contain palette animated pixels.
+	Palette palette;      ///< The current palette.
+
+	void MarkAnimated(const void *video, int width, int height);
+	void MarkSpriteAnimated(const Blitter::BlitterParams *bp, BlitterMode mode, BlitterSpriteFlags sprite_flags);
+	void ResetAnimSpans();
+	virtual bool PaletteAnimateSpan(Colour *dst, const uint16 *anim, int width, int &first, int &last);
 
 public:
 	Blitter_32bppAnim() :
 		anim_buf(nullptr),
 		anim_buf_width(0),
 		anim_buf_height(0),
-		anim_buf_pitch(0)
+		anim_buf_pitch(0),
+		anim_spans(nullptr),
+		anim_span_top(0),
+		anim_span_bottom(0)
 	{
 		this->palette = _cur_palette;
 	}
@@ -60,7 +81,7 @@ public:
 	{
 		return this->palette.palette[index];
 	}
- 
+
 	inline int ScreenToAnimOffset(const uint32 *video)
 	{
 		int raw_offset = video - (const uint32 *)_screen.dst_ptr;
@@ -383,6 +383,7 @@ IGNORE_UNINITIALIZED_WARNING_STOP
 void Blitter_32bppSSE4_Anim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
 {
 	const BlitterSpriteFlags sprite_flags = ((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags;
+	if (!_screen_disable_anim) this->MarkSpriteAnimated(bp, mode, sprite_flags);
 	switch (mode) {
 	default: {
 	bm_normal:
@@ -208,7 +208,7 @@ bool StationCargoReroute::operator()(CargoPacket *cp)
 	/* Legal, as insert doesn't invalidate iterators in the MultiMap, however
 	 * this might insert the packet between range.first and range.second (which might be end())
 	 * This is why we check for GetKey above to avoid infinite loops. */
-	this->destination->packets.Insert(next, cp_new);
+	this->destination->InsertPacket(next, cp_new);
 	return cp_new == cp;
 }
 
@@ -16,8 +16,13 @@
 #include "economy_base.h"
 #include "cargoaction.h"
 #include "order_type.h"
+#include "vehicle_base.h"
+#include "cpu.h"
+#include "debug.h"
+#include "core/mem_func.hpp"
 
 #include <vector>
+#include <type_traits>
 
 #include "safeguards.h"
 
@@ -123,6 +128,12 @@ void CargoPacket::Reduce(uint count)
 	this->count -= count;
 }
 
+/**
+ * Generation of the merge keys of all cargo packets. Station cargo lists whose
+ * merge index was built for another generation have to rebuild it.
+ */
+static uint32 _station_cargo_merge_generation = 1;
+
 /**
  * Invalidates (sets source_id to INVALID_SOURCE) all cargo packets from given source.
  * @param src_type Type of source.
@@ -134,6 +145,9 @@ void CargoPacket::Reduce(uint count)
 	FOR_ALL_CARGOPACKETS(cp) {
 		if (cp->source_type == src_type && cp->source_id == src) cp->source_id = INVALID_SOURCE;
 	}
+
+	/* The merge keys of packets in stations have changed. */
+	if (++_station_cargo_merge_generation == 0) _station_cargo_merge_generation = 1;
 }
 
 /**
@@ -713,15 +727,71 @@ void StationCargoList::Append(CargoPacket *cp, StationID next)
 {
 	assert(cp != nullptr);
 	this->AddToCache(cp);
-
-	StationCargoPacketMap::List &list = this->packets[next];
-	for (StationCargoPacketMap::List::reverse_iterator it(list.rbegin());
-			it != list.rend(); it++) {
-		if (StationCargoList::TryMerge(*it, cp)) return;
+	this->ValidateMergeIndex();
+
+	StationCargoMergeKey key(cp, next);
+	MergeIndex::iterator found = this->merge_index->find(key);
+	if (found != this->merge_index->end()) {
+		/* The indexed packet is the newest mergeable one, which is the one
+		 * a backwards scan over the list would try first. */
+		if (StationCargoList::TryMerge(found->second, cp)) return;
+
+		/* It is full; older packets with the same key might still have room. */
+		StationCargoPacketMap::List &list = this->packets[next];
+		for (StationCargoPacketMap::List::reverse_iterator it(list.rbegin());
+				it != list.rend(); it++) {
+			if (StationCargoList::TryMerge(*it, cp)) return;
+		}
 	}
 
 	/* The packet could not be merged with another one */
-	list.push_back(cp);
+	this->InsertPacket(next, cp);
+}
+
+/**
+ * Create the merge key of a packet in a station.
+ * @param cp The packet.
+ * @param next Next hop the packet is waiting for.
+ */
+StationCargoMergeKey::StationCargoMergeKey(const CargoPacket *cp, StationID next) :
+		source_xy(cp->source_xy), next(next), source_id(cp->source_id),
+		days_in_transit(cp->days_in_transit), source_type(cp->source_type)
+{
+}
+
+/**
+ * Rebuild the merge index if packets were removed or changed in a way that
+ * could not be tracked. Afterwards it holds the newest packet for each merge
+ * key of each next hop.
+ */
+void StationCargoList::ValidateMergeIndex()
+{
+	if (this->merge_index_generation == _station_cargo_merge_generation) return;
+
+	if (this->merge_index == nullptr) {
+		this->merge_index.reset(new MergeIndex());
+	} else {
+		this->merge_index->clear();
+	}
+	for (StationCargoPacketMap::ConstMapIterator it(this->packets.begin()); it != this->packets.end(); ++it) {
+		for (StationCargoPacketMap::ConstListIterator list_it(it->second.begin()); list_it != it->second.end(); ++list_it) {
+			(*this->merge_index)[StationCargoMergeKey(*list_it, it->first)] = *list_it;
+		}
+	}
+	this->merge_index_generation = _station_cargo_merge_generation;
+}
+
+/**
+ * Add a packet to the end of a next hop's list without merging it, keeping the merge index up to date.
+ * @param next Next hop the packet is waiting for.
+ * @param cp Packet to add.
+ */
+void StationCargoList::InsertPacket(StationID next, CargoPacket *cp)
+{
+	this->packets.Insert(next, cp);
+	if (this->merge_index_generation == _station_cargo_merge_generation) {
+		(*this->merge_index)[StationCargoMergeKey(cp, next)] = cp;
+	}
 }
 
 /**
@@ -743,7 +813,15 @@ bool StationCargoList::ShiftCargo(Taction &action, StationID next)
 	for (Iterator it(range.first); it != range.second && it.GetKey() == next;) {
 		if (action.MaxMove() == 0) return false;
 		CargoPacket *cp = *it;
+		/* The action may merge the packet into another one and free it, so determine its key first. */
+		StationCargoMergeKey key(cp, next);
 		if (action(cp)) {
+			/* Packets are taken from the front, so if this is the newest packet
+			 * with its key it also is the only one left. */
+			if (this->merge_index_generation == _station_cargo_merge_generation) {
+				MergeIndex::iterator found = this->merge_index->find(key);
+				if (found != this->merge_index->end() && found->second == cp) this->merge_index->erase(found);
+			}
 			it = this->packets.erase(it);
 		} else {
 			return false;
@@ -795,6 +873,7 @@ uint StationCargoList::Truncate(uint max_move, StationCargoAmountMap *cargo_per_
 	uint moved = 0;
 	uint loop = 0;
 	bool do_count = cargo_per_source != nullptr;
+	this->InvalidateMergeIndex();
 	while (max_move > moved) {
 		for (Iterator it(this->packets.begin()); it != this->packets.end();) {
 			CargoPacket *cp = *it;
@@ -884,6 +963,204 @@ uint StationCargoList::Reroute(uint max_move, StationCargoList *dest, StationID
 	return this->ShiftCargo(StationCargoReroute(this, dest, max_move, avoid, avoid2, ge), avoid, false);
 }
 
+/*
+ *
+ * Packet compaction.
+ *
+ */
+
+/** Properties deciding whether two packets in a list could be merged. */
+struct CargoPacketMergeKey {
+	TileIndex source_xy;          ///< Source station's coordinates.
+	TileOrStationID loaded_at_xy; ///< Last loading place; only relevant in vehicles.
+	SourceID source_id;           ///< Index of the source.
+	byte days_in_transit;         ///< Days in transit.
+	SourceTypeByte source_type;   ///< Type of the source.
+
+	inline bool operator==(const CargoPacketMergeKey &other) const
+	{
+		return this->source_xy == other.source_xy && this->loaded_at_xy == other.loaded_at_xy && this->source_id == other.source_id &&
+				this->days_in_transit == other.days_in_transit && this->source_type == other.source_type;
+	}
+};
+
+/** Hash function for #CargoPacketMergeKey. */
+struct CargoPacketMergeKeyHash {
+	inline size_t operator()(const CargoPacketMergeKey &key) const
+	{
+		uint64 h = key.source_xy | (uint64)key.source_id << 32 | (uint64)key.days_in_transit << 48 | (uint64)key.source_type << 56;
+		h ^= (uint64)key.loaded_at_xy * 0x9E3779B97F4A7C15ULL;
+		return (size_t)(h ^ (h >> 29));
+	}
+};
+
+/**
+ * Merges compatible packets within cargo lists and moves packets to the lowest
+ * free pool indices, so the pool stays dense and packets that are used together
+ * are close to each other.
+ */
+class CargoPacketCompactor {
+	typedef std::unordered_map<CargoPacketMergeKey, CargoPacket *, CargoPacketMergeKeyHash> OpenPackets;
+
+	size_t free_index;  ///< No pool index below this one is free.
+	OpenPackets open;   ///< Per merge key the last packet kept in the current list.
+
+	/**
+	 * Move a packet to the lowest free pool index, if that is lower than its own.
+	 * @param cp Packet to move.
+	 * @return The packet at its new place.
+	 */
+	CargoPacket *Relocate(CargoPacket *cp)
+	{
+		while (this->free_index < _cargopacket_pool.first_unused && _cargopacket_pool.data[this->free_index] != nullptr) this->free_index++;
+		if (this->free_index >= cp->index || !CargoPacket::CanAllocateItem()) return cp;
+
+		CargoPacket *moved = new CargoPacket();
+		assert(moved->index == this->free_index);
+		moved->feeder_share = cp->feeder_share;
+		moved->count = cp->count;
+		moved->days_in_transit = cp->days_in_transit;
+		moved->source_type = cp->source_type;
+		moved->source_id = cp->source_id;
+		moved->source = cp->source;
+		moved->source_xy = cp->source_xy;
+		moved->loaded_at_xy = cp->loaded_at_xy;
+		delete cp;
+
+		this->stats.relocated++;
+		return moved;
+	}
+
+public:
+	CargoCompactionStats stats; ///< Statistics of this pass.
+
+	CargoPacketCompactor() : free_index(_cargopacket_pool.first_free)
+	{
+		MemSetT(&this->stats, 0);
+	}
+
+	/**
+	 * Compact a list of packets. Merging a packet into an earlier one keeps
+	 * the order of the remaining packets.
+	 * @tparam Tinst Cargo list the packets belong to; decides what can be merged.
+	 * @param list Packets to compact.
+	 * @param merge Whether packets may be merged, or only be relocated.
+	 */
+	template <class Tinst>
+	void CompactList(CargoPacketList &list, bool merge)
+	{
+		this->open.clear();
+		CargoPacketList::iterator out = list.begin();
+		for (CargoPacketList::iterator it = list.begin(); it != list.end(); ++it) {
+			CargoPacket *cp = *it;
+			/* In stations the load place field holds the next hop, which isn't relevant for merging. */
+			CargoPacketMergeKey key = { cp->source_xy, std::is_same<Tinst, VehicleCargoList>::value ? cp->loaded_at_xy : 0,
+					cp->source_id, cp->days_in_transit, cp->source_type };
+			if (merge) {
+				OpenPackets::iterator found = this->open.find(key);
+				if (found != this->open.end() && Tinst::AreMergable(found->second, cp) &&
+						found->second->count + cp->count <= CargoPacket::MAX_COUNT) {
+					this->free_index = min<size_t>(this->free_index, cp->index);
+					found->second->Merge(cp);
+					this->stats.merged++;
+					continue;
+				}
+			}
+			cp = this->Relocate(cp);
+			*out++ = cp;
+			if (merge) this->open[key] = cp;
+		}
+		list.erase(out, list.end());
+	}
+};
+
+/**
+ * Merge and relocate the packets in this vehicle. Packets are only merged
+ * if none is designated for anything but staying in the vehicle, as otherwise
+ * the designated ranges would get mixed up.
+ * @param compactor Compaction pass.
+ */
+void VehicleCargoList::Compact(CargoPacketCompactor &compactor)
+{
+	compactor.CompactList<VehicleCargoList>(this->packets, this->action_counts[MTA_KEEP] == this->count);
+}
+
+/**
+ * Merge and relocate the packets waiting in this station.
+ * @param compactor Compaction pass.
+ */
+void StationCargoList::Compact(CargoPacketCompactor &compactor)
+{
+	for (StationCargoPacketMap::MapIterator it(this->packets.begin()); it != this->packets.end(); ++it) {
+		compactor.CompactList<StationCargoList>(it->second, true);
+	}
+	this->InvalidateMergeIndex();
+}
+
+/** Statistics of the last compaction pass. */
+static CargoCompactionStats _cargo_compaction_stats;
+
+/**
+ * Get the highest used index in the cargo packet pool plus one.
+ * @return The number of pool slots in use up to the last packet.
+ */
+static size_t GetCargoPacketPoolExtent()
+{
+	size_t extent = _cargopacket_pool.first_unused;
+	while (extent > 0 && _cargopacket_pool.data[extent - 1] == nullptr) extent--;
+	return extent;
+}
+
+/**
+ * Merge compatible packets in all vehicles and stations and move the packets
+ * to the front of the pool. This only changes how cargo is split into packets,
+ * not the amounts or where it is, and it is done in the same order everywhere.
+ */
+void CompactCargoPackets()
+{
+	const uint64 start = ottd_rdtsc();
+	CargoPacketCompactor compactor;
+	compactor.stats.packets_before = _cargopacket_pool.items;
+	compactor.stats.pool_size_before = GetCargoPacketPoolExtent();
+
+	Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		v->cargo.Compact(compactor);
+	}
+
+	Station *st;
+	FOR_ALL_STATIONS(st) {
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			st->goods[c].cargo.Compact(compactor);
+		}
+	}
+
+	compactor.stats.packets_after = _cargopacket_pool.items;
+	compactor.stats.pool_size_after = GetCargoPacketPoolExtent();
+	compactor.stats.passes = _cargo_compaction_stats.passes + 1;
+	compactor.stats.cycles = ottd_rdtsc() - start;
+	_cargo_compaction_stats = compactor.stats;
+
+	DEBUG(misc, 3, "Compacted cargo packets: " PRINTF_SIZE " -> " PRINTF_SIZE " packets, pool extent " PRINTF_SIZE " -> " PRINTF_SIZE,
+			_cargo_compaction_stats.packets_before, _cargo_compaction_stats.packets_after,
+			_cargo_compaction_stats.pool_size_before, _cargo_compaction_stats.pool_size_after);
+}
+
+/**
+ * Get the statistics of the last compaction pass.
+ * @return The statistics.
+ */
+const CargoCompactionStats &GetCargoCompactionStats()
+{
+	return _cargo_compaction_stats;
+}
+
+/** Compact the cargo packets every month. */
+void CargoPacketMonthlyLoop()
+{
+	CompactCargoPackets();
+}
+
 /*
  * We have to instantiate everything we want to be usable.
  */
@@ -20,6 +20,8 @@
 #include "vehicle_type.h"
 #include "core/multimap.hpp"
 #include <deque>
+#include <memory>
+#include <unordered_map>
 
 /** Unique identifier for a single cargo packet. */
 typedef uint32 CargoPacketID;
@@ -34,6 +36,7 @@ struct GoodsEntry; // forward-declare for Stage() and RerouteStalePackets()
 
 template <class Tinst, class Tcont> class CargoList;
 class StationCargoList; // forward-declare, so we can use it in VehicleCargoList.
+class CargoPacketCompactor;
 extern const struct SaveLoad *GetCargoPacketDesc();
 
 typedef uint32 TileOrStationID;
@@ -59,6 +62,8 @@ private:
 	template <class Tinst, class Tcont> friend class CargoList;
 	friend class VehicleCargoList;
 	friend class StationCargoList;
+	friend struct StationCargoMergeKey;
+	friend class CargoPacketCompactor;
 	/** We want this to be saved, right? */
 	friend const struct SaveLoad *GetCargoPacketDesc();
 public:
@@ -202,6 +207,21 @@ public:
 	static void AfterLoad();
 };
 
+/** Results of a pass merging and renumbering the cargo packets. */
+struct CargoCompactionStats {
+	uint passes;              ///< Number of passes done so far.
+	size_t packets_before;    ///< Number of packets before the last pass.
+	size_t packets_after;     ///< Number of packets after the last pass.
+	size_t pool_size_before;  ///< Highest used pool index plus one before the last pass.
+	size_t pool_size_after;   ///< Highest used pool index plus one after the last pass.
+	uint merged;              ///< Packets merged into other packets during the last pass.
+	uint relocated;           ///< Packets moved to a lower pool index during the last pass.
+	uint64 cycles;            ///< CPU cycles spent in the last pass.
+};
+
+void CompactCargoPackets();
+const CargoCompactionStats &GetCargoCompactionStats();
+
 /**
  * Iterate over all _valid_ cargo packets from the given start.
  * @param var   Variable used as "iterator".
@@ -422,6 +442,8 @@ public:
 
 	bool Stage(bool accepted, StationID current_station, StationIDStack next_station, uint8 order_flags, const GoodsEntry *ge, CargoPayment *payment);
 
+	void Compact(CargoPacketCompactor &compactor);
+
 	/**
 	 * Marks all cargo in the vehicle as to be kept. This is mostly useful for
 	 * loading old savegames. When loading is aborted the reserved cargo has
@@ -465,6 +487,33 @@ public:
 typedef MultiMap<StationID, CargoPacket *, CargoPacketList> StationCargoPacketMap;
 typedef std::map<StationID, uint> StationCargoAmountMap;
 
+/** Properties of a packet in a station that decide whether it can be merged with another one. */
+struct StationCargoMergeKey {
+	TileIndex source_xy;        ///< Source station's coordinates.
+	StationID next;             ///< Next hop the packet is waiting for.
+	SourceID source_id;         ///< Index of the source.
+	byte days_in_transit;       ///< Days in transit.
+	SourceTypeByte source_type; ///< Type of the source.
+
+	StationCargoMergeKey(const CargoPacket *cp, StationID next);
+
+	inline bool operator==(const StationCargoMergeKey &other) const
+	{
+		return this->source_xy == other.source_xy && this->next == other.next && this->source_id == other.source_id &&
+				this->days_in_transit == other.days_in_transit && this->source_type == other.source_type;
+	}
+};
+
+/** Hash function for #StationCargoMergeKey. */
+struct StationCargoMergeKeyHash {
+	inline size_t operator()(const StationCargoMergeKey &key) const
+	{
+		uint64 h = key.source_xy | (uint64)key.source_id << 32 | (uint64)key.days_in_transit << 48 | (uint64)key.source_type << 56;
+		h ^= (uint64)key.next * 0x9E3779B97F4A7C15ULL;
+		return (size_t)(h ^ (h >> 29));
+	}
+};
+
 /**
  * CargoList that is used for stations.
  */
@@ -473,7 +522,22 @@ protected:
 	/** The (direct) parent of this class. */
 	typedef CargoList<StationCargoList, StationCargoPacketMap> Parent;
 
-	uint reserved_count; ///< Amount of cargo being reserved for loading.
+	/** Newest packet with a given merge key in each next hop's list. */
+	typedef std::unordered_map<StationCargoMergeKey, CargoPacket *, StationCargoMergeKeyHash> MergeIndex;
+
+	uint reserved_count;           ///< Amount of cargo being reserved for loading.
+
+	std::unique_ptr<MergeIndex> merge_index; ///< Lookup for merging appended packets, so Append doesn't have to scan the list. Only allocated once cargo is appended.
+	uint32 merge_index_generation;           ///< Generation of the packet properties the merge index was built for, 0 if it has to be rebuilt.
+
+	void ValidateMergeIndex();
+	void InsertPacket(StationID next, CargoPacket *cp);
+
+	/** Mark the merge index as outdated, e.g. when packets were removed from the middle of a list. */
+	inline void InvalidateMergeIndex()
+	{
+		this->merge_index_generation = 0;
+	}
 
 public:
 	/** The super class ought to know what it's doing. */
@@ -489,6 +553,9 @@ public:
 	friend class CargoReturn;
 	friend class StationCargoReroute;
 
+	/** Create the cargo list. */
+	StationCargoList() : reserved_count(0), merge_index_generation(0) {}
+
 	static void InvalidateAllFrom(SourceType src_type, SourceID src);
 
 	template<class Taction>
@@ -560,6 +627,8 @@ public:
 	uint Truncate(uint max_move = UINT_MAX, StationCargoAmountMap *cargo_per_source = nullptr);
 	uint Reroute(uint max_move, StationCargoList *dest, StationID avoid, StationID avoid2, const GoodsEntry *ge);
 
+	void Compact(CargoPacketCompactor &compactor);
+
 	/**
 	 * Are two the two CargoPackets mergeable in the context of
 	 * a list of CargoPackets for a Vehicle?
@@ -27,6 +27,9 @@
 #include "string_func.h"
 #include "core/backup_type.hpp"
 #include "object_base.h"
+#include "command_trace.h"
+#include "event_log.h"
+#include "cpu.h"
 #include <array>
 
 #include "table/strings.h"
@@ -785,6 +788,20 @@ bool DoCommandP(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, CommandCallbac
 	command_log_next = (command_log_next + 1) % command_log.size();
 	command_log_count++;
 
+	if (!estimate_only && !only_sending) {
+		EVENT_LOG(res.Failed() ? ELE_CMD_FAILED : ELE_CMD_EXECUTED, cmd, tile, _current_company,
+				(uint32)min<uint64>(_last_command_cycles.test + _last_command_cycles.exec, UINT32_MAX));
+	}
+
+	if (IsCommandTraceActive()) {
+		CommandTraceFlags trace_flags = CTF_NONE;
+		if (res.Failed()) trace_flags |= CTF_FAILED;
+		if (estimate_only) trace_flags |= CTF_ESTIMATE_ONLY;
+		if (only_sending) trace_flags |= CTF_ONLY_SENDING;
+		if (my_cmd) trace_flags |= CTF_MY_CMD;
+		RecordCommandTrace(tile, p1, p2, cmd, text, binary_length, trace_flags);
+	}
+
 	return res.Succeeded();
 }
 
@@ -817,6 +834,8 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 
 	/* Reset the state. */
 	_additional_cash_required = 0;
+	_last_command_cycles.test = 0;
+	_last_command_cycles.exec = 0;
 
 	/* Get pointer to command handler */
 	byte cmd_id = cmd & CMD_ID_MASK;
@@ -859,7 +878,9 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	_cleared_object_areas.Clear();
 	SetTownRatingTestMode(true);
 	BasePersistentStorageArray::SwitchMode(PSM_ENTER_TESTMODE);
+	uint64 start = ottd_rdtsc();
 	CommandCost res = proc(tile, flags, p1, p2, text);
+	_last_command_cycles.test = ottd_rdtsc() - start;
 	BasePersistentStorageArray::SwitchMode(PSM_LEAVE_TESTMODE);
 	SetTownRatingTestMode(false);
 
@@ -904,7 +925,9 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	 * use the construction one */
 	_cleared_object_areas.Clear();
 	BasePersistentStorageArray::SwitchMode(PSM_ENTER_COMMAND);
+	start = ottd_rdtsc();
 	CommandCost res2 = proc(tile, flags | DC_EXEC, p1, p2, text);
+	_last_command_cycles.exec = ottd_rdtsc() - start;
 	BasePersistentStorageArray::SwitchMode(PSM_LEAVE_COMMAND);
 
 	if (cmd_id == CMD_COMPANY_CTRL) {
@@ -0,0 +1,286 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file command_trace.cpp Recording the commands executed through DoCommandP and replaying such recordings. */
+
+#include "stdafx.h"
+#include "command_trace.h"
+#include "command_func.h"
+#include "company_func.h"
+#include "company_base.h"
+#include "date_func.h"
+#include "fileio_func.h"
+#include "string_func.h"
+#include "debug.h"
+#include "core/backup_type.hpp"
+#include "core/mem_func.hpp"
+
+#include <algorithm>
+
+#include "safeguards.h"
+
+/*
+ * A trace file starts with the magic "OTTDCMDT" and a 32 bit version.
+ * Every record follows as: date (32), date fraction (16), company (8),
+ * flags (8), tile (32), p1 (32), p2 (32), cmd (32), test cycles (64),
+ * exec cycles (64), text length (32) and the text bytes. All numbers are
+ * little endian.
+ */
+
+static const char COMMAND_TRACE_MAGIC[8] = { 'O', 'T', 'T', 'D', 'C', 'M', 'D', 'T' };
+static const uint32 COMMAND_TRACE_VERSION = 1;
+static const size_t COMMAND_TRACE_RECORD_SIZE = 4 + 2 + 1 + 1 + 4 * 4 + 8 + 8 + 4; ///< Size of a record without its text.
+
+CommandPhaseCycles _last_command_cycles;
+
+static FILE *_command_trace_file = nullptr; ///< The trace being recorded, if any.
+
+/**
+ * Write a little endian number to a buffer.
+ * @param p Position to write to, moved beyond the number.
+ * @param value Value to write.
+ * @param bytes Number of bytes of the value to write.
+ */
+static inline void WriteTraceValue(byte *&p, uint64 value, uint bytes)
+{
+	for (uint i = 0; i < bytes; i++) *p++ = GB(value, i * 8, 8);
+}
+
+/**
+ * Read a little endian number from a buffer.
+ * @param p Position to read from, moved beyond the number.
+ * @param bytes Number of bytes of the value.
+ * @return The value.
+ */
+static inline uint64 ReadTraceValue(const byte *&p, uint bytes)
+{
+	uint64 value = 0;
+	for (uint i = 0; i < bytes; i++) value |= (uint64)*p++ << (i * 8);
+	return value;
+}
+
+/**
+ * Start recording the executed commands, replacing a trace that is being recorded.
+ * @param filename File to record to, relative to the autosave directory.
+ * @return Whether the file could be created.
+ */
+bool StartCommandTrace(const char *filename)
+{
+	StopCommandTrace();
+
+	_command_trace_file = FioFOpenFile(filename, "wb", AUTOSAVE_DIR);
+	if (_command_trace_file == nullptr) return false;
+
+	byte header[sizeof(COMMAND_TRACE_MAGIC) + 4];
+	memcpy(header, COMMAND_TRACE_MAGIC, sizeof(COMMAND_TRACE_MAGIC));
+	byte *p = header + sizeof(COMMAND_TRACE_MAGIC);
+	WriteTraceValue(p, COMMAND_TRACE_VERSION, 4);
+	fwrite(header, 1, sizeof(header), _command_trace_file);
+
+	DEBUG(misc, 1, "Recording commands to %s", filename);
+	return true;
+}
+
+/** Stop recording the executed commands. */
+void StopCommandTrace()
+{
+	if (_command_trace_file == nullptr) return;
+
+	FioFCloseFile(_command_trace_file);
+	_command_trace_file = nullptr;
+}
+
+/**
+ * Is a trace being recorded?
+ * @return True iff commands are recorded.
+ */
+bool IsCommandTraceActive()
+{
+	return _command_trace_file != nullptr;
+}
+
+/**
+ * Record a command run by DoCommandP, with the timings in #_last_command_cycles.
+ * @param tile The tile of the command.
+ * @param p1 Parameter p1 of the command.
+ * @param p2 Parameter p2 of the command.
+ * @param cmd The command.
+ * @param text The text of the command, may be nullptr.
+ * @param binary_length The length of binary data in \a text, or 0 for a string.
+ * @param flags Flags of the command.
+ */
+void RecordCommandTrace(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, const char *text, uint32 binary_length, CommandTraceFlags flags)
+{
+	if (_command_trace_file == nullptr) return;
+
+	uint32 text_length = 0;
+	if (binary_length != 0) {
+		text_length = binary_length;
+		flags |= CTF_BINARY_TEXT;
+	} else if (text != nullptr) {
+		text_length = (uint32)strlen(text);
+	}
+
+	byte record[COMMAND_TRACE_RECORD_SIZE];
+	byte *p = record;
+	WriteTraceValue(p, _date, 4);
+	WriteTraceValue(p, _date_fract, 2);
+	WriteTraceValue(p, _current_company, 1);
+	WriteTraceValue(p, flags, 1);
+	WriteTraceValue(p, tile, 4);
+	WriteTraceValue(p, p1, 4);
+	WriteTraceValue(p, p2, 4);
+	WriteTraceValue(p, cmd, 4);
+	WriteTraceValue(p, _last_command_cycles.test, 8);
+	WriteTraceValue(p, _last_command_cycles.exec, 8);
+	WriteTraceValue(p, text_length, 4);
+	assert(p == record + COMMAND_TRACE_RECORD_SIZE);
+
+	if (fwrite(record, 1, sizeof(record), _command_trace_file) != sizeof(record) ||
+			(text_length != 0 && fwrite(text, 1, text_length, _command_trace_file) != text_length)) {
+		DEBUG(misc, 0, "Writing the command trace failed, stopped recording");
+		StopCommandTrace();
+	}
+}
+
+/**
+ * Read the next record of a trace.
+ * @param f The trace.
+ * @param[out] record The read record.
+ * @param[out] corrupt Set when the record cannot have been written by #RecordCommandTrace.
+ * @return False at the end of the trace, when it is truncated or when the record is corrupt.
+ */
+static bool ReadCommandTraceRecord(FILE *f, CommandTraceRecord &record, bool *corrupt)
+{
+	byte buffer[COMMAND_TRACE_RECORD_SIZE];
+	if (fread(buffer, 1, sizeof(buffer), f) != sizeof(buffer)) return false;
+
+	const byte *p = buffer;
+	record.date = (Date)ReadTraceValue(p, 4);
+	record.date_fract = (DateFract)ReadTraceValue(p, 2);
+	record.company = (CompanyID)ReadTraceValue(p, 1);
+	record.flags = (byte)ReadTraceValue(p, 1);
+	record.tile = (TileIndex)ReadTraceValue(p, 4);
+	record.p1 = (uint32)ReadTraceValue(p, 4);
+	record.p2 = (uint32)ReadTraceValue(p, 4);
+	record.cmd = (uint32)ReadTraceValue(p, 4);
+	record.cycles.test = ReadTraceValue(p, 8);
+	record.cycles.exec = ReadTraceValue(p, 8);
+	uint32 text_length = (uint32)ReadTraceValue(p, 4);
+	if (text_length > MAX_CMD_TEXT_LENGTH) {
+		*corrupt = true;
+		return false;
+	}
+
+	record.text.resize(text_length);
+	return text_length == 0 || fread(record.text.data(), 1, text_length, f) == text_length;
+}
+
+/** Orders replayed commands by their replay time, slowest first. */
+static bool SlowerCommand(const CommandReplaySample &a, const CommandReplaySample &b)
+{
+	return a.cycles.test + a.cycles.exec > b.cycles.test + b.cycles.exec;
+}
+
+/**
+ * Execute the commands of a trace again, in the recorded order, against the current game.
+ * Commands are executed immediately, regardless of the date they were recorded at.
+ * Commands that were only estimated or only sent to the server, and commands of companies
+ * that do not exist in the current game, are skipped.
+ * @param filename The trace, relative to the autosave directory.
+ * @param num_slowest Number of slowest commands to keep in the result.
+ * @param[out] result Timings of the replay.
+ * @return False if the file is not a command trace, or when it is corrupt.
+ */
+bool ReplayCommandTrace(const char *filename, uint num_slowest, CommandReplayResult *result)
+{
+	assert(!IsCommandTraceActive());
+
+	FILE *f = FioFOpenFile(filename, "rb", AUTOSAVE_DIR);
+	if (f == nullptr) return false;
+
+	byte header[sizeof(COMMAND_TRACE_MAGIC) + 4];
+	if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, COMMAND_TRACE_MAGIC, sizeof(COMMAND_TRACE_MAGIC)) != 0) {
+		FioFCloseFile(f);
+		return false;
+	}
+	const byte *p = header + sizeof(COMMAND_TRACE_MAGIC);
+	if (ReadTraceValue(p, 4) != COMMAND_TRACE_VERSION) {
+		FioFCloseFile(f);
+		return false;
+	}
+
+	result->replayed = 0;
+	result->skipped = 0;
+	result->differed = 0;
+	MemSetT(result->per_command, 0, lengthof(result->per_command));
+	result->slowest.clear();
+
+	CommandTraceRecord record;
+	bool corrupt = false;
+	while (ReadCommandTraceRecord(f, record, &corrupt)) {
+		uint cmd_id = record.cmd & CMD_ID_MASK;
+		if ((record.flags & (CTF_ESTIMATE_ONLY | CTF_ONLY_SENDING)) != 0 || !IsValidCommand(cmd_id)) {
+			result->skipped++;
+			continue;
+		}
+
+		/* The companies of the current game need not match the ones the trace was recorded in. */
+		if (!Company::IsValidID(record.company) && record.company != OWNER_DEITY && record.company != OWNER_NONE) {
+			result->skipped++;
+			continue;
+		}
+
+		bool binary = (record.flags & CTF_BINARY_TEXT) != 0;
+		uint32 binary_length = binary ? (uint32)record.text.size() : 0;
+		const char *text = nullptr;
+		if (!record.text.empty()) {
+			record.text.push_back('\0');
+			text = record.text.data();
+		}
+
+		/* Execute right away, also on a server, and show errors to nobody. */
+		Backup<CompanyByte> cur_company(_current_company, record.company, FILE_LINE);
+		_last_command_cycles.test = 0;
+		_last_command_cycles.exec = 0;
+		bool succeeded = DoCommandP(record.tile, record.p1, record.p2, record.cmd | CMD_NETWORK_COMMAND, nullptr, text, false, binary_length);
+		cur_company.Restore();
+
+		if (succeeded == ((record.flags & CTF_FAILED) != 0)) result->differed++;
+		result->replayed++;
+
+		CommandReplayStats &stats = result->per_command[cmd_id];
+		uint64 cycles = _last_command_cycles.test + _last_command_cycles.exec;
+		stats.count++;
+		if (!succeeded) stats.failed++;
+		stats.test_cycles += _last_command_cycles.test;
+		stats.exec_cycles += _last_command_cycles.exec;
+		stats.max_cycles = max(stats.max_cycles, cycles);
+
+		if (num_slowest == 0) continue;
+		if (result->slowest.size() == num_slowest) {
+			if (cycles <= result->slowest.front().cycles.test + result->slowest.front().cycles.exec) continue;
+			std::pop_heap(result->slowest.begin(), result->slowest.end(), &SlowerCommand);
+			result->slowest.pop_back();
+		}
+		if (text != nullptr) record.text.pop_back();
+		result->slowest.push_back({ record, _last_command_cycles });
+		std::push_heap(result->slowest.begin(), result->slowest.end(), &SlowerCommand);
+	}
+
+	FioFCloseFile(f);
+
+	if (corrupt) {
+		DEBUG(misc, 0, "Command trace %s is corrupt, stopped replaying", filename);
+		return false;
+	}
+
+	std::sort_heap(result->slowest.begin(), result->slowest.end(), &SlowerCommand);
+	return true;
+}
@@ -0,0 +1,83 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file command_trace.h Recording the commands executed through DoCommandP and replaying such recordings. */
+
+#ifndef COMMAND_TRACE_H
+#define COMMAND_TRACE_H
+
+#include "command_type.h"
+#include "company_type.h"
+#include "date_type.h"
+#include <vector>
+
+/** Processor cycles spent in the phases of the last command run through DoCommandPInternal. */
+struct CommandPhaseCycles {
+	uint64 test; ///< Cycles spent in the test run.
+	uint64 exec; ///< Cycles spent in the execution, zero if the command was not executed.
+};
+
+extern CommandPhaseCycles _last_command_cycles;
+
+/** Flags of a recorded command. */
+enum CommandTraceFlags {
+	CTF_NONE          = 0x00, ///< No flag is set.
+	CTF_FAILED        = 0x01, ///< The command failed.
+	CTF_ESTIMATE_ONLY = 0x02, ///< The command was only estimated.
+	CTF_ONLY_SENDING  = 0x04, ///< The command was only sent to the server, it is recorded again when it is executed.
+	CTF_MY_CMD        = 0x08, ///< Locally generated command.
+	CTF_BINARY_TEXT   = 0x10, ///< The text of the command is binary data.
+};
+DECLARE_ENUM_AS_BIT_SET(CommandTraceFlags)
+
+/** A single command of a trace. */
+struct CommandTraceRecord {
+	Date date;                ///< Date the command was executed at.
+	DateFract date_fract;     ///< Fraction of the date the command was executed at.
+	CompanyByte company;      ///< Company executing the command.
+	byte flags;               ///< #CommandTraceFlags of the command.
+	TileIndex tile;           ///< Tile the command was executed on.
+	uint32 p1;                ///< Parameter p1.
+	uint32 p2;                ///< Parameter p2.
+	uint32 cmd;               ///< The command, including the flags and error message.
+	CommandPhaseCycles cycles; ///< Cycles spent executing the command.
+	std::vector<char> text;   ///< Text of the command, without terminator.
+};
+
+/** Replay timings of all commands with the same id. */
+struct CommandReplayStats {
+	uint count;         ///< Number of replayed commands.
+	uint failed;        ///< Number of replayed commands that failed.
+	uint64 test_cycles; ///< Cycles spent in all test runs.
+	uint64 exec_cycles; ///< Cycles spent in all executions.
+	uint64 max_cycles;  ///< Cycles spent by the slowest command.
+};
+
+/** A replayed command with its timings. */
+struct CommandReplaySample {
+	CommandTraceRecord record; ///< The command as recorded.
+	CommandPhaseCycles cycles; ///< Cycles spent replaying the command.
+};
+
+/** Outcome of replaying a trace. */
+struct CommandReplayResult {
+	uint replayed;                                ///< Number of commands executed.
+	uint skipped;                                 ///< Number of recorded commands that were not executed.
+	uint differed;                                ///< Number of commands whose failure state differs from the recording.
+	CommandReplayStats per_command[CMD_END];      ///< Timings per command id.
+	std::vector<CommandReplaySample> slowest;     ///< The slowest commands, slowest first.
+};
+
+bool StartCommandTrace(const char *filename);
+void StopCommandTrace();
+bool IsCommandTraceActive();
+void RecordCommandTrace(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, const char *text, uint32 binary_length, CommandTraceFlags flags);
+bool ReplayCommandTrace(const char *filename, uint num_slowest, CommandReplayResult *result);
+
+#endif /* COMMAND_TRACE_H */
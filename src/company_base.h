@@ -45,6 +45,25 @@ struct CompanyInfrastructure {
 	}
 
 	char *Dump(char *buffer, const char *last) const;
+
+	/**
+	 * Add the counts of other infrastructure to this.
+	 * @param other The infrastructure to add.
+	 * @return This infrastructure.
+	 */
+	CompanyInfrastructure &operator +=(const CompanyInfrastructure &other)
+	{
+		for (RoadType rt = ROADTYPE_BEGIN; rt < ROADTYPE_END; rt++) {
+			for (RoadSubType rst = ROADSUBTYPE_BEGIN; rst < ROADSUBTYPE_END; rst++) this->road[rt][rst] += other.road[rt][rst];
+		}
+		for (RailType rt = RAILTYPE_BEGIN; rt < RAILTYPE_END; rt++) this->rail[rt] += other.rail[rt];
+		this->signal += other.signal;
+		this->water += other.water;
+		this->station += other.station;
+		this->airport += other.airport;
+		return *this;
+	}
+
 	/** Get total sum of all owned road/tram bits. */
 	uint32 GetRoadTotal(RoadType rt) const
 	{
@@ -15,11 +15,14 @@
 #include "engine_func.h"
 #include "landscape.h"
 #include "saveload/saveload.h"
+#include "saveload/map_sl.h"
 #include "network/network.h"
 #include "network/network_func.h"
 #include "network/network_base.h"
 #include "network/network_admin.h"
 #include "network/network_client.h"
+#include "network/network_server.h"
+#include "network/network_load_test.h"
 #include "command_func.h"
 #include "settings_func.h"
 #include "fios.h"
@@ -35,9 +38,17 @@
 #include "ai/ai.hpp"
 #include "ai/ai_config.hpp"
 #include "newgrf.h"
+#include "spritecache.h"
 #include "console_func.h"
 #include "engine_base.h"
 #include "game/game.hpp"
+#include "cargopacket.h"
+#include "cpu.h"
+#include "tbtr_template_vehicle_func.h"
+#include "command_trace.h"
+#include "event_log.h"
+#include "gfx_layout.h"
+#include "core/pool_func.hpp"
 #include "table/strings.h"
 
 #include "safeguards.h"
@@ -874,6 +885,51 @@ DEF_CONSOLE_CMD(ConNetworkClients)
 	return true;
 }
 
+#ifdef _DEBUG
+DEF_CONSOLE_CMD(ConNetworkLoadTest)
+{
+	if (argc == 0) {
+		IConsoleHelp("Open many local connections to this server to see how it copes with them. Usage: 'network_load_test <count> [game|admin]', 'network_load_test stats' or 'network_load_test close'");
+		IConsoleHelp("Game connections ask for the company information every second and are opened again when the server drops them.");
+		IConsoleHelp("Admin connections log in with the admin password and ping every second. 'stats' shows the numbers since the previous 'stats'.");
+		return true;
+	}
+
+	if (argc < 2 || argc > 3) return false;
+
+	if (strcmp(argv[1], "close") == 0) {
+		NetworkLoadTestClose();
+		return true;
+	}
+
+	if (strcmp(argv[1], "stats") == 0) {
+		NetworkLoadTestStats stats = NetworkLoadTestGetStats();
+		IConsolePrintF(CC_DEFAULT, "Load test: %u game and %u admin connections, %u connects, %u closed by the server, " OTTD_PRINTF64U " bytes received",
+				stats.game_connections, stats.admin_connections, stats.connects, stats.closes, stats.bytes_received);
+		IConsolePrintF(CC_DEFAULT, "Server sockets (%s): %u frames, " OTTD_PRINTF64U " cycles per frame",
+				ServerNetworkGameSocketHandler::UsesEpoll() ? "epoll" : "select", stats.receive_calls,
+				stats.receive_calls == 0 ? 0 : stats.receive_cycles / stats.receive_calls);
+		return true;
+	}
+
+	uint count;
+	if (!GetArgumentInteger(&count, argv[1])) return false;
+
+	bool admin = false;
+	if (argc == 3) {
+		if (strcmp(argv[2], "admin") == 0) {
+			admin = true;
+		} else if (strcmp(argv[2], "game") != 0) {
+			return false;
+		}
+	}
+
+	NetworkLoadTestOpen(count, admin);
+	return true;
+}
+
+#endif /* _DEBUG */
+
 DEF_CONSOLE_CMD(ConNetworkReconnect)
 {
 	if (argc == 0) {
@@ -1430,6 +1486,42 @@ DEF_CONSOLE_CMD(ConMinimap)
 	return MakeScreenshot(SC_MINIMAP, name);
 }
 
+DEF_CONSOLE_CMD(ConMinimapExport)
+{
+	if (argc == 0) {
+		IConsoleHelp("Write the parts of the minimap that changed since the last export as image tiles. Usage: 'minimap_export <dir> [routes|heightmap|industries|owners] [full]'");
+		IConsoleHelp("Writes 256x256 images named '<level>_<column>_<row>' to <dir> in the screenshot directory; level 0 has a pixel per tile,");
+		IConsoleHelp("every next level halves the resolution. 'full' writes all images again, e.g. after a company changed its colour.");
+		return true;
+	}
+
+	if (argc < 2 || argc > 4) return false;
+
+	ScreenshotType type = SC_MINIMAP;
+	bool full = false;
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "full") == 0) {
+			full = true;
+		} else if (strcmp(argv[i], "routes") == 0) {
+			type = SC_MINIMAP;
+		} else if (strcmp(argv[i], "heightmap") == 0) {
+			type = SC_MINI_HEIGHTMAP;
+		} else if (strcmp(argv[i], "industries") == 0) {
+			type = SC_MINI_INDUSTRYMAP;
+		} else if (strcmp(argv[i], "owners") == 0) {
+			type = SC_MINI_OWNERMAP;
+		} else {
+			return false;
+		}
+	}
+
+	MinimapExportResult result;
+	if (!ExportMinimapTiles(type, argv[1], full, &result)) IConsoleError("Not all images could be written.");
+	IConsolePrintF(CC_DEFAULT, "Recalculated %u areas, wrote %u images in %u levels, cycles: " OTTD_PRINTF64U,
+			result.chunks_updated, result.images_written, result.levels, result.cycles);
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConInfoCmd)
 {
 	if (argc == 0) {
@@ -1938,6 +2030,468 @@ DEF_CONSOLE_CMD(ConDumpCommandLog)
 	return true;
 }
 
+/** Print the statistics of the sprite cache. */
+static void PrintSpriteCacheStats()
+{
+	const SpriteCacheStats &stats = GetSpriteCacheStats();
+	const uint64 requests = stats.hits + stats.misses;
+	IConsolePrintF(CC_DEFAULT, "Requests: " OTTD_PRINTF64U ", hits: " OTTD_PRINTF64U " (%u%%), misses: " OTTD_PRINTF64U ", evictions: " OTTD_PRINTF64U,
+			requests, stats.hits, requests == 0 ? 0 : (uint)(stats.hits * 100 / requests), stats.misses, stats.evictions);
+	IConsolePrintF(CC_DEFAULT, "Sprites copied from the sprite cache file: " OTTD_PRINTF64U, stats.disk_hits);
+	IConsolePrintF(CC_DEFAULT, "Memory: " PRINTF_SIZE " KiB in use of " PRINTF_SIZE " KiB budget, " PRINTF_SIZE " KiB of recolour sprites, " PRINTF_SIZE " KiB allocated in %u slabs",
+			stats.used / 1024, stats.budget / 1024, stats.recolour / 1024, stats.allocated / 1024, stats.slabs);
+}
+
+/** Print the statistics of the cache of laid out text lines. */
+static void PrintLineCacheStats()
+{
+	Layouter::LineCacheStats stats = Layouter::GetLineCacheStats(false);
+	uint64 lookups = stats.hits + stats.misses;
+	IConsolePrintF(CC_DEFAULT, "Lines: " PRINTF_SIZE ", memory: " PRINTF_SIZE " of " PRINTF_SIZE " KiB", stats.items, stats.bytes / 1024, stats.budget / 1024);
+	IConsolePrintF(CC_DEFAULT, "Hits: " OTTD_PRINTF64U ", misses: " OTTD_PRINTF64U " (%.1f%% hits), evictions: " OTTD_PRINTF64U,
+			stats.hits, stats.misses, lookups == 0 ? 0.0 : stats.hits * 100.0 / lookups, stats.evictions);
+}
+
+/** Restart counting the hits, misses and evictions of the line cache. */
+static void ResetLineCacheStats()
+{
+	Layouter::GetLineCacheStats(true);
+}
+
+/** Print the statistics of template based train replacement. */
+static void PrintTemplateReplacementStats()
+{
+	const TemplateReplacementStats &stats = _template_replacement_stats;
+	IConsolePrintF(CC_DEFAULT, "Passes: " OTTD_PRINTF64U ", depots: " OTTD_PRINTF64U ", trains: " OTTD_PRINTF64U " (" OTTD_PRINTF64U " replaced)",
+			stats.passes, stats.depots, stats.trains, stats.succeeded);
+	IConsolePrintF(CC_DEFAULT, "Cycles: " OTTD_PRINTF64U " total, " OTTD_PRINTF64U " per train",
+			stats.cycles, stats.trains == 0 ? 0 : stats.cycles / stats.trains);
+}
+
+/** Print the number of cargo packets and the result of the last compaction. */
+static void PrintCargoPacketStats()
+{
+	IConsolePrintF(CC_DEFAULT, "Cargo packets: " PRINTF_SIZE " (" PRINTF_SIZE " KiB), pool slots: " PRINTF_SIZE,
+			CargoPacket::GetNumItems(), CargoPacket::GetNumItems() * sizeof(CargoPacket) / 1024, CargoPacket::GetPoolSize());
+
+	const CargoCompactionStats &stats = GetCargoCompactionStats();
+	if (stats.passes == 0) return;
+	IConsolePrintF(CC_DEFAULT, "Last compaction (%u done): packets " PRINTF_SIZE " -> " PRINTF_SIZE " (" PRINTF_SIZE " -> " PRINTF_SIZE " KiB), pool extent " PRINTF_SIZE " -> " PRINTF_SIZE,
+			stats.passes, stats.packets_before, stats.packets_after,
+			stats.packets_before * sizeof(CargoPacket) / 1024, stats.packets_after * sizeof(CargoPacket) / 1024,
+			stats.pool_size_before, stats.pool_size_after);
+	IConsolePrintF(CC_DEFAULT, "  merged: %u, renumbered: %u, cycles: " OTTD_PRINTF64U, stats.merged, stats.relocated, stats.cycles);
+}
+
+#ifdef ENABLE_NETWORK
+/** Print the traffic of the clients connected to this server. */
+static void PrintNetworkStats()
+{
+	if (!_network_server) {
+		IConsolePrint(CC_DEFAULT, "Only available on a server.");
+		return;
+	}
+
+	NetworkClientSocket *cs;
+	FOR_ALL_CLIENT_SOCKETS(cs) {
+		IConsolePrintF(CC_DEFAULT, "Client #%u  sent: " OTTD_PRINTF64U " bytes, " OTTD_PRINTF64U " packets, " OTTD_PRINTF64U " calls  received: " OTTD_PRINTF64U " bytes, " OTTD_PRINTF64U " packets, " OTTD_PRINTF64U " calls  queued: %u packets",
+				cs->client_id, cs->bytes_sent, cs->packets_sent, cs->send_calls, cs->bytes_received, cs->packets_received, cs->recv_calls, cs->GetSendQueueLength());
+	}
+}
+#endif /* ENABLE_NETWORK */
+
+/** A part of the game of which the 'stats' command shows the statistics. */
+struct ConsoleStats {
+	const char *name; ///< Name of the part on the console.
+	void (*print)();  ///< Print the statistics.
+	void (*reset)();  ///< Restart counting, or nullptr when there are no counters.
+};
+
+/** All parts with statistics, in the order 'stats' shows them. */
+static const ConsoleStats _console_stats[] = {
+	{ "sprites",   &PrintSpriteCacheStats,         &ResetSpriteCacheStats },
+	{ "lines",     &PrintLineCacheStats,           &ResetLineCacheStats },
+	{ "templates", &PrintTemplateReplacementStats, &ResetTemplateReplacementStats },
+	{ "cargo",     &PrintCargoPacketStats,         nullptr },
+#ifdef ENABLE_NETWORK
+	{ "network",   &PrintNetworkStats,             nullptr },
+#endif /* ENABLE_NETWORK */
+};
+
+DEF_CONSOLE_CMD(ConStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show statistics of caches and other parts of the game. Usage: 'stats [<part>] [reset]'");
+		IConsoleHelp("Parts are 'sprites' (sprite cache), 'lines' (text line cache), 'templates' (template replacement),");
+		IConsoleHelp("'cargo' (cargo packets) and 'network' (client traffic); without <part> all of them are shown.");
+		IConsoleHelp("'reset' restarts the counters instead of showing them.");
+		return true;
+	}
+
+	if (argc > 3) return false;
+
+	bool reset = argc > 1 && strcmp(argv[argc - 1], "reset") == 0;
+	if (argc == 3 && !reset) return false;
+	const char *part = argc - (reset ? 1 : 0) == 2 ? argv[1] : nullptr;
+
+	bool found = false;
+	for (const ConsoleStats &stats : _console_stats) {
+		if (part != nullptr && strcmp(part, stats.name) != 0) continue;
+		found = true;
+
+		if (reset) {
+			if (stats.reset != nullptr) stats.reset();
+			continue;
+		}
+		if (part == nullptr) IConsolePrintF(CC_INFO, "%s:", stats.name);
+		stats.print();
+	}
+	return found;
+}
+
+DEF_CONSOLE_CMD(ConCompactCargoPackets)
+{
+	if (argc == 0) {
+		IConsoleHelp("Merge and renumber the cargo packets right away and show the result. Usage: 'compact_cargo_packets'");
+		return true;
+	}
+
+	CompactCargoPackets();
+	PrintCargoPacketStats();
+	return true;
+}
+
+/** Item of the pool used by the pool iteration benchmark. */
+struct BenchPoolItem;
+typedef Pool<BenchPoolItem, uint32, 1024, 0x400000, PT_NONE> BenchPoolItemPool;
+static BenchPoolItemPool _bench_pool_item_pool("BenchPoolItem");
+INSTANTIATE_POOL_METHODS(BenchPoolItem)
+
+struct BenchPoolItem : BenchPoolItemPool::PoolItem<&_bench_pool_item_pool> {
+	uint32 value; ///< Value summed by the iterations.
+
+	BenchPoolItem(uint32 value) : value(value) {}
+};
+
+DEF_CONSOLE_CMD(ConBenchPoolIteration)
+{
+	if (argc == 0) {
+		IConsoleHelp("Measure iterating over a fragmented pool. Usage: 'bench_pool_iteration [<items> [<percent kept>]]'");
+		IConsoleHelp("Fills a private pool with <items> items (default 1000000), deletes all but <percent kept> (default 10) of them");
+		IConsoleHelp("scattered over the pool, then times iterating the remaining items and filling the free indexes again.");
+		return true;
+	}
+
+	if (argc > 3) return false;
+
+	uint num_items = 1000000;
+	uint percent_kept = 10;
+	if (argc >= 2 && !GetArgumentInteger(&num_items, argv[1])) return false;
+	if (argc >= 3 && (!GetArgumentInteger(&percent_kept, argv[2]) || percent_kept > 100)) return false;
+	if (num_items == 0 || num_items > BenchPoolItemPool::MAX_SIZE) {
+		IConsolePrintF(CC_ERROR, "The number of items must be between 1 and " PRINTF_SIZE ".", BenchPoolItemPool::MAX_SIZE);
+		return true;
+	}
+
+	static const uint PASSES = 10;
+
+	uint64 start = ottd_rdtsc();
+	BenchPoolItem::CanAllocateItem(num_items);
+	for (uint i = 0; i < num_items; i++) new BenchPoolItem(i);
+	uint64 fill_cycles = ottd_rdtsc() - start;
+
+	/* Scatter the kept items with a multiplicative hash, like the churn of a long game does. */
+	for (uint i = 0; i < num_items; i++) {
+		if ((i * 2654435761U >> 16) % 100 >= percent_kept) delete BenchPoolItem::Get(i);
+	}
+	uint num_kept = (uint)BenchPoolItem::GetNumItems();
+
+	/* Visiting every index is how the pools were iterated before they had a bitmap. */
+	uint64 sum_scan = 0;
+	start = ottd_rdtsc();
+	for (uint pass = 0; pass < PASSES; pass++) {
+		for (size_t i = 0; i < BenchPoolItem::GetPoolSize(); i++) {
+			const BenchPoolItem *item = BenchPoolItem::Get(i);
+			if (item != nullptr) sum_scan += item->value;
+		}
+	}
+	uint64 scan_cycles = ottd_rdtsc() - start;
+
+	uint64 sum_macro = 0;
+	start = ottd_rdtsc();
+	for (uint pass = 0; pass < PASSES; pass++) {
+		const BenchPoolItem *item;
+		FOR_ALL_ITEMS_FROM(BenchPoolItem, bench_index, item, 0) sum_macro += item->value;
+	}
+	uint64 macro_cycles = ottd_rdtsc() - start;
+
+	uint64 sum_range = 0;
+	start = ottd_rdtsc();
+	for (uint pass = 0; pass < PASSES; pass++) {
+		for (const BenchPoolItem *item : BenchPoolItem::Iterate()) sum_range += item->value;
+	}
+	uint64 range_cycles = ottd_rdtsc() - start;
+
+	uint num_refilled = num_items - num_kept;
+	start = ottd_rdtsc();
+	BenchPoolItem::CanAllocateItem(num_refilled);
+	for (uint i = 0; i < num_refilled; i++) new BenchPoolItem(i);
+	uint64 refill_cycles = ottd_rdtsc() - start;
+	bool dense = BenchPoolItem::GetPoolSize() == num_items;
+
+	_bench_pool_item_pool.CleanPool();
+
+	uint64 visited = (uint64)max(num_kept, 1U) * PASSES;
+	IConsolePrintF(CC_DEFAULT, "Filled %u items: " OTTD_PRINTF64U " cycles per item; kept %u of them", num_items, fill_cycles / num_items, num_kept);
+	IConsolePrintF(CC_DEFAULT, "Scanning all indexes: " OTTD_PRINTF64U " cycles per item", scan_cycles / visited);
+	IConsolePrintF(CC_DEFAULT, "FOR_ALL_ITEMS: " OTTD_PRINTF64U " cycles per item", macro_cycles / visited);
+	IConsolePrintF(CC_DEFAULT, "Iterate(): " OTTD_PRINTF64U " cycles per item", range_cycles / visited);
+	IConsolePrintF(CC_DEFAULT, "Refilled %u free indexes: " OTTD_PRINTF64U " cycles per item", num_refilled, num_refilled == 0 ? 0 : refill_cycles / num_refilled);
+	if (sum_scan != sum_macro || sum_scan != sum_range || !dense) IConsoleError("The iterations or the refill did not visit the same items.");
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchMapChunks)
+{
+	if (argc == 0) {
+		IConsoleHelp("Measure saving the map chunks to memory and loading them back. Usage: 'bench_map_chunks [<passes>]'");
+		IConsoleHelp("Does <passes> (default 5) round trips with every implementation the processor supports.");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	uint passes = 5;
+	if (argc == 2 && (!GetArgumentInteger(&passes, argv[1]) || passes == 0)) return false;
+
+	static const MapSlImplementation impls[] = { MSI_SCALAR, MSI_SSE2 };
+	static const char * const names[] = { "scalar", "SSE2" };
+	assert_compile(lengthof(impls) == lengthof(names));
+
+	for (uint i = 0; i < lengthof(impls); i++) {
+		if (!SetMapSlImplementation(impls[i])) {
+			IConsolePrintF(CC_DEFAULT, "%s: not supported", names[i]);
+			continue;
+		}
+
+		SlChunkBenchmark total = { 0, 0, 0 };
+		for (uint pass = 0; pass < passes; pass++) {
+			SlChunkBenchmark result;
+			if (!BenchmarkMapChunks(&result)) {
+				SetMapSlImplementation(MSI_AUTO);
+				IConsoleError("Cannot measure while a game is being saved.");
+				return true;
+			}
+			total.bytes += result.bytes;
+			total.save_us += result.save_us;
+			total.load_us += result.load_us;
+		}
+
+		/* Bytes per microsecond are megabytes per second. */
+		IConsolePrintF(CC_DEFAULT, "%s: " PRINTF_SIZE " KiB per pass, saving " OTTD_PRINTF64U " MB/s, loading " OTTD_PRINTF64U " MB/s",
+				names[i], total.bytes / passes / 1024, total.bytes / max<uint64>(total.save_us, 1), total.bytes / max<uint64>(total.load_us, 1));
+	}
+
+	SetMapSlImplementation(MSI_AUTO);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchMapScan)
+{
+	if (argc == 0) {
+		IConsoleHelp("Measure scans over the whole map. Usage: 'bench_map_scan [<passes>]'");
+		IConsoleHelp("Does <passes> (default 10) scans of the tile types and heights.");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	uint passes = 10;
+	if (argc == 2 && (!GetArgumentInteger(&passes, argv[1]) || passes == 0)) return false;
+
+#ifdef SPLIT_MAP_ARRAYS
+	IConsolePrintF(CC_DEFAULT, "Map layout: types and heights apart, %u + %u bytes per tile", (uint)sizeof(TileTypeHeight), (uint)(sizeof(Tile) + sizeof(TileExtended)));
+#else
+	IConsolePrintF(CC_DEFAULT, "Map layout: types and heights within the tiles, %u bytes per tile", (uint)(sizeof(Tile) + sizeof(TileExtended)));
+#endif /* SPLIT_MAP_ARRAYS */
+
+	uint64 tiles = (uint64)MapSize() * passes;
+
+	uint type_counts[MP_VOID + 1] = {};
+	uint64 start = ottd_rdtsc();
+	for (uint pass = 0; pass < passes; pass++) {
+		for (TileIndex t = 0; t < MapSize(); t++) type_counts[GetTileType(t)]++;
+	}
+	uint64 type_cycles = ottd_rdtsc() - start;
+
+	uint64 height_sum = 0;
+	start = ottd_rdtsc();
+	for (uint pass = 0; pass < passes; pass++) {
+		for (TileIndex t = 0; t < MapSize(); t++) height_sum += TileHeight(t);
+	}
+	uint64 height_cycles = ottd_rdtsc() - start;
+
+	/* Like the map-wide passes after loading: filter on the type, then look at the other fields. */
+	uint owned_by_town = 0;
+	start = ottd_rdtsc();
+	for (uint pass = 0; pass < passes; pass++) {
+		for (TileIndex t = 0; t < MapSize(); t++) {
+			if (IsTileType(t, MP_ROAD) && GetTileOwner(t) == OWNER_TOWN) owned_by_town++;
+		}
+	}
+	uint64 filter_cycles = ottd_rdtsc() - start;
+
+	IConsolePrintF(CC_DEFAULT, "Tile types: " OTTD_PRINTF64U " cycles per 1000 tiles (%u clear tiles)", type_cycles * 1000 / tiles, type_counts[MP_CLEAR] / passes);
+	IConsolePrintF(CC_DEFAULT, "Tile heights: " OTTD_PRINTF64U " cycles per 1000 tiles (average height %u)", height_cycles * 1000 / tiles, (uint)(height_sum / tiles));
+	IConsolePrintF(CC_DEFAULT, "Road tiles of towns: " OTTD_PRINTF64U " cycles per 1000 tiles (%u tiles)", filter_cycles * 1000 / tiles, owned_by_town / passes);
+
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConCommandTrace)
+{
+	if (argc == 0) {
+		IConsoleHelp("Record all executed commands with their timings. Usage: 'command_trace start <file>' or 'command_trace stop'");
+		IConsoleHelp("The trace is written to the autosave directory and can be replayed with 'replay_command_trace'.");
+		return true;
+	}
+
+	if (argc == 3 && strcmp(argv[1], "start") == 0) {
+		if (!StartCommandTrace(argv[2])) IConsoleError("Cannot create the trace file.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+		if (!IsCommandTraceActive()) IConsoleWarning("No command trace is being recorded.");
+		StopCommandTrace();
+		return true;
+	}
+
+	return false;
+}
+
+DEF_CONSOLE_CMD(ConEventLog)
+{
+	if (argc == 0) {
+		IConsoleHelp("Record structured events to a binary file. Usage: 'event_log start <file> [<categories>]', 'event_log stop' or 'event_log decode <file> <output>'");
+		IConsoleHelp("Categories are a comma separated list of 'game', 'pathfinder', 'network' and 'command', or 'all' (default).");
+		IConsoleHelp("Files are relative to the autosave directory; 'decode' writes the events of a log as text.");
+		return true;
+	}
+
+	if ((argc == 3 || argc == 4) && strcmp(argv[1], "start") == 0) {
+		uint32 categories;
+		if (!GetEventLogCategories(argc == 4 ? argv[3] : "all", &categories)) {
+			IConsoleError("Unknown event category.");
+			return true;
+		}
+		if (!StartEventLog(argv[2], categories)) IConsoleError("Cannot start recording events.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+		if (!IsEventLogActive()) IConsoleWarning("No events are being recorded.");
+		StopEventLog();
+		return true;
+	}
+
+	if (argc == 4 && strcmp(argv[1], "decode") == 0) {
+		EventLogDecodeResult result;
+		if (!DecodeEventLog(argv[2], argv[3], &result)) {
+			IConsoleError("Cannot read the event log or create the output.");
+			return true;
+		}
+
+		IConsolePrintF(CC_DEFAULT, "Decoded %u records, %u were dropped while recording.", result.records, result.dropped);
+		for (const EventLogDecodedEvent &event : result.events) {
+			if (event.count != 0) IConsolePrintF(CC_DEFAULT, "  %-24s %8u", event.name.c_str(), event.count);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/** Orders command ids by the cycles spent replaying them, slowest first. */
+struct CommandReplayStatsSorter {
+	const CommandReplayResult &result;
+
+	bool operator()(uint a, uint b) const
+	{
+		return this->result.per_command[a].test_cycles + this->result.per_command[a].exec_cycles >
+				this->result.per_command[b].test_cycles + this->result.per_command[b].exec_cycles;
+	}
+};
+
+/**
+ * Can commands be replayed without desyncing anyone?
+ * @return True in single player and on dedicated servers without clients.
+ */
+static bool CanReplayCommands()
+{
+	if (!_networking) return true;
+#ifdef ENABLE_NETWORK
+	return _network_dedicated && NetworkClientInfo::GetNumItems() == 0;
+#else
+	return false;
+#endif /* ENABLE_NETWORK */
+}
+
+DEF_CONSOLE_CMD(ConReplayCommandTrace)
+{
+	if (argc == 0) {
+		IConsoleHelp("Execute the commands of a trace against the current game and show where the time went. Usage: 'replay_command_trace <file> [<slowest>]'");
+		IConsoleHelp("Shows the totals per command and the <slowest> (default 10) single commands. This changes the game,");
+		IConsoleHelp("so it is only available in single player and on a dedicated server without clients.");
+		return true;
+	}
+
+	if (argc < 2 || argc > 3) return false;
+
+	if (!CanReplayCommands()) {
+		IConsoleError("This command is only available in single player and on a dedicated server without clients.");
+		return true;
+	}
+	if (IsCommandTraceActive()) {
+		IConsoleError("Stop recording commands before replaying a trace.");
+		return true;
+	}
+
+	uint num_slowest = 10;
+	if (argc == 3 && !GetArgumentInteger(&num_slowest, argv[2])) return false;
+
+	CommandReplayResult *result = new CommandReplayResult();
+	if (!ReplayCommandTrace(argv[1], num_slowest, result)) {
+		IConsoleError("Cannot read the command trace, or it is corrupt.");
+		delete result;
+		return true;
+	}
+
+	IConsolePrintF(CC_DEFAULT, "Replayed %u commands, skipped %u, %u succeeded or failed differently than recorded.", result->replayed, result->skipped, result->differed);
+
+	std::vector<uint> cmd_ids;
+	for (uint i = 0; i < CMD_END; i++) {
+		if (result->per_command[i].count != 0) cmd_ids.push_back(i);
+	}
+	std::sort(cmd_ids.begin(), cmd_ids.end(), CommandReplayStatsSorter{ *result });
+	for (uint i : cmd_ids) {
+		const CommandReplayStats &stats = result->per_command[i];
+		IConsolePrintF(CC_DEFAULT, "  %-32s count: %6u, failed: %6u, test: " OTTD_PRINTF64U ", exec: " OTTD_PRINTF64U ", max: " OTTD_PRINTF64U " cycles",
+				GetCommandName(i), stats.count, stats.failed, stats.test_cycles, stats.exec_cycles, stats.max_cycles);
+	}
+
+	if (!result->slowest.empty()) IConsolePrint(CC_DEFAULT, "Slowest commands:");
+	for (const CommandReplaySample &sample : result->slowest) {
+		const CommandTraceRecord &record = sample.record;
+		IConsolePrintF(CC_DEFAULT, "  %-32s company: %2u, tile: %7u x %7u, p1: 0x%08X, p2: 0x%08X, test: " OTTD_PRINTF64U ", exec: " OTTD_PRINTF64U " cycles (recorded: " OTTD_PRINTF64U ")",
+				GetCommandName(record.cmd), (uint)record.company, TileX(record.tile), TileY(record.tile), record.p1, record.p2,
+				sample.cycles.test, sample.cycles.exec, record.cycles.test + record.cycles.exec);
+	}
+
+	delete result;
+	return true;
+}
+
 #ifdef _DEBUG
 /******************
  *  debug commands
@@ -1977,6 +2531,7 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("return",       ConReturn);
 	IConsoleCmdRegister("screenshot",   ConScreenShot);
 	IConsoleCmdRegister("minimap",      ConMinimap);
+	IConsoleCmdRegister("minimap_export", ConMinimapExport);
 	IConsoleCmdRegister("script",       ConScript);
 	IConsoleCmdRegister("scrollto",     ConScrollToTile);
 	IConsoleCmdRegister("alias",        ConAlias);
@@ -2032,6 +2587,9 @@ void IConsoleStdLibRegister()
 
 	IConsoleCmdRegister("connect",         ConNetworkConnect, ConHookClientOnly);
 	IConsoleCmdRegister("clients",         ConNetworkClients, ConHookNeedNetwork);
+#ifdef _DEBUG
+	IConsoleCmdRegister("network_load_test", ConNetworkLoadTest, ConHookServerOnly);
+#endif /* _DEBUG */
 	IConsoleCmdRegister("status",          ConStatus, ConHookServerOnly);
 	IConsoleCmdRegister("server_info",     ConServerInfo, ConHookServerOnly);
 	IConsoleAliasRegister("info",          "server_info");
@@ -2084,7 +2642,15 @@ void IConsoleStdLibRegister()
 #endif
 	IConsoleCmdRegister("dump_command_log", ConDumpCommandLog, nullptr);
 	IConsoleCmdRegister("check_caches", ConCheckCaches, nullptr);
+	IConsoleCmdRegister("stats", ConStats, nullptr);
+	IConsoleCmdRegister("command_trace", ConCommandTrace, nullptr);
+	IConsoleCmdRegister("replay_command_trace", ConReplayCommandTrace, nullptr);
+	IConsoleCmdRegister("event_log", ConEventLog, nullptr);
 
 	/* NewGRF development stuff */
 	IConsoleCmdRegister("reload_newgrfs",  ConNewGRFReload, ConHookNewGRFDeveloperTool);
+	IConsoleCmdRegister("compact_cargo_packets", ConCompactCargoPackets, ConHookNewGRFDeveloperTool);
+	IConsoleCmdRegister("bench_pool_iteration", ConBenchPoolIteration, ConHookNewGRFDeveloperTool);
+	IConsoleCmdRegister("bench_map_chunks", ConBenchMapChunks, ConHookNewGRFDeveloperTool);
+	IConsoleCmdRegister("bench_map_scan", ConBenchMapScan, ConHookNewGRFDeveloperTool);
 }
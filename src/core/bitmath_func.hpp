@@ -227,6 +227,25 @@ static inline uint8 FindFirstBit2x64(const int value)
 uint8 FindFirstBit(uint32 x);
 uint8 FindLastBit(uint64 x);
 
+/**
+ * Search the first set bit in a 64 bit variable.
+ *
+ * Compilers that provide a builtin for it use the bit scan instruction
+ * of the processor, which makes this suitable for scanning bitmaps.
+ *
+ * @param x The value to search, must not be 0
+ * @return The position of the first bit set
+ */
+static inline uint8 FindFirstBit64(uint64 x)
+{
+	assert(x != 0);
+#if !defined(__ICC) && defined(__GNUC__) && ((__GNUC__ > 3) || ((__GNUC__ == 3) && __GNUC_MINOR__ >= 4))
+	return (uint8)__builtin_ctzll(x);
+#else
+	return (uint32)x != 0 ? FindFirstBit((uint32)x) : FindFirstBit((uint32)(x >> 32)) + 32;
+#endif
+}
+
 /**
  * Clear the first bit in an integer.
  *
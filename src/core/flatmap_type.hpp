@@ -0,0 +1,134 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file flatmap_type.hpp Map stored as a sorted vector of key/value pairs. */
+
+#ifndef FLATMAP_TYPE_HPP
+#define FLATMAP_TYPE_HPP
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+/**
+ * Associative container storing its entries in a vector sorted by key. Lookups
+ * are binary searches over contiguous memory, which for small to medium sized
+ * maps is much faster than walking a tree, and an entry costs no more than the
+ * pair itself. Inserting or erasing in the middle moves the following entries
+ * and invalidates all iterators, so the map is best filled in key order.
+ * The key of an entry must not be changed through an iterator.
+ * @tparam Tkey Key type.
+ * @tparam Tvalue Value type.
+ */
+template <typename Tkey, typename Tvalue>
+class FlatMap : public std::vector<std::pair<Tkey, Tvalue> > {
+public:
+	typedef std::pair<Tkey, Tvalue> value_type;
+	typedef std::vector<value_type> Base;
+	typedef typename Base::iterator iterator;
+	typedef typename Base::const_iterator const_iterator;
+
+	using Base::erase;
+
+	/**
+	 * Find the first entry with a key not less than the given one.
+	 * @param key Key to look for.
+	 * @return Iterator to the entry, or end().
+	 */
+	inline iterator lower_bound(const Tkey &key)
+	{
+		return std::lower_bound(this->begin(), this->end(), key, &FlatMap::KeyLess);
+	}
+
+	/** @copydoc lower_bound(const Tkey &) */
+	inline const_iterator lower_bound(const Tkey &key) const
+	{
+		return std::lower_bound(this->begin(), this->end(), key, &FlatMap::KeyLess);
+	}
+
+	/**
+	 * Find the first entry with a key greater than the given one.
+	 * @param key Key to look for.
+	 * @return Iterator to the entry, or end().
+	 */
+	inline iterator upper_bound(const Tkey &key)
+	{
+		return std::upper_bound(this->begin(), this->end(), key, &FlatMap::LessKey);
+	}
+
+	/** @copydoc upper_bound(const Tkey &) */
+	inline const_iterator upper_bound(const Tkey &key) const
+	{
+		return std::upper_bound(this->begin(), this->end(), key, &FlatMap::LessKey);
+	}
+
+	/**
+	 * Find the entry with the given key.
+	 * @param key Key to look for.
+	 * @return Iterator to the entry, or end() if there is none.
+	 */
+	inline iterator find(const Tkey &key)
+	{
+		iterator it = this->lower_bound(key);
+		return (it != this->end() && it->first == key) ? it : this->end();
+	}
+
+	/** @copydoc find(const Tkey &) */
+	inline const_iterator find(const Tkey &key) const
+	{
+		const_iterator it = this->lower_bound(key);
+		return (it != this->end() && it->first == key) ? it : this->end();
+	}
+
+	/**
+	 * Insert an entry unless there already is one with the same key.
+	 * @param value Entry to insert.
+	 * @return Iterator to the entry with the key, and whether it was inserted.
+	 */
+	std::pair<iterator, bool> insert(const value_type &value)
+	{
+		if (this->empty() || this->back().first < value.first) {
+			this->push_back(value);
+			return std::make_pair(this->end() - 1, true);
+		}
+		iterator it = this->lower_bound(value.first);
+		if (it != this->end() && it->first == value.first) return std::make_pair(it, false);
+		return std::make_pair(Base::insert(it, value), true);
+	}
+
+	/**
+	 * Erase the entry with the given key, if any.
+	 * @param key Key of the entry.
+	 * @return Number of erased entries.
+	 */
+	size_t erase(const Tkey &key)
+	{
+		iterator it = this->find(key);
+		if (it == this->end()) return 0;
+		Base::erase(it);
+		return 1;
+	}
+
+	/**
+	 * Get the value for a key, inserting a default constructed one if there is none.
+	 * Appending in key order is cheap, inserting elsewhere moves the later entries.
+	 * @param key Key of the entry.
+	 * @return Reference to the value.
+	 */
+	Tvalue &operator[](const Tkey &key)
+	{
+		return this->insert(value_type(key, Tvalue())).first->second;
+	}
+
+private:
+	static inline bool KeyLess(const value_type &entry, const Tkey &key) { return entry.first < key; }
+	static inline bool LessKey(const Tkey &key, const value_type &entry) { return key < entry.first; }
+};
+
+#endif /* FLATMAP_TYPE_HPP */
@@ -40,6 +40,8 @@ DEFINE_POOL_METHOD(inline)::Pool(const char *name) :
 #endif /* OTTD_ASSERT */
 		cleaning(false),
 		data(nullptr),
+		used(nullptr),
+		full(nullptr),
 		alloc_cache(nullptr)
 { }
 
@@ -59,9 +61,39 @@ DEFINE_POOL_METHOD(inline void)::ResizeFor(size_t index)
 	this->data = ReallocT(this->data, new_size);
 	MemSetT(this->data + this->size, 0, new_size - this->size);
 
+	/* Bits of indexes beyond the old size were never set, so only the new words need clearing. */
+	size_t old_words = CeilDivT<size_t>(this->size, BITMAP_BITS);
+	size_t new_words = CeilDivT<size_t>(new_size, BITMAP_BITS);
+	this->used = ReallocT(this->used, new_words);
+	MemSetT(this->used + old_words, 0, new_words - old_words);
+
+	size_t old_full_words = CeilDivT<size_t>(old_words, BITMAP_BITS);
+	size_t new_full_words = CeilDivT<size_t>(new_words, BITMAP_BITS);
+	this->full = ReallocT(this->full, new_full_words);
+	MemSetT(this->full + old_full_words, 0, new_full_words - old_full_words);
+
 	this->size = new_size;
 }
 
+/**
+ * Searches for the first word of the occupancy bitmap that has a free index
+ * @param word word to start searching at
+ * @return first word not lower than \a word with a free index, or the number of words when there is none
+ */
+DEFINE_POOL_METHOD(inline size_t)::FindFreeWord(size_t word)
+{
+	size_t num_words = CeilDivT<size_t>(this->size, BITMAP_BITS);
+
+	while (word < num_words) {
+		size_t full_word = word / BITMAP_BITS;
+		uint64 free_words = ~this->full[full_word] & (~(uint64)0 << (word % BITMAP_BITS));
+		if (free_words != 0) return min(full_word * BITMAP_BITS + FindFirstBit64(free_words), num_words);
+		word = (full_word + 1) * BITMAP_BITS;
+	}
+
+	return num_words;
+}
+
 /**
  * Searches for first free index
  * @return first free index, NO_FREE_ITEM on failure
@@ -70,8 +102,17 @@ DEFINE_POOL_METHOD(inline size_t)::FindFirstFree()
 {
 	size_t index = this->first_free;
 
-	for (; index < this->first_unused; index++) {
-		if (this->data[index] == nullptr) return index;
+	if (index < this->first_unused) {
+		/* Look in the word of first_free, then skip all words that are completely used. */
+		size_t word = index / BITMAP_BITS;
+		uint64 free_bits = ~this->used[word] & (~(uint64)0 << (index % BITMAP_BITS));
+		if (free_bits == 0) {
+			word = this->FindFreeWord(word + 1);
+			if (word < CeilDivT<size_t>(this->size, BITMAP_BITS)) free_bits = ~this->used[word];
+		}
+		/* Indexes from first_unused on are free too, but their bits may be in the found word. */
+		index = free_bits == 0 ? this->first_unused : min(word * BITMAP_BITS + FindFirstBit64(free_bits), this->first_unused);
+		if (index < this->first_unused) return index;
 	}
 
 	if (index < this->size) {
@@ -122,6 +163,10 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	}
 	this->data[index] = item;
 	item->index = (Tindex)(uint)index;
+
+	uint64 &bits = this->used[index / BITMAP_BITS];
+	SetBit(bits, index % BITMAP_BITS);
+	if (bits == ~(uint64)0) SetBit(this->full[index / (BITMAP_BITS * BITMAP_BITS)], (index / BITMAP_BITS) % BITMAP_BITS);
 	return item;
 }
 
@@ -187,6 +232,8 @@ DEFINE_POOL_METHOD(void)::FreeItem(size_t index)
 		free(this->data[index]);
 	}
 	this->data[index] = nullptr;
+	ClrBit(this->used[index / BITMAP_BITS], index % BITMAP_BITS);
+	ClrBit(this->full[index / (BITMAP_BITS * BITMAP_BITS)], (index / BITMAP_BITS) % BITMAP_BITS);
 	this->first_free = min(this->first_free, index);
 	this->items--;
 	if (!this->cleaning) Titem::PostDestructor(index);
@@ -202,8 +249,12 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 	}
 	assert(this->items == 0);
 	free(this->data);
+	free(this->used);
+	free(this->full);
 	this->first_unused = this->first_free = this->size = 0;
 	this->data = nullptr;
+	this->used = nullptr;
+	this->full = nullptr;
 	this->cleaning = false;
 
 	if (Tcache) {
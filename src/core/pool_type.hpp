@@ -14,6 +14,7 @@
 
 #include "smallvec_type.hpp"
 #include "enum_type.hpp"
+#include "bitmath_func.hpp"
 
 /** Various types of a pool. */
 enum PoolType {
@@ -85,6 +86,7 @@ struct Pool : PoolBase {
 	assert_compile((uint64)(Tmax_size - 1) >> 8 * sizeof(Tindex) == 0);
 
 	static const size_t MAX_SIZE = Tmax_size; ///< Make template parameter accessible from outside
+	static const size_t BITMAP_BITS = 64;     ///< Number of indexes covered by one word of the occupancy bitmaps
 
 	const char * const name; ///< Name of this pool
 
@@ -98,6 +100,8 @@ struct Pool : PoolBase {
 	bool cleaning;       ///< True if cleaning pool (deleting all items)
 
 	Titem **data;        ///< Pointer to array of pointers to Titem
+	uint64 *used;        ///< Bitmap of the used indexes, one bit per index up to #size
+	uint64 *full;        ///< Bitmap of the words of #used that have all their bits set, to find free indexes quickly
 
 	Pool(const char *name);
 	virtual void CleanPool();
@@ -124,6 +128,27 @@ struct Pool : PoolBase {
 		return index < this->first_unused && this->Get(index) != nullptr;
 	}
 
+	/**
+	 * Finds the first used index from the given one on, skipping the free indexes with the bitmap.
+	 * @param index index to start searching at
+	 * @return first used index not lower than \a index, or #first_unused when there is none
+	 */
+	inline size_t FindNextUsed(size_t index) const
+	{
+		if (index >= this->first_unused) return this->first_unused;
+
+		size_t word = index / BITMAP_BITS;
+		uint64 bits = this->used[word] >> (index % BITMAP_BITS);
+		/* Consecutive used indexes are the common case in dense pools. */
+		if ((bits & 1) != 0) return index;
+		bits <<= index % BITMAP_BITS;
+		while (bits == 0) {
+			if (++word * BITMAP_BITS >= this->first_unused) return this->first_unused;
+			bits = this->used[word];
+		}
+		return word * BITMAP_BITS + FindFirstBit64(bits);
+	}
+
 	/**
 	 * Tests whether we can allocate 'n' items
 	 * @param n number of items we want to allocate
@@ -259,6 +284,70 @@ struct Pool : PoolBase {
 			return index < Tpool->first_unused ? Tpool->Get(index) : nullptr;
 		}
 
+		/**
+		 * Returns the first valid index from the given one on.
+		 * @param index index to start searching at
+		 * @return first valid index not lower than \a index, or GetPoolSize() when there is none
+		 */
+		static inline size_t GetNextValidIndex(size_t index)
+		{
+			return Tpool->FindNextUsed(index);
+		}
+
+		/**
+		 * Iterator over the valid items of the pool, in order of their index.
+		 * Deleting the current item or adding items while iterating is allowed.
+		 * @tparam T Type of the returned items, Titem or one of its subclasses.
+		 */
+		template <class T>
+		struct PoolIterator {
+			size_t index; ///< Index of the current item
+
+			/**
+			 * Create an iterator at the first valid item from the given index on.
+			 * @param index index to start at
+			 */
+			explicit PoolIterator(size_t index) : index(Tpool->FindNextUsed(index)) {}
+
+			/**
+			 * Checks whether the end of the pool has not been reached yet. The end is
+			 * always the current end of the pool, as it may grow while iterating.
+			 * @return true iff this iterator points to a valid item
+			 */
+			bool operator !=(const PoolIterator &) const { return this->index < Tpool->first_unused; }
+
+			T *operator *() const { return (T *)Tpool->Get(this->index); }
+
+			PoolIterator &operator ++()
+			{
+				this->index = Tpool->FindNextUsed(this->index + 1);
+				return *this;
+			}
+		};
+
+		/**
+		 * Range of the valid items of the pool, for use in range-based for loops.
+		 * @tparam T Type of the returned items, Titem or one of its subclasses.
+		 */
+		template <class T>
+		struct IterateWrapper {
+			size_t from; ///< Index to start iterating at
+
+			IterateWrapper(size_t from) : from(from) {}
+			PoolIterator<T> begin() { return PoolIterator<T>(this->from); }
+			PoolIterator<T> end() { return PoolIterator<T>(Tpool->first_unused); }
+		};
+
+		/**
+		 * Returns a range over all valid items of the pool.
+		 * @param from index to start iterating at
+		 * @return the range, e.g. for (Town *t : Town::Iterate()) { ... }
+		 */
+		static inline IterateWrapper<Titem> Iterate(size_t from = 0)
+		{
+			return IterateWrapper<Titem>(from);
+		}
+
 		/**
 		 * Returns first unused index. Useful when iterating over
 		 * all pool items.
@@ -312,6 +401,7 @@ private:
 
 	void *AllocateItem(size_t size, size_t index);
 	void ResizeFor(size_t index);
+	size_t FindFreeWord(size_t word);
 	size_t FindFirstFree();
 
 	void *GetNew(size_t size);
@@ -321,7 +411,7 @@ private:
 };
 
 #define FOR_ALL_ITEMS_FROM(type, iter, var, start) \
-	for (size_t iter = start; var = nullptr, iter < type::GetPoolSize(); iter++) \
+	for (size_t iter = type::GetNextValidIndex(start); var = nullptr, iter < type::GetPoolSize(); iter = type::GetNextValidIndex(iter + 1)) \
 		if ((var = type::Get(iter)) != nullptr)
 
 #define FOR_ALL_ITEMS(type, iter, var) FOR_ALL_ITEMS_FROM(type, iter, var, 0)
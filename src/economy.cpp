@@ -52,6 +52,7 @@
 #include "story_base.h"
 #include "linkgraph/refresh.h"
 #include "tbtr_template_vehicle.h"
+#include "vehiclelist.h"
 
 #include "table/strings.h"
 #include "table/pricebase.h"
@@ -294,6 +295,8 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 	 * the client. This is needed as it needs to know whether "you" really
 	 * are the current local company. */
 	Backup<CompanyByte> cur_company(_current_company, old_owner, FILE_LINE);
+
+	InvalidateVehicleListIndex();
 #ifdef ENABLE_NETWORK
 	/* In all cases, make spectators of clients connected to that company */
 	if (_networking) NetworkClientsToSpectators(old_owner);
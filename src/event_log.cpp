@@ -0,0 +1,500 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file event_log.cpp Recording structured events into a binary file and decoding such files. */
+
+#include "stdafx.h"
+#include "event_log.h"
+#include "date_func.h"
+#include "fileio_func.h"
+#include "gfx_func.h"
+#include "string_func.h"
+#include "debug.h"
+#include "thread/thread.h"
+#include "core/math_func.hpp"
+
+#include <chrono>
+
+#include "safeguards.h"
+
+/*
+ * An event log starts with the magic "OTTDEVTL", a 32 bit version, the
+ * steady clock time in microseconds the log was started at (64), the
+ * wall clock time it was started at in seconds since the epoch (64) and
+ * the recorded categories (32). Then the known events follow as their
+ * count (16) and for each event its id (16), its name and the names of
+ * its arguments, all strings as length (8) and bytes. Every record follows
+ * as: steady clock time (64), event (16), thread slot (16), date (32) and
+ * the arguments (4 * 32). All numbers are little endian.
+ */
+
+static const char EVENT_LOG_MAGIC[8] = { 'O', 'T', 'T', 'D', 'E', 'V', 'T', 'L' };
+static const uint32 EVENT_LOG_VERSION = 1;
+static const size_t EVENT_LOG_HEADER_SIZE = sizeof(EVENT_LOG_MAGIC) + 4 + 8 + 8 + 4 + 2; ///< Size of the header without the events.
+static const size_t EVENT_LOG_RECORD_SIZE = 8 + 2 + 2 + 4 + 4 * EVENT_LOG_ARGS;       ///< Size of a record.
+
+static const uint EVENT_LOG_RING_SIZE = 1 << 14;      ///< Number of records in the ring buffer of a thread, must be a power of 2.
+static const int EVENT_LOG_FLUSH_INTERVAL = 100;      ///< Milliseconds between two writes of the ring buffers to the file.
+
+/** Names of the categories, in the order of #EventLogCategory. */
+static const char * const _event_log_category_names[] = {
+	"event_log",
+	"game",
+	"pathfinder",
+	"network",
+	"command",
+};
+assert_compile(lengthof(_event_log_category_names) == ELC_END);
+
+/** Description of an event, stored in the log so it can be decoded without knowing the events. */
+struct EventLogEventInfo {
+	EventLogEvent event;               ///< The event.
+	const char *name;                  ///< Name of the event.
+	const char *args[EVENT_LOG_ARGS];  ///< Names of the arguments, nullptr for unused arguments.
+};
+
+/** All known events. */
+static const EventLogEventInfo _event_log_events[] = {
+	{ ELE_LOG_DROPPED,        "log_dropped",        { "thread", "records" } },
+	{ ELE_GAME_TICK,          "game_tick",          { "tick", "us" } },
+	{ ELE_PF_YAPF_FOUND,      "yapf_found",         { "vehicle", "steps", "nodes", "us" } },
+	{ ELE_PF_YAPF_NOT_FOUND,  "yapf_not_found",     { "vehicle", "steps", "nodes", "us" } },
+	{ ELE_NET_CLIENT_JOINED,  "net_client_joined",  { "client", "frame" } },
+	{ ELE_NET_CLIENT_QUIT,    "net_client_quit",    { "client", "frame" } },
+	{ ELE_NET_CLIENT_ERROR,   "net_client_error",   { "client", "error", "frame" } },
+	{ ELE_NET_COMMAND_QUEUED, "net_command_queued", { "client", "cmd", "company", "frame" } },
+	{ ELE_NET_SEND,           "net_send",           { "bytes", "packets", "queued" } },
+	{ ELE_CMD_EXECUTED,       "cmd_executed",       { "cmd", "tile", "company", "cycles" } },
+	{ ELE_CMD_FAILED,         "cmd_failed",         { "cmd", "tile", "company", "cycles" } },
+};
+
+/** A recorded event, before it is written to the file. */
+struct EventLogRecord {
+	uint64 time;                 ///< Steady clock time in microseconds.
+	uint16 event;                ///< The #EventLogEvent.
+	uint16 thread;               ///< Slot of the thread that recorded the event.
+	int32 date;                  ///< Game date when the event was recorded.
+	uint32 args[EVENT_LOG_ARGS]; ///< Arguments of the event.
+};
+
+/**
+ * Ring buffer of the records of a single thread. Only the owning thread
+ * adds records and only the writer thread removes them, so no locking is
+ * needed. Rings are never freed; when a thread ends its ring is taken
+ * over by the next thread that records an event.
+ */
+struct EventLogRing {
+	EventLogRecord records[EVENT_LOG_RING_SIZE]; ///< The records.
+	std::atomic<uint32> head;    ///< Number of records ever added, only changed by the owner.
+	std::atomic<uint32> tail;    ///< Number of records ever removed, only changed by the writer.
+	std::atomic<uint32> dropped; ///< Number of records dropped since the last write.
+	std::atomic<bool> owned;     ///< Whether a thread owns the ring.
+	uint16 slot;                 ///< Slot of the ring, written as the thread of its records.
+	EventLogRing *next;          ///< Next ring of the list of all rings.
+};
+
+/** Keeps the ring of a thread and hands it back when the thread ends. */
+struct EventLogThread {
+	EventLogRing *ring; ///< The ring of the thread, if it recorded anything.
+
+	~EventLogThread()
+	{
+		if (this->ring != nullptr) this->ring->owned.store(false, std::memory_order_release);
+	}
+};
+
+std::atomic<uint32> _event_log_categories(0);        ///< Bitmask of the categories being recorded.
+
+static std::atomic<EventLogRing *> _event_log_rings(nullptr); ///< All rings.
+static std::atomic<uint16> _event_log_ring_count(0);          ///< Number of rings.
+static thread_local EventLogThread _event_log_thread;         ///< The ring of the current thread.
+
+static FILE *_event_log_file = nullptr;               ///< The log being written, if any.
+static ThreadObject *_event_log_writer = nullptr;     ///< The thread writing the rings to the file.
+static std::atomic<bool> _event_log_running(false);   ///< Whether the writer thread should continue.
+
+/**
+ * Get the current time of the steady clock, as used for the time of records.
+ * @return Time in microseconds.
+ */
+uint64 GetEventLogTime()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Write a little endian number to a buffer.
+ * @param p Position to write to, moved beyond the number.
+ * @param value Value to write.
+ * @param bytes Number of bytes of the value to write.
+ */
+static inline void WriteEventLogValue(byte *&p, uint64 value, uint bytes)
+{
+	for (uint i = 0; i < bytes; i++) *p++ = GB(value, i * 8, 8);
+}
+
+/**
+ * Read a little endian number from a buffer.
+ * @param p Position to read from, moved beyond the number.
+ * @param bytes Number of bytes of the value.
+ * @return The value.
+ */
+static inline uint64 ReadEventLogValue(const byte *&p, uint bytes)
+{
+	uint64 value = 0;
+	for (uint i = 0; i < bytes; i++) value |= (uint64)*p++ << (i * 8);
+	return value;
+}
+
+/**
+ * Get a ring for the current thread; reuse the ring of an ended thread, or add a new ring.
+ * @return The ring, owned by the current thread.
+ */
+static EventLogRing *AcquireEventLogRing()
+{
+	for (EventLogRing *ring = _event_log_rings.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+		bool owned = false;
+		if (ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) return ring;
+	}
+
+	EventLogRing *ring = new EventLogRing();
+	ring->head.store(0, std::memory_order_relaxed);
+	ring->tail.store(0, std::memory_order_relaxed);
+	ring->dropped.store(0, std::memory_order_relaxed);
+	ring->owned.store(true, std::memory_order_relaxed);
+	ring->slot = _event_log_ring_count.fetch_add(1, std::memory_order_relaxed);
+	ring->next = _event_log_rings.load(std::memory_order_relaxed);
+	while (!_event_log_rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {}
+	return ring;
+}
+
+/**
+ * Record an event in the ring of the current thread. Use #EVENT_LOG instead, so nothing is done when the category is not recorded.
+ * @param event The event.
+ * @param a First argument.
+ * @param b Second argument.
+ * @param c Third argument.
+ * @param d Fourth argument.
+ */
+void LogEvent(EventLogEvent event, uint32 a, uint32 b, uint32 c, uint32 d)
+{
+	EventLogRing *ring = _event_log_thread.ring;
+	if (ring == nullptr) ring = _event_log_thread.ring = AcquireEventLogRing();
+
+	uint32 head = ring->head.load(std::memory_order_relaxed);
+	if (head - ring->tail.load(std::memory_order_acquire) == EVENT_LOG_RING_SIZE) {
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	EventLogRecord &record = ring->records[head & (EVENT_LOG_RING_SIZE - 1)];
+	record.time = GetEventLogTime();
+	record.event = event;
+	record.thread = ring->slot;
+	record.date = _date;
+	record.args[0] = a;
+	record.args[1] = b;
+	record.args[2] = c;
+	record.args[3] = d;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * Serialise a record.
+ * @param p Position to write to, moved beyond the record.
+ * @param record The record.
+ */
+static void WriteEventLogRecord(byte *&p, const EventLogRecord &record)
+{
+	WriteEventLogValue(p, record.time, 8);
+	WriteEventLogValue(p, record.event, 2);
+	WriteEventLogValue(p, record.thread, 2);
+	WriteEventLogValue(p, (uint32)record.date, 4);
+	for (uint i = 0; i < EVENT_LOG_ARGS; i++) WriteEventLogValue(p, record.args[i], 4);
+}
+
+/**
+ * Move the records of all rings to the file.
+ * @param write Whether to write the records, or to discard them.
+ * @return Whether writing succeeded.
+ */
+static bool DrainEventLogRings(bool write)
+{
+	static byte buffer[(EVENT_LOG_RING_SIZE + 1) * EVENT_LOG_RECORD_SIZE];
+
+	bool ok = true;
+	for (EventLogRing *ring = _event_log_rings.load(std::memory_order_acquire); ring != nullptr; ring = ring->next) {
+		uint32 tail = ring->tail.load(std::memory_order_relaxed);
+		uint32 head = ring->head.load(std::memory_order_acquire);
+		uint32 dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+		if (!write) {
+			ring->tail.store(head, std::memory_order_release);
+			continue;
+		}
+
+		byte *p = buffer;
+		for (uint32 i = tail; i != head; i++) WriteEventLogRecord(p, ring->records[i & (EVENT_LOG_RING_SIZE - 1)]);
+		/* The records have been copied, so the owner may overwrite them. */
+		ring->tail.store(head, std::memory_order_release);
+
+		if (dropped != 0) {
+			EventLogRecord record = { GetEventLogTime(), ELE_LOG_DROPPED, ring->slot, _date, { ring->slot, dropped, 0, 0 } };
+			WriteEventLogRecord(p, record);
+		}
+		if (p != buffer) ok &= fwrite(buffer, 1, p - buffer, _event_log_file) == (size_t)(p - buffer);
+	}
+	return ok;
+}
+
+/** Thread writing the rings to the file until the log is stopped. */
+static void EventLogWriterThread(void *)
+{
+	bool ok = true;
+	while (_event_log_running.load(std::memory_order_acquire)) {
+		if (ok && !DrainEventLogRings(true)) {
+			DEBUG(misc, 0, "Writing the event log failed, discarding further events");
+			ok = false;
+		}
+		if (!ok) DrainEventLogRings(false);
+		CSleep(EVENT_LOG_FLUSH_INTERVAL);
+	}
+	DrainEventLogRings(ok);
+}
+
+/**
+ * Write a string to the header of the log.
+ * @param f The log.
+ * @param str The string, nullptr for an empty string.
+ */
+static void WriteEventLogString(FILE *f, const char *str)
+{
+	size_t length = str == nullptr ? 0 : min<size_t>(strlen(str), 255);
+	fputc((int)length, f);
+	if (length != 0) fwrite(str, 1, length, f);
+}
+
+/**
+ * Start recording events, replacing a log that is being recorded.
+ * @param filename File to record to, relative to the autosave directory.
+ * @param categories Bitmask of the #EventLogCategory to record.
+ * @return Whether the file could be created and the writer could be started.
+ */
+bool StartEventLog(const char *filename, uint32 categories)
+{
+	StopEventLog();
+
+	_event_log_file = FioFOpenFile(filename, "wb", AUTOSAVE_DIR);
+	if (_event_log_file == nullptr) return false;
+
+	/* Records of a former log that were added after it was stopped. */
+	DrainEventLogRings(false);
+
+	byte header[EVENT_LOG_HEADER_SIZE];
+	memcpy(header, EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC));
+	byte *p = header + sizeof(EVENT_LOG_MAGIC);
+	WriteEventLogValue(p, EVENT_LOG_VERSION, 4);
+	WriteEventLogValue(p, GetEventLogTime(), 8);
+	WriteEventLogValue(p, (uint64)time(nullptr), 8);
+	WriteEventLogValue(p, categories, 4);
+	WriteEventLogValue(p, lengthof(_event_log_events), 2);
+	assert(p == header + EVENT_LOG_HEADER_SIZE);
+	fwrite(header, 1, sizeof(header), _event_log_file);
+
+	for (const EventLogEventInfo *info = _event_log_events; info != endof(_event_log_events); info++) {
+		byte id[2];
+		p = id;
+		WriteEventLogValue(p, info->event, 2);
+		fwrite(id, 1, sizeof(id), _event_log_file);
+		WriteEventLogString(_event_log_file, info->name);
+		for (uint i = 0; i < EVENT_LOG_ARGS; i++) WriteEventLogString(_event_log_file, info->args[i]);
+	}
+
+	_event_log_running.store(true, std::memory_order_release);
+	if (!ThreadObject::New(&EventLogWriterThread, nullptr, &_event_log_writer, "ottd:eventlog")) {
+		_event_log_writer = nullptr;
+		_event_log_running.store(false, std::memory_order_relaxed);
+		FioFCloseFile(_event_log_file);
+		_event_log_file = nullptr;
+		DEBUG(misc, 0, "Cannot start the event log writer");
+		return false;
+	}
+
+	_event_log_categories.store(categories, std::memory_order_release);
+	DEBUG(misc, 1, "Recording events to %s", filename);
+	return true;
+}
+
+/** Stop recording events, and write the remaining records. */
+void StopEventLog()
+{
+	if (_event_log_file == nullptr) return;
+
+	_event_log_categories.store(0, std::memory_order_release);
+	_event_log_running.store(false, std::memory_order_release);
+	_event_log_writer->Join();
+	delete _event_log_writer;
+	_event_log_writer = nullptr;
+
+	FioFCloseFile(_event_log_file);
+	_event_log_file = nullptr;
+}
+
+/**
+ * Are events being recorded?
+ * @return True iff a log is being written.
+ */
+bool IsEventLogActive()
+{
+	return _event_log_file != nullptr;
+}
+
+/**
+ * Get the categories named in a comma separated list.
+ * @param names The names of the categories, or "all".
+ * @param[out] categories Bitmask of the named categories.
+ * @return False if a name is unknown.
+ */
+bool GetEventLogCategories(const char *names, uint32 *categories)
+{
+	*categories = 0;
+
+	char buffer[256];
+	strecpy(buffer, names, lastof(buffer));
+	for (char *name = buffer; name != nullptr;) {
+		char *next = strchr(name, ',');
+		if (next != nullptr) *next++ = '\0';
+
+		if (strcmp(name, "all") == 0) {
+			*categories = (1 << ELC_END) - 1;
+		} else {
+			uint i = 0;
+			while (i != ELC_END && strcmp(name, _event_log_category_names[i]) != 0) i++;
+			if (i == ELC_END) return false;
+			SetBit(*categories, i);
+		}
+		name = next;
+	}
+	return *categories != 0;
+}
+
+/**
+ * Read a string from the header of a log.
+ * @param f The log.
+ * @param[out] str The string.
+ * @return False if the log is truncated.
+ */
+static bool ReadEventLogString(FILE *f, std::string &str)
+{
+	int length = fgetc(f);
+	if (length == EOF) return false;
+
+	char buffer[256];
+	if (length != 0 && fread(buffer, 1, length, f) != (size_t)length) return false;
+	str.assign(buffer, length);
+	return true;
+}
+
+/** An event as described by the header of a log. */
+struct EventLogDecodedEventInfo {
+	uint16 event;                         ///< The #EventLogEvent.
+	std::string args[EVENT_LOG_ARGS];     ///< Names of the arguments, empty for unused arguments.
+};
+
+/**
+ * Write the records of a log as text.
+ * Events are described by the header of the log, so logs of other versions can be decoded too.
+ * @param filename The log, relative to the autosave directory.
+ * @param output File to write the text to, relative to the autosave directory.
+ * @param[out] result Number of records per event.
+ * @return False if the file is not an event log, or the output cannot be created.
+ */
+bool DecodeEventLog(const char *filename, const char *output, EventLogDecodeResult *result)
+{
+	FILE *f = FioFOpenFile(filename, "rb", AUTOSAVE_DIR);
+	if (f == nullptr) return false;
+
+	byte header[EVENT_LOG_HEADER_SIZE];
+	const byte *p = header + sizeof(EVENT_LOG_MAGIC);
+	if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC)) != 0 ||
+			ReadEventLogValue(p, 4) != EVENT_LOG_VERSION) {
+		FioFCloseFile(f);
+		return false;
+	}
+	uint64 start_time = ReadEventLogValue(p, 8);
+	uint64 start_wall_time = ReadEventLogValue(p, 8);
+	uint32 categories = (uint32)ReadEventLogValue(p, 4);
+	uint num_events = (uint)ReadEventLogValue(p, 2);
+
+	result->records = 0;
+	result->dropped = 0;
+	result->events.clear();
+
+	std::vector<EventLogDecodedEventInfo> infos(num_events);
+	for (uint i = 0; i < num_events; i++) {
+		byte id[2];
+		EventLogDecodedEvent decoded;
+		decoded.count = 0;
+		bool ok = fread(id, 1, sizeof(id), f) == sizeof(id) && ReadEventLogString(f, decoded.name);
+		for (uint j = 0; ok && j < EVENT_LOG_ARGS; j++) ok = ReadEventLogString(f, infos[i].args[j]);
+		if (!ok) {
+			FioFCloseFile(f);
+			return false;
+		}
+		p = id;
+		infos[i].event = (uint16)ReadEventLogValue(p, 2);
+		result->events.push_back(decoded);
+	}
+
+	FILE *out = FioFOpenFile(output, "w", AUTOSAVE_DIR);
+	if (out == nullptr) {
+		FioFCloseFile(f);
+		return false;
+	}
+
+	time_t wall_time = (time_t)start_wall_time;
+	char time_str[64];
+	strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", gmtime(&wall_time));
+	fprintf(out, "# Event log started at %s UTC, categories 0x%X\n", time_str, categories);
+	fprintf(out, "# seconds     date       thread event\n");
+
+	byte buffer[EVENT_LOG_RECORD_SIZE];
+	while (fread(buffer, 1, sizeof(buffer), f) == sizeof(buffer)) {
+		p = buffer;
+		uint64 record_time = ReadEventLogValue(p, 8);
+		uint16 event = (uint16)ReadEventLogValue(p, 2);
+		uint thread = (uint)ReadEventLogValue(p, 2);
+		YearMonthDay ymd;
+		ConvertDateToYMD((Date)(int32)ReadEventLogValue(p, 4), &ymd);
+		uint32 args[EVENT_LOG_ARGS];
+		for (uint i = 0; i < EVENT_LOG_ARGS; i++) args[i] = (uint32)ReadEventLogValue(p, 4);
+
+		uint i = 0;
+		while (i != num_events && infos[i].event != event) i++;
+		result->records++;
+
+		fprintf(out, "%12.6f %04d-%02d-%02d %6u ", (double)(int64)(record_time - start_time) / 1000000, ymd.year, ymd.month + 1, ymd.day, thread);
+		if (i == num_events) {
+			fprintf(out, "event_%u %u %u %u %u\n", event, args[0], args[1], args[2], args[3]);
+			continue;
+		}
+
+		fputs(result->events[i].name.c_str(), out);
+		for (uint j = 0; j < EVENT_LOG_ARGS; j++) {
+			if (!infos[i].args[j].empty()) fprintf(out, " %s=%u", infos[i].args[j].c_str(), args[j]);
+		}
+		fputc('\n', out);
+
+		result->events[i].count++;
+		if (event == ELE_LOG_DROPPED) result->dropped += args[1];
+	}
+
+	FioFCloseFile(out);
+	FioFCloseFile(f);
+	return true;
+}
@@ -0,0 +1,100 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file event_log.h Recording structured events into a binary file and decoding such files. */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "core/bitmath_func.hpp"
+#include <atomic>
+#include <string>
+#include <vector>
+
+/** Categories of events; each can be recorded separately. */
+enum EventLogCategory {
+	ELC_EVENT_LOG,  ///< Events of the event log itself.
+	ELC_GAME,       ///< Game loop.
+	ELC_PATHFINDER, ///< Pathfinder runs.
+	ELC_NETWORK,    ///< Network connections and traffic.
+	ELC_COMMAND,    ///< Executed commands.
+	ELC_END,        ///< End marker.
+};
+
+/** Events that can be recorded; the category of an event is in its upper byte. */
+enum EventLogEvent {
+	ELE_LOG_DROPPED          = ELC_EVENT_LOG << 8,  ///< Records were dropped as a ring buffer was full.
+
+	ELE_GAME_TICK            = ELC_GAME << 8,       ///< A game tick has run.
+
+	ELE_PF_YAPF_FOUND        = ELC_PATHFINDER << 8, ///< YAPF found a path.
+	ELE_PF_YAPF_NOT_FOUND,                          ///< YAPF did not find a path.
+
+	ELE_NET_CLIENT_JOINED    = ELC_NETWORK << 8,    ///< A client has joined the server.
+	ELE_NET_CLIENT_QUIT,                            ///< A client has left the server.
+	ELE_NET_CLIENT_ERROR,                           ///< A client has been disconnected due to an error.
+	ELE_NET_COMMAND_QUEUED,                         ///< The server queued a command of a client.
+	ELE_NET_SEND,                                   ///< Packets have been sent over a TCP connection.
+
+	ELE_CMD_EXECUTED         = ELC_COMMAND << 8,    ///< A command succeeded.
+	ELE_CMD_FAILED,                                 ///< A command failed.
+};
+
+static const uint EVENT_LOG_ARGS = 4; ///< Number of arguments of every event.
+
+/**
+ * Get the category of an event.
+ * @param event The event.
+ * @return The category of the event.
+ */
+static inline EventLogCategory GetEventLogCategory(EventLogEvent event)
+{
+	return (EventLogCategory)(event >> 8);
+}
+
+extern std::atomic<uint32> _event_log_categories;
+
+#ifdef NO_EVENT_LOG
+	#define EVENT_LOG(event, a, b, c, d) { }
+#else /* NO_EVENT_LOG */
+	/**
+	 * Record an event when its category is being recorded. The arguments are only evaluated in that case.
+	 * @param event The #EventLogEvent.
+	 * @param a First argument.
+	 * @param b Second argument.
+	 * @param c Third argument.
+	 * @param d Fourth argument.
+	 */
+	#define EVENT_LOG(event, a, b, c, d) if (HasBit(_event_log_categories.load(std::memory_order_relaxed), GetEventLogCategory(event))) LogEvent(event, a, b, c, d)
+#endif /* NO_EVENT_LOG */
+
+void LogEvent(EventLogEvent event, uint32 a, uint32 b, uint32 c, uint32 d);
+uint64 GetEventLogTime();
+
+bool StartEventLog(const char *filename, uint32 categories);
+void StopEventLog();
+bool IsEventLogActive();
+bool GetEventLogCategories(const char *names, uint32 *categories);
+
+/** Number of records of an event in a decoded log. */
+struct EventLogDecodedEvent {
+	std::string name; ///< Name of the event.
+	uint count;       ///< Number of records.
+};
+
+/** Outcome of decoding a log. */
+struct EventLogDecodeResult {
+	uint records;                             ///< Number of decoded records.
+	uint dropped;                             ///< Number of records that were dropped while recording.
+	std::vector<EventLogDecodedEvent> events; ///< Counts per event, in the order of the log.
+};
+
+bool DecodeEventLog(const char *filename, const char *output, EventLogDecodeResult *result);
+
+#endif /* EVENT_LOG_H */
@@ -24,8 +24,15 @@
 #include "safeguards.h"
 
 
-/** Cache of ParagraphLayout lines. */
-Layouter::LineCache *Layouter::linecache;
+/** Most recently used item of the linecache. */
+Layouter::LineCacheItem *Layouter::linecache_lru_first;
+/** Least recently used item of the linecache. */
+Layouter::LineCacheItem *Layouter::linecache_lru_last;
+/** Usage statistics of the linecache. */
+Layouter::LineCacheStats Layouter::linecache_stats;
+
+/** Memory in KiB the linecache may use. */
+uint32 _line_cache_size;
 
 /** Cache of Font instances. */
 Layouter::FontColourMap Layouter::fonts[FS_END];
@@ -567,16 +574,19 @@ static FallbackParagraphLayout *GetParagraphLayout(WChar *buff, WChar *buff_end,
  * @note In case no ParagraphLayouter could be constructed, line.layout will be nullptr.
  * @param line The cache item to store our layouter in.
  * @param str The string to create a layouter for.
+ * @param len Length of the line in \a str in bytes.
  * @param state The state of the font and color.
  * @tparam T The type of layouter we want.
  */
 template <typename T>
-static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str, FontState &state)
+static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str, size_t len, FontState &state)
 {
 	if (line.buffer != nullptr) free(line.buffer);
 
-	typename T::CharType *buff_begin = MallocT<typename T::CharType>(DRAW_STRING_BUFFER);
-	const typename T::CharType *buffer_last = buff_begin + DRAW_STRING_BUFFER;
+	/* A character never takes more buffer spaces than bytes in the string, so the terminator always fits. */
+	size_t buffer_size = min<size_t>(len + 1, DRAW_STRING_BUFFER);
+	typename T::CharType *buff_begin = MallocT<typename T::CharType>(buffer_size);
+	const typename T::CharType *buffer_last = buff_begin + buffer_size;
 	typename T::CharType *buff = buff_begin;
 	FontMap &fontMapping = line.runs;
 	Font *f = Layouter::GetFont(state.fontsize, state.cur_colour);
@@ -623,6 +633,7 @@ static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str,
 	}
 	line.layout = GetParagraphLayout(buff_begin, buff, fontMapping);
 	line.state_after = state;
+	line.bytes = buffer_size * sizeof(*buff_begin) + fontMapping.Length() * sizeof(*fontMapping.Begin()) + sizeof(T);
 }
 
 /**
@@ -646,6 +657,9 @@ Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsi
 			lineend += len;
 		}
 
+		/* Keep the lock until the lines are copied, as a cached layout is reused for every copy. */
+		ThreadMutexLocker lock(GetLineCacheMutex());
+
 		LineCacheItem& line = GetCachedParagraphLayout(str, lineend - str, state);
 		if (line.layout != nullptr) {
 			/* Line is in cache */
@@ -658,7 +672,7 @@ Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsi
 			FontState old_state = state;
 			const char *old_str = str;
 
-			GetLayouter<ICUParagraphLayout>(line, str, state);
+			GetLayouter<ICUParagraphLayout>(line, str, lineend - str, state);
 			if (line.layout == nullptr) {
 				static bool warned = false;
 				if (!warned) {
@@ -668,11 +682,14 @@ Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsi
 
 				state = old_state;
 				str = old_str;
-				GetLayouter<FallbackParagraphLayout>(line, str, state);
+				GetLayouter<FallbackParagraphLayout>(line, str, lineend - str, state);
 			}
 #else
-			GetLayouter<FallbackParagraphLayout>(line, str, state);
+			GetLayouter<FallbackParagraphLayout>(line, str, lineend - str, state);
 #endif
+			line.bytes += sizeof(LineCache::value_type) + line.key->str.capacity();
+			linecache_stats.bytes += line.bytes;
+			EvictLineCache((size_t)_line_cache_size * 1024, &line);
 		}
 
 		/* Copy all lines into a local cache so we can reuse them later on more easily. */
@@ -785,51 +802,151 @@ const char *Layouter::GetCharAtPosition(int x) const
 
 /**
  * Get a static font instance.
+ * This is mostly called while laying out a line, so the lock of the linecache may already be held.
  */
 Font *Layouter::GetFont(FontSize size, TextColour colour)
 {
+	ThreadMutex *mutex = GetLineCacheMutex();
+	mutex->BeginCritical(true);
+
+	Font *f;
 	FontColourMap::iterator it = fonts[size].Find(colour);
-	if (it != fonts[size].End()) return it->second;
+	if (it != fonts[size].End()) {
+		f = it->second;
+	} else {
+		f = new Font(size, colour);
+		*fonts[size].Append() = FontColourMap::Pair(colour, f);
+	}
 
-	Font *f = new Font(size, colour);
-	*fonts[size].Append() = FontColourMap::Pair(colour, f);
+	mutex->EndCritical(true);
 	return f;
 }
 
 /**
  * Reset cached font information.
+ * The lines of existing Layouters refer to the fonts, so this may only be
+ * called when there are none, i.e. not while text is being drawn.
  * @param size Font size to reset.
  */
 void Layouter::ResetFontCache(FontSize size)
 {
+	ThreadMutexLocker lock(GetLineCacheMutex());
+
 	for (FontColourMap::iterator it = fonts[size].Begin(); it != fonts[size].End(); ++it) {
 		delete it->second;
 	}
 	fonts[size].Clear();
 
 	/* We must reset the linecache since it references the just freed fonts */
-	ResetLineCache();
+	ClearLineCache();
 }
 
 /**
- * Get reference to cache item.
+ * Get the cache of ParagraphLayout lines.
+ * The font caches reset it during static initialisation already, so it is
+ * created at startup. Being a function static, its creation does not depend
+ * on the initialisation order of files and is guarded against races.
+ * @return The linecache.
+ */
+Layouter::LineCache &Layouter::GetLineCache()
+{
+	static LineCache * const linecache = new LineCache();
+	return *linecache;
+}
+
+/**
+ * Get the lock of the linecache, also held while laying out a line as that uses the font caches.
+ * Like the linecache, it is created at startup.
+ * @return The lock.
+ */
+ThreadMutex *Layouter::GetLineCacheMutex()
+{
+	static ThreadMutex * const linecache_mutex = ThreadMutex::New();
+	return linecache_mutex;
+}
+
+/**
+ * Get reference to cache item, and mark it as most recently used.
  * If the item does not exist yet, it is default constructed.
  * @param str Source string of the line (including colour and font size codes).
  * @param len Length of \a str in bytes (no termination).
  * @param state State of the font at the beginning of the line.
  * @return Reference to cache item.
+ * @pre The linecache is locked.
  */
 Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, size_t len, const FontState &state)
 {
-	if (linecache == nullptr) {
-		/* Create linecache on first access to avoid trouble with initialisation order of static variables. */
-		linecache = new LineCache();
-	}
-
 	LineCacheKey key;
 	key.state_before = state;
 	key.str.assign(str, len);
-	return (*linecache)[key];
+	std::pair<LineCache::iterator, bool> result = GetLineCache().emplace(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple());
+
+	LineCacheItem &item = result.first->second;
+	if (result.second) {
+		item.key = &result.first->first;
+		linecache_stats.misses++;
+	} else {
+		UnlinkLineCacheItem(item);
+		linecache_stats.hits++;
+	}
+
+	item.lru_prev = nullptr;
+	item.lru_next = linecache_lru_first;
+	if (linecache_lru_first != nullptr) {
+		linecache_lru_first->lru_prev = &item;
+	} else {
+		linecache_lru_last = &item;
+	}
+	linecache_lru_first = &item;
+	return item;
+}
+
+/**
+ * Remove an item from the list of recently used items.
+ * @param item The item.
+ * @pre The linecache is locked.
+ */
+void Layouter::UnlinkLineCacheItem(LineCacheItem &item)
+{
+	if (item.lru_prev != nullptr) {
+		item.lru_prev->lru_next = item.lru_next;
+	} else {
+		linecache_lru_first = item.lru_next;
+	}
+	if (item.lru_next != nullptr) {
+		item.lru_next->lru_prev = item.lru_prev;
+	} else {
+		linecache_lru_last = item.lru_prev;
+	}
+}
+
+/**
+ * Remove the least recently used items until the linecache fits in its budget.
+ * @param budget Memory in bytes the linecache may use.
+ * @param keep Item that must not be removed, it is in use.
+ * @pre The linecache is locked.
+ */
+void Layouter::EvictLineCache(size_t budget, const LineCacheItem *keep)
+{
+	while (linecache_stats.bytes > budget && linecache_lru_last != nullptr && linecache_lru_last != keep) {
+		LineCacheItem *item = linecache_lru_last;
+		UnlinkLineCacheItem(*item);
+		linecache_stats.bytes -= item->bytes;
+		linecache_stats.evictions++;
+		GetLineCache().erase(GetLineCache().find(*item->key));
+	}
+}
+
+/**
+ * Remove all lines from the line cache.
+ * @pre The linecache is locked.
+ */
+void Layouter::ClearLineCache()
+{
+	GetLineCache().clear();
+	linecache_lru_first = nullptr;
+	linecache_lru_last = nullptr;
+	linecache_stats.bytes = 0;
 }
 
 /**
@@ -837,16 +954,35 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
  */
 void Layouter::ResetLineCache()
 {
-	if (linecache != nullptr) linecache->clear();
+	ThreadMutexLocker lock(GetLineCacheMutex());
+	ClearLineCache();
 }
 
 /**
  * Reduce the size of linecache if necessary to prevent infinite growth.
+ * Lines are already removed when new ones are added, so this only matters after the budget was lowered.
  */
 void Layouter::ReduceLineCache()
 {
-	if (linecache != nullptr) {
-		/* TODO LRU cache would be fancy, but not exactly necessary */
-		if (linecache->size() > 4096) ResetLineCache();
+	ThreadMutexLocker lock(GetLineCacheMutex());
+	EvictLineCache((size_t)_line_cache_size * 1024, nullptr);
+}
+
+/**
+ * Get the usage statistics of the linecache.
+ * @param reset Whether to restart counting the hits, misses and evictions.
+ * @return The statistics.
+ */
+Layouter::LineCacheStats Layouter::GetLineCacheStats(bool reset)
+{
+	ThreadMutexLocker lock(GetLineCacheMutex());
+	LineCacheStats stats = linecache_stats;
+	stats.items = GetLineCache().size();
+	stats.budget = (size_t)_line_cache_size * 1024;
+	if (reset) {
+		linecache_stats.hits = 0;
+		linecache_stats.misses = 0;
+		linecache_stats.evictions = 0;
 	}
+	return stats;
 }
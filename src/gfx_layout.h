@@ -15,9 +15,10 @@
 #include "fontcache.h"
 #include "gfx_func.h"
 #include "core/smallmap_type.hpp"
+#include "thread/thread.h"
 
-#include <map>
 #include <string>
+#include <unordered_map>
 
 #ifdef WITH_ICU_LAYOUT
 #include "layout/ParagraphLayout.h"
@@ -144,13 +145,22 @@ class Layouter : public AutoDeleteSmallVector<const ParagraphLayouter::Line *, 4
 		FontState state_before;  ///< Font state at the beginning of the line.
 		std::string str;         ///< Source string of the line (including colour and font size codes).
 
-		/** Comparison operator for std::map */
-		bool operator<(const LineCacheKey &other) const
+		/** Equality operator for std::unordered_map */
+		bool operator==(const LineCacheKey &other) const
 		{
-			if (this->state_before.fontsize != other.state_before.fontsize) return this->state_before.fontsize < other.state_before.fontsize;
-			if (this->state_before.cur_colour != other.state_before.cur_colour) return this->state_before.cur_colour < other.state_before.cur_colour;
-			if (this->state_before.prev_colour != other.state_before.prev_colour) return this->state_before.prev_colour < other.state_before.prev_colour;
-			return this->str < other.str;
+			return this->state_before.fontsize == other.state_before.fontsize &&
+					this->state_before.cur_colour == other.state_before.cur_colour &&
+					this->state_before.prev_colour == other.state_before.prev_colour &&
+					this->str == other.str;
+		}
+	};
+
+	/** Hash of a key into the linecache */
+	struct LineCacheHash {
+		size_t operator()(const LineCacheKey &key) const
+		{
+			size_t state = key.state_before.fontsize | key.state_before.cur_colour << 4 | key.state_before.prev_colour << 16;
+			return std::hash<std::string>()(key.str) ^ (state * 0x9E3779B9U);
 		}
 	};
 public:
@@ -163,14 +173,36 @@ public:
 		FontState state_after;     ///< Font state after the line.
 		ParagraphLayouter *layout; ///< Layout of the line.
 
-		LineCacheItem() : buffer(nullptr), layout(nullptr) {}
+		size_t bytes;              ///< Estimated memory used by the item, its key and its layout.
+		const LineCacheKey *key;   ///< Key of the item in the linecache.
+		LineCacheItem *lru_prev;   ///< Item that has been used more recently, or nullptr.
+		LineCacheItem *lru_next;   ///< Item that has been used less recently, or nullptr.
+
+		LineCacheItem() : buffer(nullptr), layout(nullptr), bytes(0), key(nullptr), lru_prev(nullptr), lru_next(nullptr) {}
 		~LineCacheItem() { delete layout; free(buffer); }
 	};
-private:
-	typedef std::map<LineCacheKey, LineCacheItem> LineCache;
-	static LineCache *linecache;
 
+	/** Usage statistics of the linecache. */
+	struct LineCacheStats {
+		size_t items;     ///< Number of cached lines.
+		size_t bytes;     ///< Estimated memory used by the cached lines.
+		size_t budget;    ///< Memory the cached lines may use.
+		uint64 hits;      ///< Number of lookups that found their line.
+		uint64 misses;    ///< Number of lookups that had to layout their line.
+		uint64 evictions; ///< Number of lines removed to stay within the budget.
+	};
+private:
+	typedef std::unordered_map<LineCacheKey, LineCacheItem, LineCacheHash> LineCache;
+	static LineCacheItem *linecache_lru_first;
+	static LineCacheItem *linecache_lru_last;
+	static LineCacheStats linecache_stats;
+
+	static LineCache &GetLineCache();
+	static ThreadMutex *GetLineCacheMutex();
+	static void ClearLineCache();
 	static LineCacheItem &GetCachedParagraphLayout(const char *str, size_t len, const FontState &state);
+	static void UnlinkLineCacheItem(LineCacheItem &item);
+	static void EvictLineCache(size_t budget, const LineCacheItem *keep);
 
 	typedef SmallMap<TextColour, Font *> FontColourMap;
 	static FontColourMap fonts[FS_END];
@@ -185,6 +217,9 @@ public:
 	static void ResetFontCache(FontSize size);
 	static void ResetLineCache();
 	static void ReduceLineCache();
+	static LineCacheStats GetLineCacheStats(bool reset);
 };
 
+extern uint32 _line_cache_size;
+
 #endif /* GFX_LAYOUT_H */
@@ -14,6 +14,7 @@
 #include "newgrf.h"
 #include "3rdparty/md5/md5.h"
 #include "fontcache.h"
+#include "spritecache_disk.h"
 #include "gfx_func.h"
 #include "transparency.h"
 #include "blitter/factory.hpp"
@@ -51,14 +52,16 @@ static const SpriteID * const _landscape_spriteindexes[] = {
  * @param filename   The name of the file to open.
  * @param load_index The offset of the first sprite.
  * @param file_index The Fio offset to load the file in.
+ * @param md5sum     The MD5 checksum of the file, if known.
  * @return The number of loaded sprites.
  */
-static uint LoadGrfFile(const char *filename, uint load_index, int file_index)
+static uint LoadGrfFile(const char *filename, uint load_index, int file_index, const uint8 *md5sum = nullptr)
 {
 	uint load_index_org = load_index;
 	uint sprite_id = 0;
 
 	FioOpenFile(file_index, filename, BASESET_DIR);
+	SetSpriteFileMD5(file_index, md5sum);
 
 	DEBUG(sprite, 2, "Reading grf-file '%s'", filename);
 
@@ -88,14 +91,16 @@ static uint LoadGrfFile(const char *filename, uint load_index, int file_index)
  * @param filename   The name of the file to open.
  * @param index_tlb  The offsets of each of the sprites.
  * @param file_index The Fio offset to load the file in.
+ * @param md5sum     The MD5 checksum of the file, if known.
  * @return The number of loaded sprites.
  */
-static void LoadGrfFileIndexed(const char *filename, const SpriteID *index_tbl, int file_index)
+static void LoadGrfFileIndexed(const char *filename, const SpriteID *index_tbl, int file_index, const uint8 *md5sum)
 {
 	uint start;
 	uint sprite_id = 0;
 
 	FioOpenFile(file_index, filename, BASESET_DIR);
+	SetSpriteFileMD5(file_index, md5sum);
 
 	DEBUG(sprite, 2, "Reading indexed grf-file '%s'", filename);
 
@@ -172,9 +177,11 @@ static void LoadSpriteTables()
 	memset(_palette_remap_grf, 0, sizeof(_palette_remap_grf));
 	uint i = FIRST_GRF_SLOT;
 	const GraphicsSet *used_set = BaseGraphics::GetUsedSet();
+	/* The checksums of the base set can only be trusted when the files match them. */
+	const bool trust_md5 = used_set->GetNumInvalid() == 0;
 
 	_palette_remap_grf[i] = (PAL_DOS != used_set->palette);
-	LoadGrfFile(used_set->files[GFT_BASE].filename, 0, i++);
+	LoadGrfFile(used_set->files[GFT_BASE].filename, 0, i++, trust_md5 ? used_set->files[GFT_BASE].hash : nullptr);
 
 	/* Tracerestrict sprites. */
 	LoadGrfFile("tracerestrict.grf", SPR_TRACERESTRICT_BASE, i++);
@@ -186,7 +193,7 @@ static void LoadSpriteTables()
 	 * sprites as they are not shown anyway (logos in intro game).
 	 */
 	_palette_remap_grf[i] = (PAL_DOS != used_set->palette);
-	LoadGrfFile(used_set->files[GFT_LOGOS].filename, 4793, i++);
+	LoadGrfFile(used_set->files[GFT_LOGOS].filename, 4793, i++, trust_md5 ? used_set->files[GFT_LOGOS].hash : nullptr);
 
 	/*
 	 * Load additional sprites for climates other than temperate.
@@ -198,7 +205,8 @@ static void LoadSpriteTables()
 		LoadGrfFileIndexed(
 			used_set->files[GFT_ARCTIC + _settings_game.game_creation.landscape - 1].filename,
 			_landscape_spriteindexes[_settings_game.game_creation.landscape - 1],
-			i++
+			i++,
+			trust_md5 ? used_set->files[GFT_ARCTIC + _settings_game.game_creation.landscape - 1].hash : nullptr
 		);
 	}
 
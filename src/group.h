@@ -32,6 +32,11 @@ struct GroupStatistics {
 	uint16 num_profit_vehicle;              ///< Number of vehicles considered for profit statistics;
 	Money profit_last_year;                 ///< Sum of profits for all vehicles.
 
+	uint16 num_vehicle_nested;              ///< Number of vehicles in the group and its sub-groups.
+	uint16 *num_engines_nested;             ///< Number of engines of each type in the group and its sub-groups.
+	uint16 num_profit_vehicle_nested;       ///< Number of vehicles in the group and its sub-groups considered for profit statistics.
+	Money profit_last_year_nested;          ///< Sum of profits for all vehicles in the group and its sub-groups.
+
 	GroupStatistics();
 	~GroupStatistics();
 
@@ -41,6 +46,8 @@ struct GroupStatistics {
 	{
 		this->num_profit_vehicle = 0;
 		this->profit_last_year = 0;
+		this->num_profit_vehicle_nested = 0;
+		this->profit_last_year_nested = 0;
 	}
 
 	void ClearAutoreplace()
@@ -56,6 +63,8 @@ struct GroupStatistics {
 	static void CountVehicle(const Vehicle *v, int delta);
 	static void CountEngine(const Vehicle *v, int delta);
 	static void VehicleReachedProfitAge(const Vehicle *v);
+	static void CountGroupEngine(CompanyID company, GroupID id_g, VehicleType type, EngineID engine, int delta);
+	static void UpdateParent(const Group *g, GroupID new_parent);
 
 	static void UpdateProfits();
 	static void UpdateAfterLoad();
@@ -11,6 +11,7 @@
 
 #include "stdafx.h"
 #include <algorithm>
+#include <vector>
 #include "cmd_helper.h"
 #include "command_func.h"
 #include "train.h"
@@ -40,11 +41,13 @@ INSTANTIATE_POOL_METHODS(Group)
 GroupStatistics::GroupStatistics()
 {
 	this->num_engines = CallocT<uint16>(Engine::GetPoolSize());
+	this->num_engines_nested = CallocT<uint16>(Engine::GetPoolSize());
 }
 
 GroupStatistics::~GroupStatistics()
 {
 	free(this->num_engines);
+	free(this->num_engines_nested);
 }
 
 /**
@@ -53,12 +56,33 @@ GroupStatistics::~GroupStatistics()
 void GroupStatistics::Clear()
 {
 	this->num_vehicle = 0;
-	this->num_profit_vehicle = 0;
-	this->profit_last_year = 0;
+	this->num_vehicle_nested = 0;
+	this->ClearProfits();
 
 	/* This is also called when NewGRF change. So the number of engines might have changed. Reallocate. */
 	free(this->num_engines);
+	free(this->num_engines_nested);
 	this->num_engines = CallocT<uint16>(Engine::GetPoolSize());
+	this->num_engines_nested = CallocT<uint16>(Engine::GetPoolSize());
+}
+
+/**
+ * Get the statistics of a group and of all its parents, starting with the group itself.
+ * ALL_GROUP and DEFAULT_GROUP have no parents and no sub-groups.
+ * @param company The company the group belongs to.
+ * @param id_g The group to start at.
+ * @param type The vehicle type of the group.
+ * @param[out] chain The statistics, the group first, the topmost parent last.
+ */
+static void GetGroupStatisticsChain(CompanyID company, GroupID id_g, VehicleType type, std::vector<GroupStatistics *> &chain)
+{
+	chain.clear();
+	chain.push_back(&GroupStatistics::Get(company, id_g, type));
+	if (!Group::IsValidID(id_g)) return;
+
+	for (GroupID parent = Group::Get(id_g)->parent; parent != INVALID_GROUP; parent = Group::Get(parent)->parent) {
+		chain.push_back(&Group::Get(parent)->statistics);
+	}
 }
 
 /**
@@ -152,13 +176,28 @@ void GroupStatistics::Clear()
 	GroupStatistics &stats = GroupStatistics::Get(v);
 
 	stats_all.num_vehicle += delta;
+	stats_all.num_vehicle_nested += delta;
 	stats.num_vehicle += delta;
 
-	if (v->age > VEHICLE_PROFIT_MIN_AGE) {
+	bool profit = v->age > VEHICLE_PROFIT_MIN_AGE;
+	Money profit_last_year = profit ? v->GetDisplayProfitLastYear() * delta : (Money)0;
+	if (profit) {
 		stats_all.num_profit_vehicle += delta;
-		stats_all.profit_last_year += v->GetDisplayProfitLastYear() * delta;
+		stats_all.num_profit_vehicle_nested += delta;
+		stats_all.profit_last_year += profit_last_year;
+		stats_all.profit_last_year_nested += profit_last_year;
 		stats.num_profit_vehicle += delta;
-		stats.profit_last_year += v->GetDisplayProfitLastYear() * delta;
+		stats.profit_last_year += profit_last_year;
+	}
+
+	static std::vector<GroupStatistics *> chain;
+	GetGroupStatisticsChain(v->owner, v->group_id, v->type, chain);
+	for (GroupStatistics *s : chain) {
+		s->num_vehicle_nested += delta;
+		if (profit) {
+			s->num_profit_vehicle_nested += delta;
+			s->profit_last_year_nested += profit_last_year;
+		}
 	}
 }
 
@@ -173,8 +212,58 @@ void GroupStatistics::Clear()
 	if (HasBit(v->subtype, GVSF_VIRTUAL)) return;
 
 	assert(delta == 1 || delta == -1);
-	GroupStatistics::GetAllGroup(v).num_engines[v->engine_type] += delta;
-	GroupStatistics::Get(v).num_engines[v->engine_type] += delta;
+	GroupStatistics &stats_all = GroupStatistics::GetAllGroup(v);
+	stats_all.num_engines[v->engine_type] += delta;
+	stats_all.num_engines_nested[v->engine_type] += delta;
+	GroupStatistics::CountGroupEngine(v->owner, v->group_id, v->type, v->engine_type, delta);
+}
+
+/**
+ * Update num_engines of a group, and num_engines_nested of the group and its parents.
+ * @param company The company the group belongs to.
+ * @param id_g The group the engine is added to or removed from.
+ * @param type The vehicle type of the group.
+ * @param engine The engine type to count.
+ * @param delta +1 to add, -1 to remove.
+ */
+/* static */ void GroupStatistics::CountGroupEngine(CompanyID company, GroupID id_g, VehicleType type, EngineID engine, int delta)
+{
+	static std::vector<GroupStatistics *> chain;
+	GetGroupStatisticsChain(company, id_g, type, chain);
+	chain.front()->num_engines[engine] += delta;
+	for (GroupStatistics *s : chain) {
+		s->num_engines_nested[engine] += delta;
+	}
+}
+
+/**
+ * Move the statistics of a group and its sub-groups from the old parents of the group to the new ones.
+ * @note Must be called before the parent of the group is changed.
+ * @param g The group that is moved.
+ * @param new_parent The new parent of the group, or INVALID_GROUP.
+ */
+/* static */ void GroupStatistics::UpdateParent(const Group *g, GroupID new_parent)
+{
+	if (g->parent == new_parent) return;
+
+	const GroupStatistics &moved = g->statistics;
+	const uint engines = Engine::GetPoolSize();
+
+	static std::vector<GroupStatistics *> chain;
+	for (int delta = -1; delta <= 1; delta += 2) {
+		GroupID parent = delta < 0 ? g->parent : new_parent;
+		if (parent == INVALID_GROUP) continue;
+
+		GetGroupStatisticsChain(g->owner, parent, g->vehicle_type, chain);
+		for (GroupStatistics *s : chain) {
+			s->num_vehicle_nested += moved.num_vehicle_nested * delta;
+			s->num_profit_vehicle_nested += moved.num_profit_vehicle_nested * delta;
+			s->profit_last_year_nested += moved.profit_last_year_nested * delta;
+			for (uint i = 0; i < engines; i++) {
+				s->num_engines_nested[i] += moved.num_engines_nested[i] * delta;
+			}
+		}
+	}
 }
 
 /**
@@ -184,11 +273,21 @@ void GroupStatistics::Clear()
 {
 	GroupStatistics &stats_all = GroupStatistics::GetAllGroup(v);
 	GroupStatistics &stats = GroupStatistics::Get(v);
+	Money profit_last_year = v->GetDisplayProfitLastYear();
 
 	stats_all.num_profit_vehicle++;
-	stats_all.profit_last_year += v->GetDisplayProfitLastYear();
+	stats_all.num_profit_vehicle_nested++;
+	stats_all.profit_last_year += profit_last_year;
+	stats_all.profit_last_year_nested += profit_last_year;
 	stats.num_profit_vehicle++;
-	stats.profit_last_year += v->GetDisplayProfitLastYear();
+	stats.profit_last_year += profit_last_year;
+
+	static std::vector<GroupStatistics *> chain;
+	GetGroupStatisticsChain(v->owner, v->group_id, v->type, chain);
+	for (GroupStatistics *s : chain) {
+		s->num_profit_vehicle_nested++;
+		s->profit_last_year_nested += profit_last_year;
+	}
 }
 
 /**
@@ -244,7 +343,8 @@ void GroupStatistics::Clear()
 			stats.autoreplace_defined = true;
 			stats.autoreplace_finished = true;
 		}
-		if (stats.num_engines[erl->from] > 0) stats.autoreplace_finished = false;
+		/* Replacement rules also apply to the sub-groups of a group. */
+		if (stats.num_engines_nested[erl->from] > 0) stats.autoreplace_finished = false;
 	}
 }
 
@@ -259,10 +359,10 @@ static inline void UpdateNumEngineGroup(const Vehicle *v, GroupID old_g, GroupID
 {
 	if (old_g != new_g) {
 		/* Decrease the num engines in the old group */
-		GroupStatistics::Get(v->owner, old_g, v->type).num_engines[v->engine_type]--;
+		GroupStatistics::CountGroupEngine(v->owner, old_g, v->type, v->engine_type, -1);
 
 		/* Increase the num engines in the new group */
-		GroupStatistics::Get(v->owner, new_g, v->type).num_engines[v->engine_type]++;
+		GroupStatistics::CountGroupEngine(v->owner, new_g, v->type, v->engine_type, 1);
 	}
 }
 
@@ -429,7 +529,9 @@ CommandCost CmdAlterGroup(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 		}
 
 		if (flags & DC_EXEC) {
-			g->parent = (pg == nullptr) ? INVALID_GROUP : pg->index;
+			GroupID new_parent = (pg == nullptr) ? INVALID_GROUP : pg->index;
+			GroupStatistics::UpdateParent(g, new_parent);
+			g->parent = new_parent;
 		}
 	}
 
@@ -465,6 +567,7 @@ static void AddVehicleToGroup(Vehicle *v, GroupID new_g)
 		case VEH_AIRCRAFT:
 			if (v->IsEngineCountable()) UpdateNumEngineGroup(v, v->group_id, new_g);
 			v->group_id = new_g;
+			MarkVehicleListIndexDirty(v);
 			break;
 	}
 
@@ -883,6 +986,7 @@ void SetTrainGroupID(Train *v, GroupID new_g)
 
 		u->group_id = new_g;
 	}
+	MarkVehicleListIndexDirty(v);
 
 	/* Update the Replace Vehicle Windows */
 	GroupStatistics::UpdateAutoreplace(v->owner);
@@ -907,6 +1011,7 @@ void UpdateTrainGroupID(Train *v)
 
 		u->group_id = new_g;
 	}
+	MarkVehicleListIndexDirty(v);
 
 	/* Update the Replace Vehicle Windows */
 	GroupStatistics::UpdateAutoreplace(v->owner);
@@ -923,13 +1028,8 @@ void UpdateTrainGroupID(Train *v)
  *////
 uint GetGroupNumEngines(CompanyID company, GroupID id_g, EngineID id_e)
 {
-	uint count = 0;
 	const Engine *e = Engine::Get(id_e);
-	const Group *g;
-	FOR_ALL_GROUPS(g) {
-		if (g->parent == id_g) count += GetGroupNumEngines(company, g->index, id_e);
-	}
-	return count + GroupStatistics::Get(company, id_g, e->type).num_engines[id_e];
+	return GroupStatistics::Get(company, id_g, e->type).num_engines_nested[id_e];
 }
 
 void RemoveAllGroupsForCompany(const CompanyID company)
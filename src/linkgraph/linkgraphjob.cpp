@@ -141,34 +141,40 @@ void LinkGraphJob::FinaliseJob()
 			}
 		}
 
-		/* Swap shares and invalidate ones that are completely deleted. Don't
-		* really delete them as we could then end up with unroutable cargo
-		* somewhere. Do delete them and also reroute relevant cargo if
-		* automatic distribution has been turned off for that cargo. */
-		for (FlowStatMap::iterator it(ge.flows.begin()); it != ge.flows.end();) {
-			FlowStatMap::iterator new_it = flows.find(it->first);
-			if (new_it == flows.end()) {
-				if (_settings_game.linkgraph.GetDistributionType(this->Cargo()) != DT_MANUAL) {
-					it->second.Invalidate();
-					++it;
-				}
-				else {
-					FlowStat shares(INVALID_STATION, 1);
-					it->second.SwapShares(shares);
-					ge.flows.erase(it++);
-					for (FlowStat::SharesMap::const_iterator shares_it(shares.GetShares()->begin());
-						shares_it != shares.GetShares()->end(); ++shares_it) {
-						RerouteCargo(st, this->Cargo(), shares_it->second, st->index);
-					}
-				}
+		/* Replace the shares by the new ones and invalidate ones that are
+		* completely deleted. Don't really delete them as we could then end up
+		* with unroutable cargo somewhere. Do delete them and also reroute
+		* relevant cargo if automatic distribution has been turned off for
+		* that cargo. Both maps are sorted by origin, so merge them in one pass. */
+		const bool manual = _settings_game.linkgraph.GetDistributionType(this->Cargo()) == DT_MANUAL;
+		FlowStatMap merged;
+		merged.reserve(ge.flows.size() + flows.size());
+		std::vector<StationID> reroute;
+		FlowStatMap::iterator new_it(flows.begin());
+		for (FlowStatMap::iterator it(ge.flows.begin()); it != ge.flows.end(); ++it) {
+			for (; new_it != flows.end() && new_it->first < it->first; ++new_it) {
+				merged.push_back(std::move(*new_it));
 			}
-			else {
-				it->second.SwapShares(new_it->second);
-				flows.erase(new_it);
-				++it;
+			if (new_it != flows.end() && new_it->first == it->first) {
+				merged.push_back(std::move(*new_it));
+				++new_it;
+			} else if (!manual) {
+				it->second.Invalidate();
+				merged.push_back(std::move(*it));
+			} else {
+				const FlowStat::SharesMap *shares = it->second.GetShares();
+				for (FlowStat::SharesMap::const_iterator shares_it(shares->begin()); shares_it != shares->end(); ++shares_it) {
+					reroute.push_back(shares_it->second);
+				}
 			}
 		}
-		ge.flows.insert(flows.begin(), flows.end());
+		for (; new_it != flows.end(); ++new_it) merged.push_back(std::move(*new_it));
+		ge.flows.swap(merged);
+		flows.clear();
+
+		for (std::vector<StationID>::const_iterator it(reroute.begin()); it != reroute.end(); ++it) {
+			RerouteCargo(st, this->Cargo(), *it, st->index);
+		}
 		InvalidateWindowData(WC_STATION_VIEW, st->index, this->Cargo());
 	}
 }
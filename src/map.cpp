@@ -14,6 +14,7 @@
 #include "core/alloc_func.hpp"
 #include "water_map.h"
 #include "string_func.h"
+#include "screenshot.h"
 
 #include "safeguards.h"
 
@@ -31,6 +32,9 @@ uint _map_tile_mask; ///< _map_size - 1 (to mask the mapsize)
 
 Tile *_m = nullptr;          ///< Tiles of the map
 TileExtended *_me = nullptr; ///< Extended Tiles of the map
+#ifdef SPLIT_MAP_ARRAYS
+TileTypeHeight *_mth = nullptr; ///< Types and heights of the tiles of the map
+#endif /* SPLIT_MAP_ARRAYS */
 
 
 /**
@@ -60,9 +64,17 @@ void AllocateMap(uint size_x, uint size_y)
 
 	free(_m);
 	free(_me);
+#ifdef SPLIT_MAP_ARRAYS
+	free(_mth);
+#endif /* SPLIT_MAP_ARRAYS */
 
 	_m = CallocT<Tile>(_map_size);
 	_me = CallocT<TileExtended>(_map_size);
+#ifdef SPLIT_MAP_ARRAYS
+	_mth = CallocT<TileTypeHeight>(_map_size);
+#endif /* SPLIT_MAP_ARRAYS */
+
+	ResetMinimapExport();
 }
 
 
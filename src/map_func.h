@@ -43,6 +43,44 @@ extern Tile *_m;
  */
 extern TileExtended *_me;
 
+#ifdef SPLIT_MAP_ARRAYS
+/**
+ * Pointer to the array with the type and height of the tiles.
+ *
+ * This variable points to the array which contains the types and heights
+ * of the tiles of the map, which are not part of #Tile in this layout.
+ */
+extern TileTypeHeight *_mth;
+#endif /* SPLIT_MAP_ARRAYS */
+
+/**
+ * Get the byte holding the type of a tile, wherever the map layout stores it.
+ * @param tile The tile.
+ * @return Reference to the byte.
+ */
+static inline byte &TileTypeByte(TileIndex tile)
+{
+#ifdef SPLIT_MAP_ARRAYS
+	return _mth[tile].type;
+#else
+	return _m[tile].type;
+#endif /* SPLIT_MAP_ARRAYS */
+}
+
+/**
+ * Get the byte holding the height of a tile, wherever the map layout stores it.
+ * @param tile The tile.
+ * @return Reference to the byte.
+ */
+static inline byte &TileHeightByte(TileIndex tile)
+{
+#ifdef SPLIT_MAP_ARRAYS
+	return _mth[tile].height;
+#else
+	return _m[tile].height;
+#endif /* SPLIT_MAP_ARRAYS */
+}
+
 void AllocateMap(uint size_x, uint size_y);
 
 /**
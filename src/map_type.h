@@ -12,13 +12,36 @@
 #ifndef MAP_TYPE_H
 #define MAP_TYPE_H
 
+/*
+ * Defining SPLIT_MAP_ARRAYS (configure --enable-split-map) moves the type and
+ * height of the tiles out of #Tile into an array of their own, #_mth. Scans
+ * over the whole map that only look at the tile type or height, like the tile
+ * loop and the map-wide passes after loading, then read two bytes per tile
+ * instead of a full #Tile. The savegame format is the same for both layouts.
+ */
+
+#ifdef SPLIT_MAP_ARRAYS
+/**
+ * The type and height of a tile, stored apart from the other data of the tile.
+ * Look at docs/landscape.html for the exact meaning of the members.
+ */
+struct TileTypeHeight {
+	byte   type;        ///< The type (bits 4..7), bridges (2..3), rainforest/desert (0..1)
+	byte   height;      ///< The height of the northern corner.
+};
+
+assert_compile(sizeof(TileTypeHeight) == 2);
+#endif /* SPLIT_MAP_ARRAYS */
+
 /**
  * Data that is stored per tile. Also used TileExtended for this.
  * Look at docs/landscape.html for the exact meaning of the members.
  */
 struct Tile {
+#ifndef SPLIT_MAP_ARRAYS
 	byte   type;        ///< The type (bits 4..7), bridges (2..3), rainforest/desert (0..1)
 	byte   height;      ///< The height of the northern corner.
+#endif /* SPLIT_MAP_ARRAYS */
 	uint16 m2;          ///< Primarily used for indices to towns, industries and stations
 	byte   m1;          ///< Primarily used for ownership information
 	byte   m3;          ///< General purpose
@@ -26,7 +49,11 @@ struct Tile {
 	byte   m5;          ///< General purpose
 };
 
+#ifdef SPLIT_MAP_ARRAYS
+assert_compile(sizeof(Tile) == 6);
+#else
 assert_compile(sizeof(Tile) == 8);
+#endif /* SPLIT_MAP_ARRAYS */
 
 /**
  * Data that is stored per tile. Also used Tile for this.
@@ -141,8 +141,8 @@ public:
 			DEBUG(misc, LANDINFOD_LEVEL, "south tile: %#x"     , Tunnel::GetByTile(tile)->tile_s);
 			DEBUG(misc, LANDINFOD_LEVEL, "is chunnel: %u"       , Tunnel::GetByTile(tile)->is_chunnel);
 		}
-		DEBUG(misc, LANDINFOD_LEVEL, "type   = %#x", _m[tile].type);
-		DEBUG(misc, LANDINFOD_LEVEL, "height = %#x", _m[tile].height);
+		DEBUG(misc, LANDINFOD_LEVEL, "type   = %#x", TileTypeByte(tile));
+		DEBUG(misc, LANDINFOD_LEVEL, "height = %#x", TileHeightByte(tile));
 		DEBUG(misc, LANDINFOD_LEVEL, "m1     = %#x", _m[tile].m1);
 		DEBUG(misc, LANDINFOD_LEVEL, "m2     = %#x", _m[tile].m2);
 		DEBUG(misc, LANDINFOD_LEVEL, "m3     = %#x", _m[tile].m3);
@@ -369,7 +369,7 @@ static SOCKET ListenLoopProc(addrinfo *runp)
 		return INVALID_SOCKET;
 	}
 
-	if (runp->ai_socktype != SOCK_DGRAM && listen(sock, 1) != 0) {
+	if (runp->ai_socktype != SOCK_DGRAM && listen(sock, SOMAXCONN) != 0) {
 		DEBUG(net, 1, "[%s] could not listen at %s port %s: %s", type, family, address, strerror(errno));
 		closesocket(sock);
 		return INVALID_SOCKET;
@@ -75,6 +75,7 @@ bool NetworkCoreInitialize()
 	}
 #endif /* WIN32 */
 
+	InitializePacketBufferPool();
 	return true;
 }
 
@@ -83,6 +84,8 @@ bool NetworkCoreInitialize()
  */
 void NetworkCoreShutdown()
 {
+	ShutdownPacketBufferPool();
+
 #if defined(__MORPHOS__) || defined(__AMIGA__)
 	/* free allocated resources */
 #if defined(__AMIGA__)
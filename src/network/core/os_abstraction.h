@@ -184,6 +184,12 @@ static inline void OTTDfreeaddrinfo(struct addrinfo *ai)
 #	include <errno.h>
 #	include <sys/time.h>
 #	include <netdb.h>
+
+#	if defined(__linux__)
+/* Servers can wait for many sockets at once with epoll instead of select. */
+#		include <sys/epoll.h>
+#		define HAVE_EPOLL
+#	endif
 #endif /* UNIX */
 
 #ifdef __BEOS__
@@ -16,11 +16,65 @@
 #include "../../stdafx.h"
 #include "../../string_func.h"
 #include "../../command_type.h"
+#include "../../core/mem_func.hpp"
+#include "../../thread/thread.h"
 
 #include "packet.h"
 
 #include "../../safeguards.h"
 
+/** Maximum number of unused packet buffers kept for reuse. */
+static const uint PACKET_BUFFER_POOL_SIZE = 64;
+
+static byte *_packet_buffer_pool[PACKET_BUFFER_POOL_SIZE]; ///< Unused buffers of SHRT_MAX bytes.
+static uint _packet_buffer_pool_count = 0;                 ///< Number of buffers in #_packet_buffer_pool.
+static ThreadMutex *_packet_buffer_pool_mutex = nullptr;   ///< Guards the pool, map packets are made by the saveload thread; nullptr while the pool is not used.
+
+/**
+ * Get a buffer of SHRT_MAX bytes for a packet, reusing one of a deleted packet when possible.
+ * @return The buffer.
+ */
+static byte *AllocatePacketBuffer()
+{
+	if (_packet_buffer_pool_mutex != nullptr) {
+		ThreadMutexLocker lock(_packet_buffer_pool_mutex);
+		if (_packet_buffer_pool_count != 0) return _packet_buffer_pool[--_packet_buffer_pool_count];
+	}
+	return MallocT<byte>(SHRT_MAX);
+}
+
+/**
+ * Give a buffer of SHRT_MAX bytes back to the pool, or free it when the pool is full.
+ * @param buffer The buffer.
+ */
+static void FreePacketBuffer(byte *buffer)
+{
+	if (_packet_buffer_pool_mutex != nullptr) {
+		ThreadMutexLocker lock(_packet_buffer_pool_mutex);
+		if (_packet_buffer_pool_count != PACKET_BUFFER_POOL_SIZE) {
+			_packet_buffer_pool[_packet_buffer_pool_count++] = buffer;
+			return;
+		}
+	}
+	free(buffer);
+}
+
+/** Start reusing the buffers of deleted packets. */
+void InitializePacketBufferPool()
+{
+	if (_packet_buffer_pool_mutex == nullptr) _packet_buffer_pool_mutex = ThreadMutex::New();
+}
+
+/** Free all pooled packet buffers and stop pooling. */
+void ShutdownPacketBufferPool()
+{
+	if (_packet_buffer_pool_mutex == nullptr) return;
+
+	while (_packet_buffer_pool_count != 0) free(_packet_buffer_pool[--_packet_buffer_pool_count]);
+	delete _packet_buffer_pool_mutex;
+	_packet_buffer_pool_mutex = nullptr;
+}
+
 /**
  * Create a packet that is used to read from a network socket
  * @param cs the socket handler associated with the socket we are reading from
@@ -33,7 +87,8 @@ Packet::Packet(NetworkSocketHandler *cs)
 	this->next   = nullptr;
 	this->pos    = 0; // We start reading from here
 	this->size   = 0;
-	this->buffer = MallocT<byte>(SHRT_MAX);
+	this->buffer = AllocatePacketBuffer();
+	this->buffer_size = SHRT_MAX;
 }
 
 /**
@@ -48,7 +103,8 @@ Packet::Packet(PacketType type)
 	/* Skip the size so we can write that in before sending the packet */
 	this->pos                  = 0;
 	this->size                 = sizeof(PacketSize);
-	this->buffer               = MallocT<byte>(SHRT_MAX);
+	this->buffer               = AllocatePacketBuffer();
+	this->buffer_size          = SHRT_MAX;
 	this->buffer[this->size++] = type;
 }
 
@@ -57,7 +113,30 @@ Packet::Packet(PacketType type)
  */
 Packet::~Packet()
 {
-	free(this->buffer);
+	if (this->buffer_size == SHRT_MAX) {
+		FreePacketBuffer(this->buffer);
+	} else {
+		free(this->buffer);
+	}
+}
+
+/**
+ * Reduce the buffer of the packet to the size of the packet, e.g. when it
+ * will be waiting in a queue for a while. Most packets are just a few bytes.
+ */
+void Packet::ShrinkToSize()
+{
+	if (this->buffer_size == this->size) return;
+
+	byte *buffer = MallocT<byte>(this->size);
+	MemCpyT(buffer, this->buffer, this->size);
+	if (this->buffer_size == SHRT_MAX) {
+		FreePacketBuffer(this->buffer);
+	} else {
+		free(this->buffer);
+	}
+	this->buffer = buffer;
+	this->buffer_size = this->size;
 }
 
 /**
@@ -54,6 +54,8 @@ struct Packet {
 	PacketSize pos;
 	/** The buffer of this packet, of basically variable length up to SHRT_MAX. */
 	byte *buffer;
+	/** The allocated size of #buffer; SHRT_MAX unless the packet got shrunk to its size. */
+	PacketSize buffer_size;
 
 private:
 	/** Socket we're associated with. */
@@ -66,6 +68,7 @@ public:
 
 	/* Sending/writing of packets */
 	void PrepareToSend();
+	void ShrinkToSize();
 
 	void Send_bool  (bool   data);
 	void Send_uint8 (uint8  data);
@@ -89,6 +92,9 @@ public:
 	void   Recv_binary(char *buffer, size_t size);
 };
 
+void InitializePacketBufferPool();
+void ShutdownPacketBufferPool();
+
 #endif /* ENABLE_NETWORK */
 
 #endif /* NETWORK_CORE_PACKET_H */
@@ -15,19 +15,35 @@
 
 #include "../../stdafx.h"
 #include "../../debug.h"
+#include "../../event_log.h"
 
 #include "tcp.h"
 
+#if defined(UNIX) && !defined(__OS2__) && !defined(__MORPHOS__) && !defined(__AMIGA__)
+/* Send as many queued packets as possible with a single system call. */
+#	define TCP_SEND_VECTORED
+#	include <sys/uio.h>
+#endif
+
 #include "../../safeguards.h"
 
+/** Packets beyond this number in the send queue only keep the memory they need. */
+static const uint TCP_SEND_QUEUE_SHRINK_LENGTH = 16;
+
+#ifdef TCP_SEND_VECTORED
+/** Maximum number of packets handed to a single system call. */
+static const uint TCP_SEND_BATCH = 64;
+#endif
+
 /**
  * Construct a socket handler for a TCP connection.
  * @param s The just opened TCP connection.
  */
 NetworkTCPSocketHandler::NetworkTCPSocketHandler(SOCKET s) :
 		NetworkSocketHandler(),
-		packet_queue(nullptr), packet_recv(nullptr),
-		sock(s), writable(false)
+		packet_queue(nullptr), packet_queue_last(nullptr), packet_queue_length(0), packet_recv(nullptr),
+		sock(s), writable(false), readable(false),
+		bytes_sent(0), bytes_received(0), packets_sent(0), packets_received(0), send_calls(0), recv_calls(0)
 {
 }
 
@@ -50,6 +66,8 @@ NetworkRecvStatus NetworkTCPSocketHandler::CloseConnection(bool error)
 		delete this->packet_queue;
 		this->packet_queue = p;
 	}
+	this->packet_queue_last = nullptr;
+	this->packet_queue_length = 0;
 	delete this->packet_recv;
 	this->packet_recv = nullptr;
 
@@ -64,26 +82,24 @@ NetworkRecvStatus NetworkTCPSocketHandler::CloseConnection(bool error)
  */
 void NetworkTCPSocketHandler::SendPacket(Packet *packet)
 {
-	Packet *p;
 	assert(packet != nullptr);
 
 	packet->PrepareToSend();
 
-	/* Reallocate the packet as in 99+% of the times we send at most 25 bytes and
-	 * keeping the other 1400+ bytes wastes memory, especially when someone tries
-	 * to do a denial of service attack! */
-	packet->buffer = ReallocT(packet->buffer, packet->size);
+	/* Packets are usually sent within a tick and then their buffer is reused for
+	 * the next packet. When they pile up, reallocate them as in 99+% of the times
+	 * we send at most 25 bytes and keeping the other 1400+ bytes wastes memory,
+	 * especially when someone tries to do a denial of service attack! */
+	if (this->packet_queue_length >= TCP_SEND_QUEUE_SHRINK_LENGTH) packet->ShrinkToSize();
 
-	/* Locate last packet buffered for the client */
-	p = this->packet_queue;
-	if (p == nullptr) {
+	if (this->packet_queue_last == nullptr) {
 		/* No packets yet */
 		this->packet_queue = packet;
 	} else {
-		/* Skip to the last packet */
-		while (p->next != nullptr) p = p->next;
-		p->next = packet;
+		this->packet_queue_last->next = packet;
 	}
+	this->packet_queue_last = packet;
+	this->packet_queue_length++;
 }
 
 /**
@@ -99,15 +115,33 @@ void NetworkTCPSocketHandler::SendPacket(Packet *packet)
 SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 {
 	ssize_t res;
-	Packet *p;
 
 	/* We can not write to this socket!! */
 	if (!this->writable) return SPS_NONE_SENT;
 	if (!this->IsConnected()) return SPS_CLOSED;
 
-	p = this->packet_queue;
-	while (p != nullptr) {
-		res = send(this->sock, (const char*)p->buffer + p->pos, p->size - p->pos, 0);
+	while (this->packet_queue != nullptr) {
+#ifdef TCP_SEND_VECTORED
+		struct iovec iov[TCP_SEND_BATCH];
+		uint count = 0;
+		size_t to_send = 0;
+		for (Packet *p = this->packet_queue; p != nullptr && count != TCP_SEND_BATCH; p = p->next, count++) {
+			iov[count].iov_base = p->buffer + p->pos;
+			iov[count].iov_len = p->size - p->pos;
+			to_send += iov[count].iov_len;
+		}
+
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		res = sendmsg(this->sock, &msg, 0);
+#else
+		Packet *p = this->packet_queue;
+		size_t to_send = p->size - p->pos;
+		res = send(this->sock, (const char*)p->buffer + p->pos, to_send, 0);
+#endif /* TCP_SEND_VECTORED */
+		this->send_calls++;
 		if (res == -1) {
 			int err = GET_LAST_ERROR();
 			if (err != EWOULDBLOCK) {
@@ -118,6 +152,8 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 				}
 				return SPS_CLOSED;
 			}
+			/* Wait until the socket tells it is writable again. */
+			this->writable = false;
 			return SPS_PARTLY_SENT;
 		}
 		if (res == 0) {
@@ -126,15 +162,30 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 			return SPS_CLOSED;
 		}
 
-		p->pos += res;
+		this->bytes_sent += res;
+		uint64 packets_before = this->packets_sent;
+
+		/* Remove the packets that are sent completely. */
+		for (size_t sent = res; sent != 0;) {
+			Packet *p = this->packet_queue;
+			size_t part = min<size_t>(sent, p->size - p->pos);
+			p->pos += (PacketSize)part;
+			sent -= part;
+			if (p->pos != p->size) break;
 
-		/* Is this packet sent? */
-		if (p->pos == p->size) {
 			/* Go to the next packet */
 			this->packet_queue = p->next;
+			if (this->packet_queue == nullptr) this->packet_queue_last = nullptr;
+			this->packet_queue_length--;
+			this->packets_sent++;
 			delete p;
-			p = this->packet_queue;
-		} else {
+		}
+
+		EVENT_LOG(ELE_NET_SEND, (uint32)res, (uint32)(this->packets_sent - packets_before), this->packet_queue_length, 0);
+
+		/* The OS buffer is full; send the rest later. */
+		if ((size_t)res != to_send) {
+			this->writable = false;
 			return SPS_PARTLY_SENT;
 		}
 	}
@@ -163,6 +214,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 		while (p->pos < sizeof(PacketSize)) {
 		/* Read the size of the packet */
 			res = recv(this->sock, (char*)p->buffer + p->pos, sizeof(PacketSize) - p->pos, 0);
+			this->recv_calls++;
 			if (res == -1) {
 				int err = GET_LAST_ERROR();
 				if (err != EWOULDBLOCK) {
@@ -172,6 +224,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 					return nullptr;
 				}
 				/* Connection would block, so stop for now */
+				this->readable = false;
 				return nullptr;
 			}
 			if (res == 0) {
@@ -180,6 +233,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 				return nullptr;
 			}
 			p->pos += res;
+			this->bytes_received += res;
 		}
 
 		/* Read the packet size from the received packet */
@@ -194,6 +248,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 	/* Read rest of packet */
 	while (p->pos < p->size) {
 		res = recv(this->sock, (char*)p->buffer + p->pos, p->size - p->pos, 0);
+		this->recv_calls++;
 		if (res == -1) {
 			int err = GET_LAST_ERROR();
 			if (err != EWOULDBLOCK) {
@@ -203,6 +258,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 				return nullptr;
 			}
 			/* Connection would block */
+			this->readable = false;
 			return nullptr;
 		}
 		if (res == 0) {
@@ -212,10 +268,12 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 		}
 
 		p->pos += res;
+		this->bytes_received += res;
 	}
 
 	/* Prepare for receiving a new packet */
 	this->packet_recv = nullptr;
+	this->packets_received++;
 
 	p->PrepareToRead();
 	return p;
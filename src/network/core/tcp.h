@@ -31,10 +31,20 @@ enum SendPacketsState {
 class NetworkTCPSocketHandler : public NetworkSocketHandler {
 private:
 	Packet *packet_queue;     ///< Packets that are awaiting delivery
+	Packet *packet_queue_last; ///< Last packet of #packet_queue, for appending in constant time
+	uint packet_queue_length; ///< Number of packets in #packet_queue
 	Packet *packet_recv;      ///< Partially received packet
 public:
 	SOCKET sock;              ///< The socket currently connected to
 	bool writable;            ///< Can we write to this socket?
+	bool readable;            ///< Might there be something to receive? Only maintained for sockets waited on with epoll.
+
+	uint64 bytes_sent;        ///< Number of bytes sent over the socket
+	uint64 bytes_received;    ///< Number of bytes received over the socket
+	uint64 packets_sent;      ///< Number of packets sent completely
+	uint64 packets_received;  ///< Number of packets received completely
+	uint64 send_calls;        ///< Number of system calls made to send data
+	uint64 recv_calls;        ///< Number of system calls made to receive data
 
 	/**
 	 * Whether this socket is currently bound to a socket.
@@ -56,6 +66,12 @@ public:
 	 */
 	bool HasSendQueue() { return this->packet_queue != nullptr; }
 
+	/**
+	 * Get the number of packets waiting in the send queue.
+	 * @return The number of packets.
+	 */
+	uint GetSendQueueLength() const { return this->packet_queue_length; }
+
 	NetworkTCPSocketHandler(SOCKET s = INVALID_SOCKET);
 	~NetworkTCPSocketHandler();
 };
@@ -34,6 +34,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_ADMIN_RCON,             ///< The admin sends a remote console command.
 	ADMIN_PACKET_ADMIN_GAMESCRIPT,       ///< The admin sends a JSON string for the GameScript.
 	ADMIN_PACKET_ADMIN_PING,             ///< The admin sends a ping to the server, expecting a ping-reply (PONG) packet.
+	ADMIN_PACKET_ADMIN_COMPANY_DELTA_ACK, ///< The admin acknowledges having processed a company delta.
 
 	ADMIN_PACKET_SERVER_FULL = 100,      ///< The server tells the admin it cannot accept the admin.
 	ADMIN_PACKET_SERVER_BANNED,          ///< The server tells the admin it is banned.
@@ -63,6 +64,9 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_COMPANY_DELTA,   ///< The server gives the admin the company economy and statistics that changed.
+	ADMIN_PACKET_SERVER_STATION_STATS,   ///< The server gives the admin statistics about stations.
+	ADMIN_PACKET_SERVER_GROUP_STATS,     ///< The server gives the admin statistics about vehicle groups.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -86,9 +90,29 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_COMPANY_DELTA,   ///< Updates about the economy and statistics of companies, only what changed.
+	ADMIN_UPDATE_STATION_STATS,   ///< Updates about the statistics of stations.
+	ADMIN_UPDATE_GROUP_STATS,     ///< Updates about the statistics of vehicle groups.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
+/** Fields of a company in #ADMIN_PACKET_SERVER_COMPANY_DELTA, in the order they are sent. */
+enum AdminCompanyDeltaField {
+	ACDF_MONEY,                                      ///< uint64 Money.
+	ACDF_LOAN,                                       ///< uint64 Loan.
+	ACDF_INCOME,                                     ///< uint64 Income.
+	ACDF_DELIVERED_CARGO,                            ///< uint16 Delivered cargo (this quarter).
+	ACDF_VALUE_LAST_QUARTER,                         ///< uint64 Company value (last quarter).
+	ACDF_PERFORMANCE_LAST_QUARTER,                   ///< uint16 Performance (last quarter).
+	ACDF_DELIVERED_CARGO_LAST_QUARTER,               ///< uint16 Delivered cargo (last quarter).
+	ACDF_VALUE_PREVIOUS_QUARTER,                     ///< uint64 Company value (previous quarter).
+	ACDF_PERFORMANCE_PREVIOUS_QUARTER,               ///< uint16 Performance (previous quarter).
+	ACDF_DELIVERED_CARGO_PREVIOUS_QUARTER,           ///< uint16 Delivered cargo (previous quarter).
+	ACDF_NUM_VEHICLES,                               ///< uint16 Number of trains, lorries, busses, planes and ships; one field each.
+	ACDF_NUM_STATIONS = ACDF_NUM_VEHICLES + NETWORK_VEH_END, ///< uint16 Number of train stations, lorry stations, bus stops, airports and harbours; one field each.
+	ACDF_END = ACDF_NUM_STATIONS + NETWORK_VEH_END,          ///< Number of fields.
+};
+
 /** Update frequencies an admin can register. */
 enum AdminUpdateFrequency {
 	ADMIN_FREQUENCY_POLL      = 0x01, ///< The admin can poll this.
@@ -191,6 +215,15 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_ADMIN_PING(Packet *p);
 
+	/**
+	 * Tell the server a company delta has been processed, so the next delta
+	 * only contains the changes since that one:
+	 * uint32  Sequence number of the processed delta.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_ADMIN_COMPANY_DELTA_ACK(Packet *p);
+
 	/**
 	 * The server is full (connection gets closed).
 	 * @param p The packet that was just received.
@@ -473,6 +506,61 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_PONG(Packet *p);
 
+	/**
+	 * The economy and statistics of the companies that changed since the last
+	 * acknowledged delta, or of all companies when no delta was acknowledged.
+	 * A delta can span multiple packets, all with the same sequence numbers:
+	 * uint32  Sequence number of this delta.
+	 * uint32  Sequence number of the delta this one is relative to, 0 for none.
+	 * These fields are repeated until the packet is full:
+	 * bool    Data to follow.
+	 * uint8   ID of the company.
+	 * uint32  Bit mask of the fields that follow (see #AdminCompanyDeltaField), 0 when the company no longer exists.
+	 * ...     The fields in the mask, in order.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_COMPANY_DELTA(Packet *p);
+
+	/**
+	 * Statistics of stations. Multiple of these packets can follow each other
+	 * in order to provide all stations.
+	 * These fields are repeated until the packet is full:
+	 * bool    Data to follow.
+	 * uint16  ID of the station.
+	 * uint8   ID of the owner.
+	 * uint8   Facilities of the station (see #StationFacility).
+	 * uint8   Number of cargo types with a rating; for each:
+	 *   uint8   Cargo type.
+	 *   uint8   Rating, 0..255.
+	 *   uint32  Amount of cargo waiting.
+	 *   uint8   Time since the last pickup.
+	 *   uint8   Speed of the last vehicle picking up.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_STATION_STATS(Packet *p);
+
+	/**
+	 * Statistics of vehicle groups. Multiple of these packets can follow each
+	 * other in order to provide all groups.
+	 * These fields are repeated until the packet is full:
+	 * bool    Data to follow.
+	 * uint16  ID of the group.
+	 * uint8   ID of the owner.
+	 * uint8   Vehicle type.
+	 * uint16  ID of the parent group, or 0xFFFF for none.
+	 * string  Name of the group, empty when it has the default name.
+	 * uint16  Number of vehicles in the group.
+	 * uint64  Profit last year of the vehicles in the group.
+	 * uint16  Number of vehicles in the group and its sub-groups.
+	 * uint16  Number of those vehicles old enough to count for the profit.
+	 * uint64  Profit last year of the vehicles in the group and its sub-groups.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_GROUP_STATS(Packet *p);
+
 	/**
 	 * Notify the admin connection that the rcon command has finished.
 	 * string The command as requested by the admin connection.
@@ -18,6 +18,7 @@
 #include "../network.h"
 #include "../../core/pool_type.hpp"
 #include "../../debug.h"
+#include "../../settings_type.h"
 #include "table/strings.h"
 
 #ifdef ENABLE_NETWORK
@@ -33,6 +34,73 @@ class TCPListenHandler {
 	/** List of sockets we listen on. */
 	static SocketList sockets;
 
+#ifdef HAVE_EPOLL
+	/** The epoll instance the listeners and their clients are waited on with, or -1 when using select. */
+	static int epoll_fd;
+
+	/** Index in the event data of a listening socket. */
+	static const uint32 EPOLL_LISTENER = UINT32_MAX;
+
+	/**
+	 * Start waiting for a socket with epoll. Sockets are edge triggered, so
+	 * they must be read and written until they would block.
+	 * @param s The socket.
+	 * @param index Pool index of the socket's handler, or #EPOLL_LISTENER.
+	 */
+	static void EpollAdd(SOCKET s, uint32 index)
+	{
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = (index == EPOLL_LISTENER ? EPOLLIN : EPOLLIN | EPOLLOUT | EPOLLRDHUP) | EPOLLET;
+		event.data.u64 = (uint64)index << 32 | (uint32)s;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s, &event) != 0) {
+			DEBUG(net, 0, "[%s] epoll_ctl failed with error %d", Tsocket::GetName(), errno);
+		}
+	}
+
+	/**
+	 * Handle the receiving of packets when waiting with epoll. Only sockets
+	 * that reported an event are touched; a socket stays readable until a
+	 * receive would block, as a client can be throttled before that.
+	 * @return true if everything went okay.
+	 */
+	static bool EpollReceive()
+	{
+		struct epoll_event events[64];
+		for (;;) {
+			int n = epoll_wait(epoll_fd, events, lengthof(events), 0); // don't block at all.
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+
+			for (int i = 0; i < n; i++) {
+				uint32 index = GB(events[i].data.u64, 32, 32);
+				SOCKET s = (SOCKET)GB(events[i].data.u64, 0, 32);
+				if (index == EPOLL_LISTENER) {
+					AcceptClient(s);
+					continue;
+				}
+
+				/* The socket might have been closed and reused while handling earlier events. */
+				Tsocket *cs = Tsocket::GetIfValid(index);
+				if (cs == nullptr || cs->sock != s) continue;
+				if ((events[i].events & EPOLLOUT) != 0) cs->writable = true;
+				if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0) cs->readable = true;
+			}
+
+			if (n < (int)lengthof(events)) break;
+		}
+
+		/* read stuff from clients */
+		Tsocket *cs;
+		FOR_ALL_ITEMS_FROM(Tsocket, idx, cs, 0) {
+			if (cs->readable) cs->ReceivePackets();
+		}
+		return _networking;
+	}
+#endif /* HAVE_EPOLL */
+
 public:
 	/**
 	 * Accepts clients from the sockets.
@@ -89,16 +157,38 @@ public:
 				continue;
 			}
 
-			Tsocket::AcceptConnection(s, address);
+			Tsocket *cs = Tsocket::AcceptConnection(s, address);
+#ifdef HAVE_EPOLL
+			if (epoll_fd != -1) EpollAdd(cs->sock, (uint32)cs->index);
+#else
+			(void)cs;
+#endif
 		}
 	}
 
+	/**
+	 * Are the sockets waited on with epoll instead of select?
+	 * @return True when using epoll.
+	 */
+	static bool UsesEpoll()
+	{
+#ifdef HAVE_EPOLL
+		return epoll_fd != -1;
+#else
+		return false;
+#endif
+	}
+
 	/**
 	 * Handle the receiving of packets.
 	 * @return true if everything went okay.
 	 */
 	static bool Receive()
 	{
+#ifdef HAVE_EPOLL
+		if (epoll_fd != -1) return EpollReceive();
+#endif
+
 		fd_set read_fd, write_fd;
 		struct timeval tv;
 
@@ -161,6 +251,26 @@ public:
 			return false;
 		}
 
+#ifdef HAVE_EPOLL
+		/* A dedicated server can have many connections, select gets slow with those. */
+		if (_network_dedicated && _settings_client.network.server_use_epoll) {
+			epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+			if (epoll_fd == -1) {
+				DEBUG(net, 0, "[%s] epoll_create1 failed with error %d, using select", Tsocket::GetName(), errno);
+			} else {
+				for (SocketList::iterator s = sockets.Begin(); s != sockets.End(); s++) {
+					EpollAdd(s->second, EPOLL_LISTENER);
+				}
+				/* Connections can outlive the listeners, e.g. admin connections when the server restarts. */
+				Tsocket *cs;
+				FOR_ALL_ITEMS_FROM(Tsocket, idx, cs, 0) {
+					EpollAdd(cs->sock, (uint32)cs->index);
+				}
+				DEBUG(net, 1, "[%s] waiting for sockets with epoll", Tsocket::GetName());
+			}
+		}
+#endif /* HAVE_EPOLL */
+
 		return true;
 	}
 
@@ -171,11 +281,20 @@ public:
 			closesocket(s->second);
 		}
 		sockets.Clear();
+#ifdef HAVE_EPOLL
+		if (epoll_fd != -1) {
+			close(epoll_fd);
+			epoll_fd = -1;
+		}
+#endif /* HAVE_EPOLL */
 		DEBUG(net, 1, "[%s] closed listeners", Tsocket::GetName());
 	}
 };
 
 template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet> SocketList TCPListenHandler<Tsocket, Tfull_packet, Tban_packet>::sockets;
+#ifdef HAVE_EPOLL
+template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet> int TCPListenHandler<Tsocket, Tfull_packet, Tban_packet>::epoll_fd = -1;
+#endif /* HAVE_EPOLL */
 
 #endif /* ENABLE_NETWORK */
 
@@ -22,6 +22,7 @@
 #include "network_content.h"
 #include "network_udp.h"
 #include "network_gamelist.h"
+#include "network_load_test.h"
 #include "network_base.h"
 #include "core/udp.h"
 #include "core/host.h"
@@ -37,6 +38,7 @@
 #include "../core/pool_func.hpp"
 #include "../gfx_func.h"
 #include "../error.h"
+#include "../cpu.h"
 
 #include "../safeguards.h"
 
@@ -506,8 +508,9 @@ void ParseConnectionString(const char **company, const char **port, char *connec
  * Handle the accepting of a connection to the server.
  * @param s The socket of the new connection.
  * @param address The address of the peer.
+ * @return The handler of the new connection.
  */
-/* static */ void ServerNetworkGameSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
+/* static */ ServerNetworkGameSocketHandler *ServerNetworkGameSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
 {
 	/* Register the login */
 	_network_clients_connected++;
@@ -515,6 +518,7 @@ void ParseConnectionString(const char **company, const char **port, char *connec
 	SetWindowDirty(WC_CLIENT_LIST, 0);
 	ServerNetworkGameSocketHandler *cs = new ServerNetworkGameSocketHandler(s);
 	cs->client_address = address; // Save the IP of the client
+	return cs;
 }
 
 /**
@@ -546,6 +550,7 @@ void NetworkClose(bool close_admins)
 		}
 		ServerNetworkGameSocketHandler::CloseListeners();
 		ServerNetworkAdminSocketHandler::CloseListeners();
+		NetworkLoadTestClose();
 	} else if (MyClient::my_client != nullptr) {
 		MyClient::SendQuit();
 		MyClient::my_client->CloseConnection(NETWORK_RECV_STATUS_CONN_LOST);
@@ -833,8 +838,12 @@ void NetworkDisconnect(bool blocking, bool close_admins)
 static bool NetworkReceive()
 {
 	if (_network_server) {
+		uint64 start = ottd_rdtsc();
 		ServerNetworkAdminSocketHandler::Receive();
-		return ServerNetworkGameSocketHandler::Receive();
+		bool ret = ServerNetworkGameSocketHandler::Receive();
+		_network_receive_cycles += ottd_rdtsc() - start;
+		_network_receive_calls++;
+		return ret;
 	} else {
 		return ClientNetworkGameSocketHandler::Receive();
 	}
@@ -861,6 +870,7 @@ void NetworkBackgroundLoop()
 	_network_content_client.SendReceive();
 	TCPConnecter::CheckCallbacks();
 	NetworkHTTPSocketHandler::HTTPReceive();
+	NetworkLoadTestLoop();
 
 	NetworkBackgroundUDPLoop();
 }
@@ -24,6 +24,8 @@
 #include "../map_func.h"
 #include "../rev.h"
 #include "../game/game.hpp"
+#include "../station_base.h"
+#include "../group.h"
 
 #include "../safeguards.h"
 
@@ -56,6 +58,9 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_DAILY | ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY | ADMIN_FREQUENCY_QUARTERLY | ADMIN_FREQUENCY_ANUALLY, ///< ADMIN_UPDATE_COMPANY_DELTA
+	ADMIN_FREQUENCY_POLL |                         ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY | ADMIN_FREQUENCY_QUARTERLY | ADMIN_FREQUENCY_ANUALLY, ///< ADMIN_UPDATE_STATION_STATS
+	ADMIN_FREQUENCY_POLL |                         ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY | ADMIN_FREQUENCY_QUARTERLY | ADMIN_FREQUENCY_ANUALLY, ///< ADMIN_UPDATE_GROUP_STATS
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -115,11 +120,13 @@ ServerNetworkAdminSocketHandler::~ServerNetworkAdminSocketHandler()
  * Handle the acception of a connection.
  * @param s The socket of the new connection.
  * @param address The address of the peer.
+ * @return The handler of the new connection.
  */
-/* static */ void ServerNetworkAdminSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
+/* static */ ServerNetworkAdminSocketHandler *ServerNetworkAdminSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
 {
 	ServerNetworkAdminSocketHandler *as = new ServerNetworkAdminSocketHandler(s);
 	as->address = address; // Save the IP of the client
+	return as;
 }
 
 /***********
@@ -400,17 +407,25 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyRemove(CompanyID c
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Get the income of a company this year.
+ * @param company The company.
+ * @return The income.
+ */
+static Money GetAdminCompanyIncome(const Company *company)
+{
+	Money income = 0;
+	for (uint i = 0; i < lengthof(company->yearly_expenses[0]); i++) {
+		income -= company->yearly_expenses[0][i];
+	}
+	return income;
+}
+
 /** Send economic information of all companies. */
 NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyEconomy()
 {
 	const Company *company;
 	FOR_ALL_COMPANIES(company) {
-		/* Get the income. */
-		Money income = 0;
-		for (uint i = 0; i < lengthof(company->yearly_expenses[0]); i++) {
-			income -= company->yearly_expenses[0][i];
-		}
-
 		Packet *p = new Packet(ADMIN_PACKET_SERVER_COMPANY_ECONOMY);
 
 		p->Send_uint8(company->index);
@@ -418,7 +433,7 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyEconomy()
 		/* Current information. */
 		p->Send_uint64(company->money);
 		p->Send_uint64(company->current_loan);
-		p->Send_uint64(income);
+		p->Send_uint64(GetAdminCompanyIncome(company));
 		p->Send_uint16(min(UINT16_MAX, company->cur_economy.delivered_cargo.GetSum<OverflowSafeInt64>()));
 
 		/* Send stats for the last 2 quarters. */
@@ -465,6 +480,212 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyStats()
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Get the current state of the companies, for sending company deltas.
+ * @param[out] snapshot The state of the companies.
+ */
+static void FillAdminCompanySnapshot(AdminCompanySnapshot &snapshot)
+{
+	NetworkCompanyStats company_stats[MAX_COMPANIES];
+	NetworkPopulateCompanyStats(company_stats);
+
+	memset(&snapshot, 0, sizeof(snapshot));
+
+	const Company *company;
+	FOR_ALL_COMPANIES(company) {
+		int64 *values = snapshot.values[company->index];
+		snapshot.exists[company->index] = true;
+
+		values[ACDF_MONEY] = company->money;
+		values[ACDF_LOAN] = company->current_loan;
+		values[ACDF_INCOME] = GetAdminCompanyIncome(company);
+		values[ACDF_DELIVERED_CARGO] = min(UINT16_MAX, company->cur_economy.delivered_cargo.GetSum<OverflowSafeInt64>());
+		for (uint i = 0; i < 2; i++) {
+			values[ACDF_VALUE_LAST_QUARTER + i * 3] = company->old_economy[i].company_value;
+			values[ACDF_PERFORMANCE_LAST_QUARTER + i * 3] = company->old_economy[i].performance_history;
+			values[ACDF_DELIVERED_CARGO_LAST_QUARTER + i * 3] = min(UINT16_MAX, company->old_economy[i].delivered_cargo.GetSum<OverflowSafeInt64>());
+		}
+		for (uint i = 0; i < NETWORK_VEH_END; i++) {
+			values[ACDF_NUM_VEHICLES + i] = company_stats[company->index].num_vehicle[i];
+			values[ACDF_NUM_STATIONS + i] = company_stats[company->index].num_station[i];
+		}
+	}
+}
+
+/**
+ * Is a field of a company delta sent as uint64 instead of uint16?
+ * @param field The field.
+ * @return True for money amounts.
+ */
+static inline bool IsWideAdminCompanyDeltaField(uint field)
+{
+	return field <= ACDF_INCOME || field == ACDF_VALUE_LAST_QUARTER || field == ACDF_VALUE_PREVIOUS_QUARTER;
+}
+
+/**
+ * Send the economy and statistics of the companies that changed since the
+ * last acknowledged delta, or of all companies if there is none. Nothing
+ * is sent when nothing changed.
+ * @param current The current state of the companies.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyDelta(const AdminCompanySnapshot &current)
+{
+	const AdminCompanySnapshot &base = this->company_delta_base;
+	bool has_base = this->company_delta_base_seq != 0;
+
+	uint32 seq = this->company_delta_sent_seq + 1;
+	if (seq == 0) seq = 1;
+
+	Packet *p = nullptr;
+	for (CompanyID c = COMPANY_FIRST; c < MAX_COMPANIES; c++) {
+		bool existed = has_base && base.exists[c];
+		uint32 mask = 0;
+		if (current.exists[c]) {
+			for (uint f = 0; f < ACDF_END; f++) {
+				if (!existed || base.values[c][f] != current.values[c][f]) SetBit(mask, f);
+			}
+			if (mask == 0) continue;
+		} else if (!existed) {
+			continue;
+		}
+
+		/* Should SEND_MTU be exceeded, start a new packet
+		 * (magic 7: 1 bool "more data", one uint8 "company id", one uint32
+		 * "field mask" and 1 bool "no more data"; fields are at most 8 bytes) */
+		if (p != nullptr && p->size + 7 + ACDF_END * 8 >= SEND_MTU) {
+			p->Send_bool(false);
+			this->SendPacket(p);
+			p = nullptr;
+		}
+		if (p == nullptr) {
+			p = new Packet(ADMIN_PACKET_SERVER_COMPANY_DELTA);
+			p->Send_uint32(seq);
+			p->Send_uint32(this->company_delta_base_seq);
+		}
+
+		p->Send_bool(true);
+		p->Send_uint8(c);
+		p->Send_uint32(mask);
+		for (uint f = 0; f < ACDF_END; f++) {
+			if (!HasBit(mask, f)) continue;
+			if (IsWideAdminCompanyDeltaField(f)) {
+				p->Send_uint64(current.values[c][f]);
+			} else {
+				p->Send_uint16((uint16)current.values[c][f]);
+			}
+		}
+	}
+
+	/* Nothing changed since the acknowledged delta. */
+	if (p == nullptr) return NETWORK_RECV_STATUS_OKAY;
+
+	/* Marker to notify the end of the packet has been reached. */
+	p->Send_bool(false);
+	this->SendPacket(p);
+
+	this->company_delta_sent = current;
+	this->company_delta_sent_seq = seq;
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
+/**
+ * Send statistics about stations.
+ * @param owner Only send the stations of this owner, or #INVALID_OWNER for all stations.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendStationStats(Owner owner)
+{
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_STATION_STATS);
+
+	const Station *st;
+	FOR_ALL_STATIONS(st) {
+		if (owner != INVALID_OWNER && st->owner != owner) continue;
+
+		uint num_cargo = 0;
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			if (st->goods[c].HasRating()) num_cargo++;
+		}
+
+		/* Should SEND_MTU be exceeded, start a new packet
+		 * (magic 7: 1 bool "more data", one uint16 "station id", one uint8
+		 * "owner", "facilities" and "number of cargos" and 1 bool "no more
+		 * data"; magic 8: the size of the information per cargo) */
+		if (p->size + 7 + num_cargo * 8 >= SEND_MTU) {
+			p->Send_bool(false);
+			this->SendPacket(p);
+
+			p = new Packet(ADMIN_PACKET_SERVER_STATION_STATS);
+		}
+
+		p->Send_bool(true);
+		p->Send_uint16(st->index);
+		p->Send_uint8(st->owner);
+		p->Send_uint8(st->facilities);
+		p->Send_uint8(num_cargo);
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			const GoodsEntry *ge = &st->goods[c];
+			if (!ge->HasRating()) continue;
+
+			p->Send_uint8(c);
+			p->Send_uint8(ge->rating);
+			p->Send_uint32(ge->cargo.TotalCount());
+			p->Send_uint8(ge->time_since_pickup);
+			p->Send_uint8(ge->last_speed);
+		}
+	}
+
+	/* Marker to notify the end of the packet has been reached. */
+	p->Send_bool(false);
+	this->SendPacket(p);
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
+/**
+ * Send statistics about vehicle groups.
+ * @param owner Only send the groups of this company, or #INVALID_OWNER for all groups.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendGroupStats(Owner owner)
+{
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_GROUP_STATS);
+
+	const Group *g;
+	FOR_ALL_GROUPS(g) {
+		if (owner != INVALID_OWNER && g->owner != owner) continue;
+
+		const char *name = g->name != nullptr ? g->name : "";
+
+		/* Should SEND_MTU be exceeded, start a new packet
+		 * (magic 31: 1 bool "more data", the fixed size of the information of
+		 * a group, one byte for string '\0' termination and 1 bool "no more data") */
+		if (p->size + strlen(name) + 31 >= SEND_MTU) {
+			p->Send_bool(false);
+			this->SendPacket(p);
+
+			p = new Packet(ADMIN_PACKET_SERVER_GROUP_STATS);
+		}
+
+		const GroupStatistics &stats = g->statistics;
+		p->Send_bool(true);
+		p->Send_uint16(g->index);
+		p->Send_uint8(g->owner);
+		p->Send_uint8(g->vehicle_type);
+		p->Send_uint16(g->parent);
+		p->Send_string(name);
+		p->Send_uint16(stats.num_vehicle);
+		p->Send_uint64(stats.profit_last_year);
+		p->Send_uint16(stats.num_vehicle_nested);
+		p->Send_uint16(stats.num_profit_vehicle_nested);
+		p->Send_uint64(stats.profit_last_year_nested);
+	}
+
+	/* Marker to notify the end of the packet has been reached. */
+	p->Send_bool(false);
+	this->SendPacket(p);
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /**
  * Send a chat message.
  * @param action The action associated with the message.
@@ -558,6 +779,24 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_PING(Packet *p)
 	return this->SendPong(d1);
 }
 
+NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_COMPANY_DELTA_ACK(Packet *p)
+{
+	if (this->status == ADMIN_STATUS_INACTIVE) return this->SendError(NETWORK_ERROR_NOT_EXPECTED);
+
+	uint32 seq = p->Recv_uint32();
+
+	/* Only the last sent delta is kept; later deltas cover what older ones did. */
+	if (seq == 0 || seq != this->company_delta_sent_seq) {
+		DEBUG(net, 3, "[admin] Ignoring acknowledgement of company delta %u from '%s' (%s), last sent is %u", seq, this->admin_name, this->admin_version, this->company_delta_sent_seq);
+		return NETWORK_RECV_STATUS_OKAY;
+	}
+
+	this->company_delta_base = this->company_delta_sent;
+	this->company_delta_base_seq = seq;
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /**
  * Send console output of other clients.
  * @param origin The origin of the string.
@@ -778,6 +1017,24 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_COMPANY_DELTA: {
+			/* The admin is requesting what changed in the companies. */
+			AdminCompanySnapshot current;
+			FillAdminCompanySnapshot(current);
+			this->SendCompanyDelta(current);
+			break;
+		}
+
+		case ADMIN_UPDATE_STATION_STATS:
+			/* The admin is requesting station stats, of all or a single company. */
+			this->SendStationStats(d1 == UINT32_MAX ? INVALID_OWNER : (Owner)d1);
+			break;
+
+		case ADMIN_UPDATE_GROUP_STATS:
+			/* The admin is requesting group stats, of all or a single company. */
+			this->SendGroupStats(d1 == UINT32_MAX ? INVALID_OWNER : (Owner)d1);
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
@@ -1021,6 +1278,10 @@ void ServerNetworkAdminSocketHandler::WelcomeAll()
  */
 void NetworkAdminUpdate(AdminUpdateFrequency freq)
 {
+	/* The state of the companies is the same for all admins, so only get it once. */
+	AdminCompanySnapshot snapshot;
+	bool have_snapshot = false;
+
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		for (int i = 0; i < ADMIN_UPDATE_END; i++) {
@@ -1039,6 +1300,22 @@ void NetworkAdminUpdate(AdminUpdateFrequency freq)
 						as->SendCompanyStats();
 						break;
 
+					case ADMIN_UPDATE_COMPANY_DELTA:
+						if (!have_snapshot) {
+							FillAdminCompanySnapshot(snapshot);
+							have_snapshot = true;
+						}
+						as->SendCompanyDelta(snapshot);
+						break;
+
+					case ADMIN_UPDATE_STATION_STATS:
+						as->SendStationStats(INVALID_OWNER);
+						break;
+
+					case ADMIN_UPDATE_GROUP_STATS:
+						as->SendGroupStats(INVALID_OWNER);
+						break;
+
 					default: NOT_REACHED();
 				}
 			}
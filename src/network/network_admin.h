@@ -20,6 +20,12 @@
 
 extern AdminIndex _redirect_console_to_admin;
 
+/** State of the companies as sent in a company delta. */
+struct AdminCompanySnapshot {
+	bool exists[MAX_COMPANIES];            ///< Whether the company exists.
+	int64 values[MAX_COMPANIES][ACDF_END]; ///< Values of the fields of each company, see #AdminCompanyDeltaField.
+};
+
 class ServerNetworkAdminSocketHandler;
 /** Pool with all admin connections. */
 typedef Pool<ServerNetworkAdminSocketHandler, AdminIndex, 2, MAX_ADMINS, PT_NADMIN> NetworkAdminSocketPool;
@@ -36,6 +42,7 @@ protected:
 	virtual NetworkRecvStatus Receive_ADMIN_RCON(Packet *p);
 	virtual NetworkRecvStatus Receive_ADMIN_GAMESCRIPT(Packet *p);
 	virtual NetworkRecvStatus Receive_ADMIN_PING(Packet *p);
+	virtual NetworkRecvStatus Receive_ADMIN_COMPANY_DELTA_ACK(Packet *p);
 
 	NetworkRecvStatus SendProtocol();
 	NetworkRecvStatus SendPong(uint32 d1);
@@ -44,6 +51,11 @@ public:
 	uint32 realtime_connect;                                 ///< Time of connection.
 	NetworkAddress address;                                  ///< Address of the admin.
 
+	AdminCompanySnapshot company_delta_sent;                 ///< Company state of the last sent company delta.
+	AdminCompanySnapshot company_delta_base;                 ///< Company state of the last acknowledged company delta.
+	uint32 company_delta_sent_seq;                           ///< Sequence number of the last sent company delta, 0 for none.
+	uint32 company_delta_base_seq;                           ///< Sequence number of the last acknowledged company delta, 0 for none.
+
 	ServerNetworkAdminSocketHandler(SOCKET s);
 	~ServerNetworkAdminSocketHandler();
 
@@ -64,6 +76,9 @@ public:
 	NetworkRecvStatus SendCompanyRemove(CompanyID company_id, AdminCompanyRemoveReason bcrr);
 	NetworkRecvStatus SendCompanyEconomy();
 	NetworkRecvStatus SendCompanyStats();
+	NetworkRecvStatus SendCompanyDelta(const AdminCompanySnapshot &current);
+	NetworkRecvStatus SendStationStats(Owner owner);
+	NetworkRecvStatus SendGroupStats(Owner owner);
 
 	NetworkRecvStatus SendChat(NetworkAction action, DestType desttype, ClientID client_id, const char *msg, NetworkTextMessageData data);
 	NetworkRecvStatus SendRcon(uint16 colour, const char *command);
@@ -74,7 +89,7 @@ public:
 	NetworkRecvStatus SendRconEnd(const char *command);
 
 	static void Send();
-	static void AcceptConnection(SOCKET s, const NetworkAddress &address);
+	static ServerNetworkAdminSocketHandler *AcceptConnection(SOCKET s, const NetworkAddress &address);
 	static bool AllowConnection();
 	static void WelcomeAll();
 
@@ -0,0 +1,236 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file network_load_test.cpp Opening many local connections to our own server to see how it copes with them.
+ * Game connections keep asking for the company information like server
+ * browsers do; the server drops them after max_init_time and then they are
+ * opened again. Admin connections log in, ask for daily date updates and
+ * ping the server every second.
+ */
+
+#ifdef ENABLE_NETWORK
+
+#include "../stdafx.h"
+#include "../debug.h"
+#include "../settings_type.h"
+#include "../string_func.h"
+#include "../core/mem_func.hpp"
+#include "core/tcp_game.h"
+#include "core/tcp_admin.h"
+#include "network_internal.h"
+#include "network_func.h"
+#include "network_load_test.h"
+
+#include <vector>
+
+#include "../safeguards.h"
+
+uint64 _network_receive_cycles = 0; ///< Cycles the server spent waiting for and handling its sockets since the last #NetworkLoadTestGetStats.
+uint _network_receive_calls = 0;    ///< Number of times the server handled its sockets since the last #NetworkLoadTestGetStats.
+
+/** Milliseconds between the requests of a connection. */
+static const uint32 LOAD_TEST_REQUEST_INTERVAL = 1000;
+
+/** A connection opened by the load test. */
+struct LoadTestConnection {
+	SOCKET sock;         ///< The socket, or INVALID_SOCKET when it has to be opened (again).
+	bool admin;          ///< Whether it connects to the admin port instead of the game port.
+	bool joined;         ///< Whether the admin connection sent its login.
+	uint32 next_request; ///< Realtime tick to send the next request at.
+};
+
+static std::vector<LoadTestConnection> _load_test_connections; ///< All connections of the load test.
+static NetworkLoadTestStats _load_test_stats;                   ///< Statistics since the last #NetworkLoadTestGetStats.
+
+/**
+ * Get the address the server listens on; the first of the 'server_bind_addresses',
+ * or the loopback address when the server listens on all addresses.
+ * @param port The port.
+ * @return The address.
+ */
+static NetworkAddress GetLoadTestAddress(uint16 port)
+{
+	const char *hostname = _network_bind_list.Length() == 0 ? "" : _network_bind_list[0];
+	if (StrEmpty(hostname) || strcmp(hostname, "0.0.0.0") == 0) return NetworkAddress("127.0.0.1", port, AF_INET);
+	if (strcmp(hostname, "::") == 0) return NetworkAddress("::1", port, AF_INET6);
+	return NetworkAddress(hostname, port);
+}
+
+/**
+ * Start connecting to our own server without waiting for the connection to be made.
+ * @param admin Whether to connect to the admin port instead of the game port.
+ * @return The socket, or INVALID_SOCKET on failure.
+ */
+static SOCKET OpenLoadTestSocket(bool admin)
+{
+	NetworkAddress address = GetLoadTestAddress(admin ? _settings_client.network.server_admin_port : _settings_client.network.server_port);
+	if (address.GetAddressLength() == 0) return INVALID_SOCKET;
+
+	SOCKET s = socket(address.GetAddress()->ss_family, SOCK_STREAM, IPPROTO_TCP);
+	if (s == INVALID_SOCKET) return INVALID_SOCKET;
+
+	if (!SetNonBlocking(s)) DEBUG(net, 0, "[load test] setting non-blocking mode failed");
+	SetNoDelay(s);
+
+	if (connect(s, (const struct sockaddr *)address.GetAddress(), address.GetAddressLength()) != 0) {
+		int err = GET_LAST_ERROR();
+		if (err != EWOULDBLOCK && err != EINPROGRESS) {
+			DEBUG(net, 1, "[load test] connect failed with error %d", err);
+			closesocket(s);
+			return INVALID_SOCKET;
+		}
+	}
+	return s;
+}
+
+/**
+ * Send a packet over a load test connection in one go.
+ * @param s The socket.
+ * @param p The packet.
+ * @return 1 when sent, 0 when the socket is not ready yet and -1 when the connection is broken.
+ */
+static int SendLoadTestPacket(SOCKET s, Packet &p)
+{
+	p.PrepareToSend();
+	ssize_t res = send(s, (const char *)p.buffer, p.size, 0);
+	if (res == p.size) return 1;
+	if (res == -1) {
+		int err = GET_LAST_ERROR();
+		if (err == EWOULDBLOCK || err == ENOTCONN) return 0;
+	}
+	/* A partially sent packet leaves the stream broken. */
+	return -1;
+}
+
+/**
+ * Send the next request over a load test connection, if it is time for one.
+ * @param c The connection.
+ * @return False when the connection is broken.
+ */
+static bool SendLoadTestRequest(LoadTestConnection &c)
+{
+	if ((int32)(_realtime_tick - c.next_request) < 0) return true;
+
+	int res;
+	if (!c.admin) {
+		Packet p(PACKET_CLIENT_COMPANY_INFO);
+		res = SendLoadTestPacket(c.sock, p);
+	} else if (!c.joined) {
+		Packet p(ADMIN_PACKET_ADMIN_JOIN);
+		p.Send_string(_settings_client.network.admin_password);
+		p.Send_string("load test");
+		p.Send_string("1");
+		res = SendLoadTestPacket(c.sock, p);
+		if (res != 1) return res == 0;
+
+		Packet q(ADMIN_PACKET_ADMIN_UPDATE_FREQUENCY);
+		q.Send_uint16(ADMIN_UPDATE_DATE);
+		q.Send_uint16(ADMIN_FREQUENCY_DAILY);
+		res = SendLoadTestPacket(c.sock, q);
+		c.joined = true;
+	} else {
+		Packet p(ADMIN_PACKET_ADMIN_PING);
+		p.Send_uint32(_realtime_tick);
+		res = SendLoadTestPacket(c.sock, p);
+	}
+
+	if (res == 1) c.next_request = _realtime_tick + LOAD_TEST_REQUEST_INTERVAL;
+	return res != -1;
+}
+
+/**
+ * Throw away everything the server sent over a load test connection.
+ * @param c The connection.
+ * @return False when the server closed the connection.
+ */
+static bool DrainLoadTestSocket(LoadTestConnection &c)
+{
+	char buffer[4096];
+	for (;;) {
+		ssize_t res = recv(c.sock, buffer, sizeof(buffer), 0);
+		if (res > 0) {
+			_load_test_stats.bytes_received += res;
+			continue;
+		}
+		if (res == 0) return false;
+
+		int err = GET_LAST_ERROR();
+		return err == EWOULDBLOCK || err == ENOTCONN;
+	}
+}
+
+/**
+ * Add connections to the load test; they are opened by #NetworkLoadTestLoop.
+ * @param count Number of connections to add.
+ * @param admin Whether to connect to the admin port instead of the game port.
+ */
+void NetworkLoadTestOpen(uint count, bool admin)
+{
+	for (uint i = 0; i < count; i++) {
+		LoadTestConnection c = { INVALID_SOCKET, admin, false, 0 };
+		_load_test_connections.push_back(c);
+	}
+}
+
+/** Close all connections of the load test. */
+void NetworkLoadTestClose()
+{
+	for (LoadTestConnection &c : _load_test_connections) {
+		if (c.sock != INVALID_SOCKET) closesocket(c.sock);
+	}
+	_load_test_connections.clear();
+}
+
+/** Open, feed and drain the connections of the load test. */
+void NetworkLoadTestLoop()
+{
+	for (LoadTestConnection &c : _load_test_connections) {
+		if (c.sock == INVALID_SOCKET) {
+			c.sock = OpenLoadTestSocket(c.admin);
+			c.joined = false;
+			c.next_request = _realtime_tick;
+			if (c.sock != INVALID_SOCKET) _load_test_stats.connects++;
+			continue;
+		}
+
+		if (!DrainLoadTestSocket(c) || !SendLoadTestRequest(c)) {
+			closesocket(c.sock);
+			c.sock = INVALID_SOCKET;
+			_load_test_stats.closes++;
+		}
+	}
+}
+
+/**
+ * Get the statistics of the load test and start counting anew.
+ * @return The statistics since the previous call.
+ */
+NetworkLoadTestStats NetworkLoadTestGetStats()
+{
+	_load_test_stats.game_connections = 0;
+	_load_test_stats.admin_connections = 0;
+	for (const LoadTestConnection &c : _load_test_connections) {
+		if (c.admin) {
+			_load_test_stats.admin_connections++;
+		} else {
+			_load_test_stats.game_connections++;
+		}
+	}
+	_load_test_stats.receive_cycles = _network_receive_cycles;
+	_load_test_stats.receive_calls = _network_receive_calls;
+
+	NetworkLoadTestStats stats = _load_test_stats;
+	MemSetT(&_load_test_stats, 0);
+	_network_receive_cycles = 0;
+	_network_receive_calls = 0;
+	return stats;
+}
+
+#endif /* ENABLE_NETWORK */
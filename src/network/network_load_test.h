@@ -0,0 +1,38 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file network_load_test.h Opening many local connections to our own server to see how it copes with them. */
+
+#ifndef NETWORK_LOAD_TEST_H
+#define NETWORK_LOAD_TEST_H
+
+#ifdef ENABLE_NETWORK
+
+/** What happened to the load test connections, and what it cost the server. */
+struct NetworkLoadTestStats {
+	uint game_connections;  ///< Number of connections to the game port being kept open.
+	uint admin_connections; ///< Number of connections to the admin port being kept open.
+	uint connects;          ///< Number of times a connection was opened.
+	uint closes;            ///< Number of times the server closed a connection.
+	uint64 bytes_received;  ///< Bytes received from the server.
+	uint64 receive_cycles;  ///< Cycles the server spent waiting for and handling its sockets.
+	uint receive_calls;     ///< Number of times the server handled its sockets.
+};
+
+extern uint64 _network_receive_cycles;
+extern uint _network_receive_calls;
+
+void NetworkLoadTestOpen(uint count, bool admin);
+void NetworkLoadTestClose();
+void NetworkLoadTestLoop();
+NetworkLoadTestStats NetworkLoadTestGetStats();
+
+#endif /* ENABLE_NETWORK */
+
+#endif /* NETWORK_LOAD_TEST_H */
@@ -32,6 +32,7 @@
 #include "../core/pool_func.hpp"
 #include "../core/random_func.hpp"
 #include "../rev.h"
+#include "../event_log.h"
 
 #include "../safeguards.h"
 
@@ -53,6 +54,9 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
+#ifdef HAVE_EPOLL
+template int TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::epoll_fd;
+#endif /* HAVE_EPOLL */
 
 /** Writing a savegame directly to a number of packets. */
 struct PacketWriter : SaveFilter {
@@ -60,13 +64,14 @@ struct PacketWriter : SaveFilter {
 	Packet *current;                    ///< The packet we're currently writing to.
 	size_t total_size;                  ///< Total size of the compressed savegame.
 	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
+	Packet *last_packet;                ///< Last packet of #packets, for appending in constant time.
 	ThreadMutex *mutex;                 ///< Mutex for making threaded saving safe.
 
 	/**
 	 * Create the packet writer.
 	 * @param cs The socket handler we're making the packets for.
 	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(nullptr), cs(cs), current(nullptr), total_size(0), packets(nullptr)
+	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(nullptr), cs(cs), current(nullptr), total_size(0), packets(nullptr), last_packet(nullptr)
 	{
 		this->mutex = ThreadMutex::New();
 	}
@@ -144,6 +149,7 @@ struct PacketWriter : SaveFilter {
 
 		Packet *p = this->packets;
 		this->packets = p->next;
+		if (this->packets == nullptr) this->last_packet = nullptr;
 		p->next = nullptr;
 
 		if (this->mutex != nullptr) this->mutex->EndCritical();
@@ -156,11 +162,12 @@ struct PacketWriter : SaveFilter {
 	{
 		if (this->current == nullptr) return;
 
-		Packet **p = &this->packets;
-		while (*p != nullptr) {
-			p = &(*p)->next;
+		if (this->last_packet == nullptr) {
+			this->packets = this->current;
+		} else {
+			this->last_packet->next = this->current;
 		}
-		*p = this->current;
+		this->last_packet = this->current;
 
 		this->current = nullptr;
 	}
@@ -279,6 +286,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::CloseConnection(NetworkRecvSta
 		this->GetClientName(client_name, lastof(client_name));
 
 		NetworkTextMessage(NETWORK_ACTION_LEAVE, CC_DEFAULT, false, client_name, nullptr, STR_NETWORK_ERROR_CLIENT_CONNECTION_LOST);
+		EVENT_LOG(ELE_NET_CLIENT_ERROR, this->client_id, NETWORK_ERROR_CONNECTION_LOST, _frame_counter, 0);
 
 		/* Inform other clients of this... strange leaving ;) */
 		FOR_ALL_CLIENT_SOCKETS(new_cs) {
@@ -447,6 +455,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendError(NetworkErrorCode err
 		this->GetClientName(client_name, lastof(client_name));
 
 		DEBUG(net, 1, "'%s' made an error and has been disconnected. Reason: '%s'", client_name, str);
+		EVENT_LOG(ELE_NET_CLIENT_ERROR, this->client_id, error, _frame_counter, 0);
 
 		NetworkTextMessage(NETWORK_ACTION_LEAVE, CC_DEFAULT, false, client_name, nullptr, strid);
 
@@ -1068,6 +1077,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_MAP_OK(Packet *
 		this->GetClientName(client_name, lastof(client_name));
 
 		NetworkTextMessage(NETWORK_ACTION_JOIN, CC_DEFAULT, false, client_name, nullptr, this->client_id);
+		EVENT_LOG(ELE_NET_CLIENT_JOINED, this->client_id, _frame_counter, 0, 0);
 
 		/* Mark the client as pre-active, and wait for an ACK
 		 *  so we know he is done loading and in sync with us */
@@ -1165,6 +1175,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_COMMAND(Packet
 
 	if (GetCommandFlags(cp.cmd) & CMD_CLIENT_ID) cp.p2 = this->client_id;
 
+	EVENT_LOG(ELE_NET_COMMAND_QUEUED, this->client_id, cp.cmd, cp.company, _frame_counter);
 	this->incoming_queue.Append(&cp);
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -1189,6 +1200,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_ERROR(Packet *p
 	GetString(str, strid, lastof(str));
 
 	DEBUG(net, 2, "'%s' reported an error and is closing its connection (%s)", client_name, str);
+	EVENT_LOG(ELE_NET_CLIENT_ERROR, this->client_id, errorno, _frame_counter, 0);
 
 	NetworkTextMessage(NETWORK_ACTION_LEAVE, CC_DEFAULT, false, client_name, nullptr, strid);
 
@@ -1223,6 +1235,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_QUIT(Packet *p)
 	this->GetClientName(client_name, lastof(client_name));
 
 	NetworkTextMessage(NETWORK_ACTION_LEAVE, CC_DEFAULT, false, client_name, nullptr, STR_NETWORK_MESSAGE_CLIENT_LEAVING);
+	EVENT_LOG(ELE_NET_CLIENT_QUIT, this->client_id, _frame_counter, 0, 0);
 
 	FOR_ALL_CLIENT_SOCKETS(new_cs) {
 		if (new_cs->status > STATUS_AUTHORIZED && new_cs != this) {
@@ -16,6 +16,7 @@
 
 #include "debug.h"
 #include "fileio_func.h"
+#include "spritecache_disk.h"
 #include "engine_func.h"
 #include "engine_base.h"
 #include "bridge.h"
@@ -49,6 +50,7 @@
 #include "vehicle_func.h"
 #include "language.h"
 #include "vehicle_base.h"
+#include "thread/thread.h"
 
 #include "table/strings.h"
 #include "table/build_industry.h"
@@ -9202,6 +9204,95 @@ byte GetGRFContainerVersion()
 	return 1;
 }
 
+/** A NewGRF read ahead of the loading stages by #PrescanNewGRFFiles. */
+struct GRFPrescan {
+	const GRFConfig *config;  ///< The NewGRF.
+	Subdirectory subdir;      ///< The sub directory to find the NewGRF in.
+	byte container_ver;       ///< Container version of the NewGRF, or 0 if it could not be read.
+	GRFSpriteOffsets offsets; ///< Position of the sprites in the sprite section of the NewGRF.
+};
+
+static std::vector<GRFPrescan> _grf_prescan;      ///< The NewGRFs read ahead of the loading stages.
+static uint _grf_prescan_next;                    ///< Index in #_grf_prescan of the next NewGRF to read.
+static ThreadMutex *_grf_prescan_mutex = nullptr; ///< Protects #_grf_prescan_next.
+
+/**
+ * Worker of #PrescanNewGRFFiles; reads NewGRFs until there are none left.
+ * @param arg Unused.
+ */
+static void PrescanNewGRFThread(void *arg)
+{
+	for (;;) {
+		_grf_prescan_mutex->BeginCritical();
+		uint index = _grf_prescan_next++;
+		_grf_prescan_mutex->EndCritical();
+		if (index >= _grf_prescan.size()) return;
+
+		GRFPrescan &prescan = _grf_prescan[index];
+		size_t size;
+		FILE *f = FioFOpenFile(prescan.config->filename, "rb", prescan.subdir, &size);
+		if (f == nullptr) continue;
+		prescan.container_ver = IndexGRFSpriteOffsets(f, size, &prescan.offsets);
+		FioFCloseFile(f);
+	}
+}
+
+/**
+ * Read all NewGRFs that are going to be loaded and index the sprites in
+ * their sprite sections. This does not depend on the order of the NewGRFs,
+ * so it is spread over as many threads as there are processor cores. It
+ * leaves the NewGRFs in the cache of the OS and saves the loading stages
+ * from scanning each sprite section again.
+ * @param num_baseset Number of NewGRFs at the front of the list that belong to the base set.
+ */
+static void PrescanNewGRFFiles(uint num_baseset)
+{
+	_grf_prescan.clear();
+	for (const GRFConfig *c = _grfconfig; c != nullptr; c = c->next) {
+		if (c->status == GCS_DISABLED || c->status == GCS_NOT_FOUND) continue;
+
+		_grf_prescan.emplace_back();
+		GRFPrescan &prescan = _grf_prescan.back();
+		prescan.config = c;
+		prescan.subdir = _grf_prescan.size() <= num_baseset ? BASESET_DIR : NEWGRF_DIR;
+		prescan.container_ver = 0;
+	}
+	if (_grf_prescan.empty()) return;
+
+	if (_grf_prescan_mutex == nullptr) _grf_prescan_mutex = ThreadMutex::New();
+	_grf_prescan_next = 0;
+
+	/* The calling thread is a worker too. */
+	uint num_threads = min<uint>(GetCPUCoreCount(), _grf_prescan.size()) - 1;
+	ThreadObject **threads = CallocT<ThreadObject *>(max(num_threads, 1U));
+	for (uint i = 0; i < num_threads; i++) {
+		if (!ThreadObject::New(&PrescanNewGRFThread, nullptr, &threads[i], "ottd:grfscan")) threads[i] = nullptr;
+	}
+	PrescanNewGRFThread(nullptr);
+	for (uint i = 0; i < num_threads; i++) {
+		if (threads[i] == nullptr) continue;
+		threads[i]->Join();
+		delete threads[i];
+	}
+	free(threads);
+
+	DEBUG(grf, 2, "PrescanNewGRFFiles: Read %u NewGRFs using %u threads", (uint)_grf_prescan.size(), num_threads + 1);
+}
+
+/**
+ * Get the sprite offsets of a NewGRF as found by #PrescanNewGRFFiles.
+ * @param config The NewGRF.
+ * @param container_ver Container version of the NewGRF as found by the loading stage.
+ * @return The sprite offsets, or \c nullptr if the NewGRF was not read ahead.
+ */
+static const GRFSpriteOffsets *GetPrescannedSpriteOffsets(const GRFConfig *config, byte container_ver)
+{
+	for (const GRFPrescan &prescan : _grf_prescan) {
+		if (prescan.config == config) return prescan.container_ver == container_ver ? &prescan.offsets : nullptr;
+	}
+	return nullptr;
+}
+
 /**
  * Load a particular NewGRF.
  * @param config     The configuration of the to be loaded NewGRF.
@@ -9237,6 +9328,7 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 	}
 
 	FioOpenFile(file_index, filename, subdir);
+	SetSpriteFileMD5(file_index, config->ident.md5sum);
 	_cur.file_index = file_index; // XXX
 	_palette_remap_grf[_cur.file_index] = (config->palette & GRFP_USE_MASK);
 
@@ -9253,7 +9345,7 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 	if (stage == GLS_INIT || stage == GLS_ACTIVATION) {
 		/* We need the sprite offsets in the init stage for NewGRF sounds
 		 * and in the activation stage for real sprites. */
-		ReadGRFSpriteOffsets(_cur.grf_container_ver);
+		ReadGRFSpriteOffsets(_cur.grf_container_ver, GetPrescannedSpriteOffsets(config, _cur.grf_container_ver));
 	} else {
 		/* Skip sprite section offset if present. */
 		if (_cur.grf_container_ver >= 2) FioReadDword();
@@ -9644,6 +9736,8 @@ void LoadNewGRF(uint load_index, uint file_index, uint num_baseset)
 
 	_cur.spriteid = load_index;
 
+	PrescanNewGRFFiles(num_baseset);
+
 	/* Load newgrf sprites
 	 * in each loading stage, (try to) open each file specified in the config
 	 * and load information from it. */
@@ -9709,6 +9803,8 @@ void LoadNewGRF(uint load_index, uint file_index, uint num_baseset)
 
 	/* Pseudo sprite processing is finished; free temporary stuff */
 	_cur.ClearDataForNextFile();
+	ReadGRFSpriteOffsets(0);
+	_grf_prescan.clear();
 
 	/* Call any functions that should be run after GRFs have been loaded. */
 	AfterLoadGRFs();
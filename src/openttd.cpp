@@ -51,6 +51,7 @@
 #include "station_base.h"
 #include "crashlog.h"
 #include "engine_func.h"
+#include "event_log.h"
 #include "core/random_func.hpp"
 #include "rail_gui.h"
 #include "road_gui.h"
@@ -72,6 +73,7 @@
 
 #include "linkgraph/linkgraphschedule.h"
 #include "tracerestrict.h"
+#include "thread/thread.h"
 
 #include <stdarg.h>
 
@@ -897,6 +899,7 @@ int openttd_main(int argc, char *argv[])
 	VideoDriver::GetInstance()->MainLoop();
 
 	WaitTillSaved();
+	StopEventLog();
 
 	/* only save config if we have to */
 	if (save_config) {
@@ -1230,21 +1233,44 @@ void SwitchToMode(SwitchMode new_mode)
 }
 
 
+/** The families of caches that are checked by #CheckCaches. */
+enum DesyncCacheCheck {
+	DCC_TOWNS,          ///< Town caches and the subsidy flags of towns and industries.
+	DCC_INFRASTRUCTURE, ///< Infrastructure counts of the companies.
+	DCC_ROAD_STOPS,     ///< Occupancy of drive through road stops.
+	DCC_VEHICLES,       ///< NewGRF, vehicle, ground vehicle and train caches.
+	DCC_VEHICLE_CARGO,  ///< Cached totals of the cargo lists of vehicles.
+	DCC_STATION_CARGO,  ///< Cached totals of the cargo lists of stations.
+	DCC_END,            ///< End marker.
+};
+
+uint8 _check_caches_per_tick; ///< Number of cache families #CheckCaches validates per tick, 0 for all of them.
+
+/** Mismatches found by a cache check, printed once all checks of a tick are done. */
+struct CacheCheckMessages {
+	std::vector<std::pair<int, std::string>> lines; ///< Debug level and text of every mismatch.
+
+	void Add(int level, const char *format, ...) WARN_FORMAT(3, 4);
+};
+
 /**
- * Check the validity of some of the caches.
- * Especially in the sense of desyncs between
- * the cached value and what the value would
- * be when calculated from the 'base' data.
+ * Remember a mismatch.
+ * @param level Debug level of the desync category to print the message at.
+ * @param format Format of the message.
  */
-void CheckCaches(bool force_check)
+void CDECL CacheCheckMessages::Add(int level, const char *format, ...)
 {
-	if (!force_check) {
-		/* Return here so it is easy to add checks that are run
-		 * always to aid testing of caches. */
-		if (_debug_desync_level < 1) return;
-	}
+	char buffer[4096 + 64];
+	va_list va;
+	va_start(va, format);
+	vseprintf(buffer, lastof(buffer), format, va);
+	va_end(va);
+	this->lines.emplace_back(level, buffer);
+}
 
-	/* Check the town caches. */
+/** Check the town caches. */
+static void CheckTownCaches(CacheCheckMessages &messages)
+{
 	SmallVector<TownCache, 4> old_town_caches;
 	Town *t;
 	FOR_ALL_TOWNS(t) {
@@ -1258,12 +1284,15 @@ void CheckCaches(bool force_check)
 	uint i = 0;
 	FOR_ALL_TOWNS(t) {
 		if (MemCmpT(old_town_caches.Get(i), &t->cache) != 0) {
-			DEBUG(desync, 2, "town cache mismatch: town %i", (int)t->index);
+			messages.Add(2, "town cache mismatch: town %i", (int)t->index);
 		}
 		i++;
 	}
+}
 
-	/* Check company infrastructure cache. */
+/** Check company infrastructure cache. */
+static void CheckInfrastructureCaches(CacheCheckMessages &messages)
+{
 	SmallVector<CompanyInfrastructure, 4> old_infrastructure;
 	Company *c;
 	FOR_ALL_COMPANIES(c) MemCpyT(old_infrastructure.Append(), &c->infrastructure);
@@ -1271,20 +1300,23 @@ void CheckCaches(bool force_check)
 	extern void AfterLoadCompanyStats();
 	AfterLoadCompanyStats();
 
-	i = 0;
+	uint i = 0;
 	FOR_ALL_COMPANIES(c) {
 		if (MemCmpT(old_infrastructure.Get(i), &c->infrastructure) != 0) {
-			DEBUG(desync, 2, "infrastructure cache mismatch: company %i", (int)c->index);
+			messages.Add(2, "infrastructure cache mismatch: company %i", (int)c->index);
 			char buffer[4096];
 			old_infrastructure.Get(i)->Dump(buffer, lastof(buffer));
-			DEBUG(desync, 0, "Previous:\n%s", buffer);
+			messages.Add(0, "Previous:\n%s", buffer);
 			c->infrastructure.Dump(buffer, lastof(buffer));
-			DEBUG(desync, 0, "Recalculated:\n%s", buffer);
+			messages.Add(0, "Recalculated:\n%s", buffer);
 		}
 		i++;
 	}
+}
 
-	/* Strict checking of the road stop cache entries */
+/** Strict checking of the road stop cache entries */
+static void CheckRoadStopCaches(CacheCheckMessages &messages)
+{
 	const RoadStop *rs;
 	FOR_ALL_ROADSTOPS(rs) {
 		if (IsStandardRoadStopTile(rs->xy)) continue;
@@ -1293,7 +1325,11 @@ void CheckCaches(bool force_check)
 		rs->GetEntry(DIAGDIR_NE)->CheckIntegrity(rs);
 		rs->GetEntry(DIAGDIR_NW)->CheckIntegrity(rs);
 	}
+}
 
+/** Check the caches of the vehicles by updating them. */
+static void CheckVehicleCaches(CacheCheckMessages &messages)
+{
 	Vehicle *v;
 	FOR_ALL_VEHICLES(v) {
 		extern void FillNewGRFVehicleCache(const Vehicle *v);
@@ -1338,23 +1374,23 @@ void CheckCaches(bool force_check)
 		for (const Vehicle *u = v; u != nullptr; u = u->Next()) {
 			FillNewGRFVehicleCache(u);
 			if (memcmp(&grf_cache[length], &u->grf_cache, sizeof(NewGRFCache)) != 0) {
-				DEBUG(desync, 2, "newgrf cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
+				messages.Add(2, "newgrf cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
 			}
 			if (memcmp(&veh_cache[length], &u->vcache, sizeof(VehicleCache)) != 0) {
-				DEBUG(desync, 2, "vehicle cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
+				messages.Add(2, "vehicle cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
 			}
 			switch (u->type) {
 				case VEH_TRAIN:
 					if (memcmp(&gro_cache[length], &Train::From(u)->gcache, sizeof(GroundVehicleCache)) != 0) {
-						DEBUG(desync, 2, "train ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
+						messages.Add(2, "train ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
 					}
 					if (memcmp(&tra_cache[length], &Train::From(u)->tcache, sizeof(TrainCache)) != 0) {
-						DEBUG(desync, 2, "train cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
+						messages.Add(2, "train cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
 					}
 					break;
 				case VEH_ROAD:
 					if (memcmp(&gro_cache[length], &RoadVehicle::From(u)->gcache, sizeof(GroundVehicleCache)) != 0) {
-						DEBUG(desync, 2, "road vehicle ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
+						messages.Add(2, "road vehicle ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
 					}
 					break;
 				default:
@@ -1368,15 +1404,23 @@ void CheckCaches(bool force_check)
 		free(gro_cache);
 		free(tra_cache);
 	}
+}
 
-	/* Check whether the caches are still valid */
+/** Check whether the cargo list caches of the vehicles are still valid. */
+static void CheckVehicleCargoCaches(CacheCheckMessages &messages)
+{
+	Vehicle *v;
 	FOR_ALL_VEHICLES(v) {
 		byte buff[sizeof(VehicleCargoList)];
 		memcpy(buff, &v->cargo, sizeof(VehicleCargoList));
 		v->cargo.InvalidateCache();
 		assert(memcmp(&v->cargo, buff, sizeof(VehicleCargoList)) == 0);
 	}
+}
 
+/** Check whether the cargo list caches of the stations are still valid. */
+static void CheckStationCargoCaches(CacheCheckMessages &messages)
+{
 	Station *st;
 	FOR_ALL_STATIONS(st) {
 		for (CargoID c = 0; c < NUM_CARGO; c++) {
@@ -1387,7 +1431,106 @@ void CheckCaches(bool force_check)
 		}
 	}
 }
- 
+
+/** A cache check and where it may run. */
+struct DesyncCacheCheckInfo {
+	void (*proc)(CacheCheckMessages &messages); ///< Function doing the check.
+	/**
+	 * Whether the check may run on a thread of its own, next to the others.
+	 * Checks that resolve NewGRF callbacks share the global state of the
+	 * resolvers, and checks that look at vehicles read what the vehicle
+	 * check rewrites, so those run one after another on the main thread.
+	 */
+	bool concurrent;
+};
+
+/** All cache checks, indexed by #DesyncCacheCheck. */
+static const DesyncCacheCheckInfo _desync_cache_checks[DCC_END] = {
+	{ &CheckTownCaches,           false },
+	{ &CheckInfrastructureCaches, true  },
+	{ &CheckRoadStopCaches,       false },
+	{ &CheckVehicleCaches,        false },
+	{ &CheckVehicleCargoCaches,   false },
+	{ &CheckStationCargoCaches,   true  },
+};
+
+/** A cache check running on a thread of its own. */
+struct DesyncCacheCheckJob {
+	const DesyncCacheCheckInfo *check; ///< The check to run.
+	CacheCheckMessages *messages;      ///< Where to store the mismatches.
+};
+
+/**
+ * Entry point of the threads running a cache check.
+ * @param arg The #DesyncCacheCheckJob to run.
+ */
+static void DesyncCacheCheckThread(void *arg)
+{
+	DesyncCacheCheckJob *job = (DesyncCacheCheckJob *)arg;
+	job->check->proc(*job->messages);
+}
+
+/**
+ * Check the validity of some of the caches.
+ * Especially in the sense of desyncs between
+ * the cached value and what the value would
+ * be when calculated from the 'base' data.
+ * With #_check_caches_per_tick set, unforced checks only validate that
+ * many families of caches, the next ones in turn every time.
+ * The game state does not change while the checks run, so the checks
+ * that do not interfere with each other run concurrently.
+ */
+void CheckCaches(bool force_check)
+{
+	if (!force_check) {
+		/* Return here so it is easy to add checks that are run
+		 * always to aid testing of caches. */
+		if (_debug_desync_level < 1) return;
+	}
+
+	static uint next_check = 0;
+	bool selected[DCC_END];
+	uint num_selected = 0;
+	if (force_check || _check_caches_per_tick == 0 || _check_caches_per_tick >= DCC_END) {
+		for (uint i = 0; i < DCC_END; i++) selected[i] = true;
+		num_selected = DCC_END;
+	} else {
+		for (uint i = 0; i < DCC_END; i++) selected[i] = false;
+		for (; num_selected < _check_caches_per_tick; num_selected++) {
+			selected[next_check] = true;
+			next_check = (next_check + 1) % DCC_END;
+		}
+	}
+
+	CacheCheckMessages messages[DCC_END];
+	DesyncCacheCheckJob jobs[DCC_END];
+	ThreadObject *threads[DCC_END];
+	for (uint i = 0; i < DCC_END; i++) {
+		threads[i] = nullptr;
+		/* Starting a thread only pays off when the main thread has other checks to do meanwhile. */
+		if (!selected[i] || !_desync_cache_checks[i].concurrent || num_selected == 1) continue;
+
+		jobs[i].check = &_desync_cache_checks[i];
+		jobs[i].messages = &messages[i];
+		if (!ThreadObject::New(&DesyncCacheCheckThread, &jobs[i], &threads[i], "ottd:cachecheck")) threads[i] = nullptr;
+	}
+
+	for (uint i = 0; i < DCC_END; i++) {
+		if (selected[i] && threads[i] == nullptr) _desync_cache_checks[i].proc(messages[i]);
+	}
+
+	for (uint i = 0; i < DCC_END; i++) {
+		if (threads[i] != nullptr) {
+			threads[i]->Join();
+			delete threads[i];
+		}
+
+		for (const auto &line : messages[i].lines) {
+			DEBUG(desync, line.first, "%s", line.second.c_str());
+		}
+	}
+}
+
 /**
  * Network-safe forced desync check.
  * @param tile unused
@@ -1449,6 +1592,11 @@ void StateGameLoop()
 			SaveOrLoad(name, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR, false);
 		}
 
+#ifndef NO_EVENT_LOG
+		/* Only read the clock when the game loop is being recorded. */
+		const uint64 tick_start = HasBit(_event_log_categories.load(std::memory_order_relaxed), ELC_GAME) ? GetEventLogTime() : 0;
+#endif /* NO_EVENT_LOG */
+
 		CheckCaches(false);
 
 		/* All these actions has to be done from OWNER_NONE
@@ -1472,6 +1620,8 @@ void StateGameLoop()
 		CallWindowTickEvent();
 		NewsLoop();
 		cur_company.Restore();
+
+		EVENT_LOG(ELE_GAME_TICK, _tick_counter, tick_start == 0 ? 0 : (uint32)(GetEventLogTime() - tick_start), 0, 0);
 	}
 
 	assert(IsLocalCompany());
@@ -1534,7 +1684,6 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
 	InteractiveRandom();
 
 	extern int _caret_timer;
@@ -36,6 +36,7 @@
 #include "cheat_type.h"
 #include "viewport_func.h"
 #include "tracerestrict.h"
+#include "vehiclelist.h"
 
 #include "table/strings.h"
 
@@ -376,6 +377,8 @@ void OrderList::Initialize(Order *chain, Vehicle *v)
 	}
 
 	for (const Vehicle *u = v->NextShared(); u != nullptr; u = u->NextShared()) ++this->num_vehicles;
+
+	MarkVehicleListIndexDirty(this);
 }
 
 /**
@@ -385,6 +388,8 @@ void OrderList::Initialize(Order *chain, Vehicle *v)
  */
 void OrderList::FreeChain(bool keep_orderlist)
 {
+	MarkVehicleListIndexDirty(this);
+
 	Order *next;
 	for (Order *o = this->first; o != nullptr; o = next) {
 		next = o->next;
@@ -571,6 +576,8 @@ CargoMaskedStationIDStack OrderList::GetNextStoppingStation(const Vehicle *v, ui
  */
 void OrderList::InsertOrderAt(Order *new_order, int index)
 {
+	MarkVehicleListIndexDirty(this);
+
 	if (this->first == nullptr) {
 		this->first = new_order;
 	} else {
@@ -613,6 +620,8 @@ void OrderList::DeleteOrderAt(int index)
 {
 	if (index >= this->num_orders) return;
 
+	MarkVehicleListIndexDirty(this);
+
 	Order *to_remove;
 
 	if (index == 0) {
@@ -2328,6 +2337,8 @@ restart:
 				order->SetTravelTimetabled(travel_timetabled);
 
 				for (const Vehicle *w = v->FirstShared(); w != nullptr; w = w->NextShared()) {
+					MarkVehicleListIndexDirty(w);
+
 					/* In GUI, simulate by removing the order and adding it back */
 					InvalidateVehicleOrder(w, id | (INVALID_VEH_ORDER_ID << 8));
 					InvalidateVehicleOrder(w, (INVALID_VEH_ORDER_ID << 8) | id);
@@ -13,6 +13,7 @@
 #define YAPF_BASE_HPP
 
 #include "../../debug.h"
+#include "../../event_log.h"
 #include "../../settings_type.h"
 
 extern int _total_pf_time_us;
@@ -122,10 +123,10 @@ public:
 	{
 		m_veh = v;
 
-#ifndef NO_DEBUG_MESSAGES
+#if !defined(NO_DEBUG_MESSAGES) || !defined(NO_EVENT_LOG)
 		CPerformanceTimer perf;
 		perf.Start();
-#endif /* !NO_DEBUG_MESSAGES */
+#endif /* !NO_DEBUG_MESSAGES || !NO_EVENT_LOG */
 
 		Yapf().PfSetStartupNodes();
 		bool bDestFound = true;
@@ -154,8 +155,13 @@ public:
 
 		bDestFound &= (m_pBestDestNode != nullptr);
 
-#ifndef NO_DEBUG_MESSAGES
+#if !defined(NO_DEBUG_MESSAGES) || !defined(NO_EVENT_LOG)
 		perf.Stop();
+#endif /* !NO_DEBUG_MESSAGES || !NO_EVENT_LOG */
+		EVENT_LOG(bDestFound ? ELE_PF_YAPF_FOUND : ELE_PF_YAPF_NOT_FOUND, m_veh != nullptr ? m_veh->index : INVALID_VEHICLE,
+				m_num_steps, m_nodes.ClosedCount(), perf.Get(1000000));
+
+#ifndef NO_DEBUG_MESSAGES
 		if (_debug_yapf_level >= 2) {
 			int t = perf.Get(1000000);
 			_total_pf_time_us += t;
@@ -64,6 +64,7 @@
 
 #include <signal.h>
 #include <algorithm>
+#include <chrono>
 
 #include "../safeguards.h"
 
@@ -218,16 +219,56 @@ static inline RailType UpdateRailType(RailType rt, RailType min)
 	return rt >= min ? (RailType)(rt + 1): rt;
 }
 
+static bool _virt_coords_deferred = false; ///< Whether the viewport coordinates of the signs were not computed after loading yet.
+
 /**
  * Update the viewport coordinates of all signs.
  */
 void UpdateAllVirtCoords()
 {
+	_virt_coords_deferred = false;
 	UpdateAllStationVirtCoords();
 	UpdateAllSignVirtCoords();
 	UpdateAllTownVirtCoords();
 }
 
+/**
+ * Update the viewport coordinates of all signs, when that was put off after loading.
+ * Only drawing and clicking the signs needs them, so a dedicated server never does.
+ */
+void UpdateDeferredVirtCoords()
+{
+	if (_virt_coords_deferred) UpdateAllVirtCoords();
+}
+
+/** Measures how long the passes of #AfterLoadGame take, for the debug output of the 'sl' category. */
+class AfterLoadPassTimer {
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point start; ///< Start of the first pass.
+	Clock::time_point last;  ///< End of the previous pass.
+
+public:
+	AfterLoadPassTimer() : start(Clock::now()), last(start) {}
+
+	/**
+	 * Mark the end of a pass and report its duration.
+	 * @param name Name of the pass.
+	 */
+	void Pass(const char *name)
+	{
+		Clock::time_point now = Clock::now();
+		DEBUG(sl, 2, "AfterLoadGame: %-24s %8u us", name, (uint)std::chrono::duration_cast<std::chrono::microseconds>(now - this->last).count());
+		this->last = now;
+	}
+
+	/** Report the duration of all passes together. */
+	void Finish()
+	{
+		DEBUG(sl, 1, "AfterLoadGame took %u ms", (uint)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - this->start).count());
+	}
+};
+
 /**
  * Initialization of the windows and several kinds of caches.
  * This is not done directly in AfterLoadGame because these
@@ -236,16 +277,18 @@ void UpdateAllVirtCoords()
  * the intialization of the windows and caches quite some bugs
  * had been made.
  * Moving this out of there is both cleaner and less bug-prone.
+ * @param timer Timer of the passes of loading.
  */
-static void InitializeWindowsAndCaches()
+static void InitializeWindowsAndCaches(AfterLoadPassTimer &timer)
 {
 	/* Initialize windows */
 	ResetWindowSystem();
 	SetupColoursAndInitialWindow();
 
-	/* Update coordinates of the signs. */
-	UpdateAllVirtCoords();
+	/* Update coordinates of the signs when they are first drawn or clicked. */
+	_virt_coords_deferred = true;
 	ResetViewportAfterLoadGame();
+	timer.Pass("windows");
 
 	Company *c;
 	FOR_ALL_COMPANIES(c) {
@@ -293,11 +336,14 @@ static void InitializeWindowsAndCaches()
 	}
 
 	RecomputePrices();
+	timer.Pass("misc caches");
 
 	GroupStatistics::UpdateAfterLoad();
+	timer.Pass("group statistics");
 
 	Station::RecomputeIndustriesNearForAll();
 	RebuildSubsidisedSourceAndDestinationCache();
+	timer.Pass("industries near stations");
 
 	/* Towns have a noise controlled number of airports system
 	 * So each airport's noise value must be added to the town->noise_reached value
@@ -310,6 +356,7 @@ static void InitializeWindowsAndCaches()
 
 	/* Rebuild the smallmap list of owners. */
 	BuildOwnerLegend();
+	timer.Pass("airports and trains");
 }
 
 typedef void (CDECL *SignalHandlerPointer)(int);
@@ -564,6 +611,7 @@ TileIndex GetOtherTunnelBridgeEndOld(TileIndex tile)
 bool AfterLoadGame()
 {
 	SetSignalHandlers();
+	AfterLoadPassTimer timer;
 
 	TileIndex map_size = MapSize();
 
@@ -626,14 +674,14 @@ bool AfterLoadGame()
 
 		/* In old savegame versions, the heightlevel was coded in bits 0..3 of the type field */
 		for (TileIndex t = 0; t < map_size; t++) {
-			_m[t].height = GB(_m[t].type, 0, 4);
-			SB(_m[t].type, 0, 2, GB(_me[t].m6, 0, 2));
+			TileHeightByte(t) = GB(TileTypeByte(t), 0, 4);
+			SB(TileTypeByte(t), 0, 2, GB(_me[t].m6, 0, 2));
 			SB(_me[t].m6, 0, 2, 0);
 			if (MayHaveBridgeAbove(t)) {
-				SB(_m[t].type, 2, 2, GB(_me[t].m6, 6, 2));
+				SB(TileTypeByte(t), 2, 2, GB(_me[t].m6, 6, 2));
 				SB(_me[t].m6, 6, 2, 0);
 			} else {
-				SB(_m[t].type, 2, 2, 0);
+				SB(TileTypeByte(t), 2, 2, 0);
 			}
 		}
 	}
@@ -943,6 +991,7 @@ bool AfterLoadGame()
 			}
 		}
 	}
+	timer.Pass("conversions");
 
 	for (TileIndex t = 0; t < map_size; t++) {
 		switch (GetTileType(t)) {
@@ -1009,6 +1058,7 @@ bool AfterLoadGame()
 			default: break;
 		}
 	}
+	timer.Pass("station spread");
 
 	/* In version 2.2 of the savegame, we have new airports, so status of all aircraft is reset.
 	 * This has to be called after the oilrig airport_type update above ^^^ ! */
@@ -1551,8 +1601,11 @@ bool AfterLoadGame()
 		}
 	}
 
+	timer.Pass("conversions");
+
 	/* Check and update house and town values */
 	UpdateHousesAndTowns();
+	timer.Pass("houses and towns");
 
 	if (IsSavegameVersionBefore(43)) {
 		for (TileIndex t = 0; t < map_size; t++) {
@@ -3220,24 +3273,32 @@ bool AfterLoadGame()
 		}
 	}
 
+	timer.Pass("conversions");
+
 	/* Road stops is 'only' updating some caches */
 	AfterLoadRoadStops();
+	timer.Pass("road stops");
 	AfterLoadLabelMaps();
+	timer.Pass("label maps");
 	AfterLoadCompanyStats();
+	timer.Pass("company infrastructure");
 	AfterLoadStoryBook();
 
 	GamelogPrintDebug(1);
 
-	InitializeWindowsAndCaches();
+	InitializeWindowsAndCaches(timer);
 	/* Restore the signals */
 	ResetSignalHandlers();
 
 	AfterLoadLinkGraphs();
+	timer.Pass("link graphs");
 
 	AfterLoadTraceRestrict();
 
 	AfterLoadTemplateVehiclesUpdateImage();
+	timer.Pass("routing restrictions");
 
+	timer.Finish();
 	return true;
 }
 
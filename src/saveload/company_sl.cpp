@@ -17,6 +17,7 @@
 #include "../tunnelbridge.h"
 #include "../station_base.h"
 #include "../strings_func.h"
+#include "../thread/thread.h"
 
 #include "saveload.h"
 
@@ -92,25 +93,31 @@ CompanyManagerFace ConvertFromOldCompanyManagerFace(uint32 face)
 	return cmf;
 }
 
-/** Rebuilding of company statistics after loading a savegame. */
-void AfterLoadCompanyStats()
+/**
+ * Get where to count the infrastructure of an owner.
+ * @param infra Counts of all companies.
+ * @param owner The owner.
+ * @return The counts of the owner, or \c nullptr when the owner is no company.
+ */
+static inline CompanyInfrastructure *GetInfrastructureCounts(CompanyInfrastructure *infra, Owner owner)
 {
-	/* Reset infrastructure statistics to zero. */
-	Company *company;
-	FOR_ALL_COMPANIES(company) MemSetT(&company->infrastructure, 0);
+	return Company::IsValidID(owner) ? &infra[owner] : nullptr;
+}
 
-	/* Collect airport count. */
-	Station *st;
-	FOR_ALL_STATIONS(st) {
-		if ((st->facilities & FACIL_AIRPORT) && Company::IsValidID(st->owner)) {
-			Company::Get(st->owner)->infrastructure.airport++;
-		}
-	}
+/**
+ * Count the infrastructure of the companies on a range of tiles.
+ * @param begin First tile of the range.
+ * @param end End of the range.
+ * @param infra Counts of all companies, indexed by #CompanyID, to add the infrastructure to.
+ */
+static void CountCompanyInfrastructure(TileIndex begin, TileIndex end, CompanyInfrastructure *infra)
+{
+	CompanyInfrastructure *company;
 
-	for (TileIndex tile = 0; tile < MapSize(); tile++) {
+	for (TileIndex tile = begin; tile < end; tile++) {
 		switch (GetTileType(tile)) {
 			case MP_RAILWAY:
-				company = Company::GetIfValid(GetTileOwner(tile));
+				company = GetInfrastructureCounts(infra, GetTileOwner(tile));
 				if (company != nullptr) {
 					uint pieces = 1;
 					if (IsPlainRail(tile)) {
@@ -118,37 +125,37 @@ void AfterLoadCompanyStats()
 						pieces = CountBits(bits);
 						if (TracksOverlap(bits)) pieces *= pieces;
 					}
-					company->infrastructure.rail[GetRailType(tile)] += pieces;
+					company->rail[GetRailType(tile)] += pieces;
 
-					if (HasSignals(tile)) company->infrastructure.signal += CountBits(GetPresentSignals(tile));
+					if (HasSignals(tile)) company->signal += CountBits(GetPresentSignals(tile));
 				}
 				break;
 
 			case MP_ROAD: {
 				if (IsLevelCrossing(tile)) {
-					company = Company::GetIfValid(GetTileOwner(tile));
-					if (company != nullptr) company->infrastructure.rail[GetRailType(tile)] += LEVELCROSSING_TRACKBIT_FACTOR;
+					company = GetInfrastructureCounts(infra, GetTileOwner(tile));
+					if (company != nullptr) company->rail[GetRailType(tile)] += LEVELCROSSING_TRACKBIT_FACTOR;
 				}
 
 				/* Iterate all present road types as each can have a different owner. */
 				RoadTypeIdentifiers rtids = RoadTypeIdentifiers::FromTile(tile);
 				RoadTypeIdentifier rtid;
 				FOR_EACH_SET_ROADTYPEIDENTIFIER(rtid, rtids) {
-					company = Company::GetIfValid(IsRoadDepot(tile) ? GetTileOwner(tile) : GetRoadOwner(tile, rtid.basetype));
+					company = GetInfrastructureCounts(infra, IsRoadDepot(tile) ? GetTileOwner(tile) : GetRoadOwner(tile, rtid.basetype));
 					/* A level crossings and depots have two road bits. */
-					if (company != nullptr) company->infrastructure.road[rtid.basetype][rtid.subtype] += IsNormalRoad(tile) ? CountBits(GetRoadBits(tile, rtid.basetype)) : 2;
+					if (company != nullptr) company->road[rtid.basetype][rtid.subtype] += IsNormalRoad(tile) ? CountBits(GetRoadBits(tile, rtid.basetype)) : 2;
 				}
 				break;
 			}
 
 			case MP_STATION:
-				company = Company::GetIfValid(GetTileOwner(tile));
-				if (company != nullptr && GetStationType(tile) != STATION_AIRPORT && !IsBuoy(tile)) company->infrastructure.station++;
+				company = GetInfrastructureCounts(infra, GetTileOwner(tile));
+				if (company != nullptr && GetStationType(tile) != STATION_AIRPORT && !IsBuoy(tile)) company->station++;
 
 				switch (GetStationType(tile)) {
 					case STATION_RAIL:
 					case STATION_WAYPOINT:
-						if (company != nullptr && !IsStationTileBlocked(tile)) company->infrastructure.rail[GetRailType(tile)]++;
+						if (company != nullptr && !IsStationTileBlocked(tile)) company->rail[GetRailType(tile)]++;
 						break;
 
 					case STATION_BUS:
@@ -157,8 +164,8 @@ void AfterLoadCompanyStats()
 						RoadTypeIdentifiers rtids = RoadTypeIdentifiers::FromTile(tile);
 						RoadTypeIdentifier rtid;
 						FOR_EACH_SET_ROADTYPEIDENTIFIER(rtid, rtids) {
-							company = Company::GetIfValid(GetRoadOwner(tile, rtid.basetype));
-							if (company != nullptr) company->infrastructure.road[rtid.basetype][rtid.subtype] += 2; // A road stop has two road bits.
+							company = GetInfrastructureCounts(infra, GetRoadOwner(tile, rtid.basetype));
+							if (company != nullptr) company->road[rtid.basetype][rtid.subtype] += 2; // A road stop has two road bits.
 						}
 						break;
 					}
@@ -166,7 +173,7 @@ void AfterLoadCompanyStats()
 					case STATION_DOCK:
 					case STATION_BUOY:
 						if (GetWaterClass(tile) == WATER_CLASS_CANAL) {
-							if (company != nullptr) company->infrastructure.water++;
+							if (company != nullptr) company->water++;
 						}
 						break;
 
@@ -177,12 +184,12 @@ void AfterLoadCompanyStats()
 
 			case MP_WATER:
 				if (IsShipDepot(tile) || IsLock(tile)) {
-					company = Company::GetIfValid(GetTileOwner(tile));
+					company = GetInfrastructureCounts(infra, GetTileOwner(tile));
 					if (company != nullptr) {
-						if (IsShipDepot(tile)) company->infrastructure.water += LOCK_DEPOT_TILE_FACTOR;
+						if (IsShipDepot(tile)) company->water += LOCK_DEPOT_TILE_FACTOR;
 						if (IsLock(tile) && GetLockPart(tile) == LOCK_PART_MIDDLE) {
 							/* The middle tile specifies the owner of the lock. */
-							company->infrastructure.water += 3 * LOCK_DEPOT_TILE_FACTOR; // the middle tile specifies the owner of the
+							company->water += 3 * LOCK_DEPOT_TILE_FACTOR; // the middle tile specifies the owner of the
 							break; // do not count the middle tile as canal
 						}
 					}
@@ -191,8 +198,8 @@ void AfterLoadCompanyStats()
 
 			case MP_OBJECT:
 				if (GetWaterClass(tile) == WATER_CLASS_CANAL) {
-					company = Company::GetIfValid(GetTileOwner(tile));
-					if (company != nullptr) company->infrastructure.water++;
+					company = GetInfrastructureCounts(infra, GetTileOwner(tile));
+					if (company != nullptr) company->water++;
 				}
 				break;
 
@@ -207,11 +214,11 @@ void AfterLoadCompanyStats()
 
 					switch (GetTunnelBridgeTransportType(tile)) {
 						case TRANSPORT_RAIL:
-							company = Company::GetIfValid(GetTileOwner(tile));
+							company = GetInfrastructureCounts(infra, GetTileOwner(tile));
 							if (company != nullptr) {
-								company->infrastructure.rail[GetRailType(tile)] += len;
+								company->rail[GetRailType(tile)] += len;
 								if (IsTunnelBridgeWithSignalSimulation(tile)) {
-									company->infrastructure.signal += GetTunnelBridgeSignalSimulationSignalCount(tile, other_end);
+									company->signal += GetTunnelBridgeSignalSimulationSignalCount(tile, other_end);
 								}
 							}
 							break;
@@ -221,19 +228,19 @@ void AfterLoadCompanyStats()
 							RoadTypeIdentifiers road_type_ids = RoadTypeIdentifiers::FromTile(tile);
 							RoadTypeIdentifier road_type_id;
 							FOR_EACH_SET_ROADTYPEIDENTIFIER(road_type_id, road_type_ids) {
-								company = Company::GetIfValid(GetRoadOwner(tile, road_type_id.basetype));
+								company = GetInfrastructureCounts(infra, GetRoadOwner(tile, road_type_id.basetype));
 
 								if (company != nullptr) {
 									// A full diagonal road has two road bits.
-									company->infrastructure.road[road_type_id.basetype][road_type_id.subtype] += len * 2;
+									company->road[road_type_id.basetype][road_type_id.subtype] += len * 2;
 								}
 							}
 							break;
 						}
 
 						case TRANSPORT_WATER:
-							company = Company::GetIfValid(GetTileOwner(tile));
-							if (company != nullptr) company->infrastructure.water += len;
+							company = GetInfrastructureCounts(infra, GetTileOwner(tile));
+							if (company != nullptr) company->water += len;
 							break;
 
 						default:
@@ -249,6 +256,70 @@ void AfterLoadCompanyStats()
 	}
 }
 
+/** Infrastructure counting of a range of tiles on a thread of its own. */
+struct InfrastructureCountJob {
+	TileIndex begin;                           ///< First tile of the range.
+	TileIndex end;                             ///< End of the range.
+	CompanyInfrastructure infra[MAX_COMPANIES]; ///< Counts of the companies in this range.
+};
+
+/**
+ * Entry point of the threads counting infrastructure.
+ * @param arg The #InfrastructureCountJob to do.
+ */
+static void CountCompanyInfrastructureThread(void *arg)
+{
+	InfrastructureCountJob *job = (InfrastructureCountJob *)arg;
+	CountCompanyInfrastructure(job->begin, job->end, job->infra);
+}
+
+/** Maps with fewer tiles are counted on the calling thread only. */
+static const uint INFRASTRUCTURE_COUNT_THREAD_MIN_TILES = 512 * 512;
+
+/**
+ * Rebuilding of company statistics after loading a savegame.
+ * On large maps the tiles are divided over a thread per processor core.
+ */
+void AfterLoadCompanyStats()
+{
+	/* Reset infrastructure statistics to zero. */
+	Company *company;
+	FOR_ALL_COMPANIES(company) MemSetT(&company->infrastructure, 0);
+
+	/* Collect airport count. */
+	Station *st;
+	FOR_ALL_STATIONS(st) {
+		if ((st->facilities & FACIL_AIRPORT) && Company::IsValidID(st->owner)) {
+			Company::Get(st->owner)->infrastructure.airport++;
+		}
+	}
+
+	uint num_jobs = MapSize() < INFRASTRUCTURE_COUNT_THREAD_MIN_TILES ? 1 : Clamp(GetCPUCoreCount(), 1U, 16U);
+	InfrastructureCountJob *jobs = CallocT<InfrastructureCountJob>(num_jobs);
+	ThreadObject **threads = CallocT<ThreadObject *>(num_jobs);
+	for (uint i = 0; i < num_jobs; i++) {
+		jobs[i].begin = (TileIndex)((uint64)MapSize() * i / num_jobs);
+		jobs[i].end = (TileIndex)((uint64)MapSize() * (i + 1) / num_jobs);
+		/* The first range is counted by this thread. */
+		if (i != 0 && !ThreadObject::New(&CountCompanyInfrastructureThread, &jobs[i], &threads[i], "ottd:infra")) threads[i] = nullptr;
+	}
+
+	for (uint i = 0; i < num_jobs; i++) {
+		if (threads[i] == nullptr) CountCompanyInfrastructure(jobs[i].begin, jobs[i].end, jobs[i].infra);
+	}
+
+	for (uint i = 0; i < num_jobs; i++) {
+		if (threads[i] != nullptr) {
+			threads[i]->Join();
+			delete threads[i];
+		}
+		FOR_ALL_COMPANIES(company) company->infrastructure += jobs[i].infra[company->index];
+	}
+
+	free(threads);
+	free(jobs);
+}
+
 
 
 /* Save/load of companies */
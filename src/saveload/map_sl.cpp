@@ -13,8 +13,10 @@
 #include "../map_func.h"
 #include "../core/bitmath_func.hpp"
 #include "../fios.h"
+#include "../cpu.h"
 
 #include "saveload.h"
+#include "map_sl.h"
 
 #include "../safeguards.h"
 
@@ -47,229 +49,325 @@ static void Check_MAPS()
 	_load_check_data.map_size_y = _map_dim_y;
 }
 
-static const uint MAP_SL_BUF_SIZE = 4096;
+/**
+ * Gather a byte field of tiles.
+ * @tparam Tfield The field.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <byte Tile::*Tfield>
+static void GatherTileByte(byte *buf, size_t first, size_t count)
+{
+	const Tile *t = _m + first;
+	for (size_t i = 0; i != count; i++) buf[i] = t[i].*Tfield;
+}
 
-static void Load_MAPT()
+/**
+ * Scatter a byte field of tiles.
+ * @tparam Tfield The field.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <byte Tile::*Tfield>
+static void ScatterTileByte(const byte *buf, size_t first, size_t count)
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	Tile *t = _m + first;
+	for (size_t i = 0; i != count; i++) t[i].*Tfield = buf[i];
+}
 
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].type = buf[j];
+/**
+ * Gather Tile::m2 as big endian words.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+static void GatherTileM2(byte *buf, size_t first, size_t count)
+{
+	const Tile *t = _m + first;
+	for (size_t i = 0; i != count; i++) {
+		buf[i * 2] = GB(t[i].m2, 8, 8);
+		buf[i * 2 + 1] = GB(t[i].m2, 0, 8);
 	}
 }
 
-static void Save_MAPT()
+/**
+ * Scatter Tile::m2 from big endian words.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+static void ScatterTileM2(const byte *buf, size_t first, size_t count)
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	Tile *t = _m + first;
+	for (size_t i = 0; i != count; i++) t[i].m2 = buf[i * 2] << 8 | buf[i * 2 + 1];
+}
 
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].type;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+/**
+ * Gather a field of TileExtended.
+ * @tparam Tfield The field.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <byte TileExtended::*Tfield>
+static void GatherTileExtended(byte *buf, size_t first, size_t count)
+{
+	const TileExtended *t = _me + first;
+	for (size_t i = 0; i != count; i++) buf[i] = t[i].*Tfield;
 }
 
-static void Load_MAPH()
+/**
+ * Scatter a field of TileExtended.
+ * @tparam Tfield The field.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <byte TileExtended::*Tfield>
+static void ScatterTileExtended(const byte *buf, size_t first, size_t count)
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	TileExtended *t = _me + first;
+	for (size_t i = 0; i != count; i++) t[i].*Tfield = buf[i];
+}
 
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].height = buf[j];
-	}
+#ifdef SPLIT_MAP_ARRAYS
+/**
+ * Gather a field of TileTypeHeight.
+ * @tparam Tfield The field.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <byte TileTypeHeight::*Tfield>
+static void GatherTileTypeHeight(byte *buf, size_t first, size_t count)
+{
+	const TileTypeHeight *t = _mth + first;
+	for (size_t i = 0; i != count; i++) buf[i] = t[i].*Tfield;
 }
 
-static void Save_MAPH()
+/**
+ * Scatter a field of TileTypeHeight.
+ * @tparam Tfield The field.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <byte TileTypeHeight::*Tfield>
+static void ScatterTileTypeHeight(const byte *buf, size_t first, size_t count)
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	TileTypeHeight *t = _mth + first;
+	for (size_t i = 0; i != count; i++) t[i].*Tfield = buf[i];
+}
 
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].height;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
+#	define MSF_TILE_TYPE_HEIGHT(field) { &GatherTileTypeHeight<&TileTypeHeight::field>, &ScatterTileTypeHeight<&TileTypeHeight::field>, 1 }
+#else
+#	define MSF_TILE_TYPE_HEIGHT(field) { &GatherTileByte<&Tile::field>, &ScatterTileByte<&Tile::field>, 1 }
+#endif /* SPLIT_MAP_ARRAYS */
+
+/** Field copying functions in plain C++, indexed by #MapSlField. */
+static const MapFieldProcs _map_field_procs_scalar[MSF_END] = {
+	MSF_TILE_TYPE_HEIGHT(type),
+	MSF_TILE_TYPE_HEIGHT(height),
+	{ &GatherTileByte<&Tile::m1>, &ScatterTileByte<&Tile::m1>, 1 },
+	{ &GatherTileM2, &ScatterTileM2, 2 },
+	{ &GatherTileByte<&Tile::m3>, &ScatterTileByte<&Tile::m3>, 1 },
+	{ &GatherTileByte<&Tile::m4>, &ScatterTileByte<&Tile::m4>, 1 },
+	{ &GatherTileByte<&Tile::m5>, &ScatterTileByte<&Tile::m5>, 1 },
+	{ &GatherTileExtended<&TileExtended::m6>, &ScatterTileExtended<&TileExtended::m6>, 1 },
+	{ &GatherTileExtended<&TileExtended::m7>, &ScatterTileExtended<&TileExtended::m7>, 1 },
+};
+
+#undef MSF_TILE_TYPE_HEIGHT
+
+static const MapFieldProcs *_map_field_procs = nullptr; ///< The field copying functions in use, nullptr until they are first needed.
+
+/**
+ * Choose the functions to copy the tile fields with.
+ * @param impl The implementation to use.
+ * @return False if the processor or the build does not support the implementation.
+ */
+bool SetMapSlImplementation(MapSlImplementation impl)
+{
+	switch (impl) {
+		case MSI_AUTO:
+#ifdef WITH_MAP_SL_SSE2
+			if (HasCPUIDFlag(1, 3, 26)) {
+				_map_field_procs = _map_field_procs_sse2;
+				return true;
+			}
+#endif
+			FALLTHROUGH;
+
+		case MSI_SCALAR:
+			_map_field_procs = _map_field_procs_scalar;
+			return true;
+
+		case MSI_SSE2:
+#ifdef WITH_MAP_SL_SSE2
+			if (HasCPUIDFlag(1, 3, 26)) {
+				_map_field_procs = _map_field_procs_sse2;
+				return true;
+			}
+#endif
+			return false;
+
+		default: NOT_REACHED();
 	}
 }
 
-static void Load_MAP1()
+/**
+ * Get the functions to copy a tile field with.
+ * @param field The field.
+ * @return The functions.
+ */
+static const MapFieldProcs &GetMapFieldProcs(MapSlField field)
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	if (_map_field_procs == nullptr) SetMapSlImplementation(MSI_AUTO);
+	return _map_field_procs[field];
+}
 
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m1 = buf[j];
-	}
+/**
+ * Save a field of all tiles as a chunk.
+ * @param field The field.
+ */
+static void SaveMapField(MapSlField field)
+{
+	const MapFieldProcs &procs = GetMapFieldProcs(field);
+	SlSetLength(MapSize() * procs.size);
+	SlGatherArray(MapSize(), procs.size, procs.gather);
 }
 
-static void Save_MAP1()
+/**
+ * Load a field of all tiles from a chunk.
+ * @param field The field.
+ */
+static void LoadMapField(MapSlField field)
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
+	const MapFieldProcs &procs = GetMapFieldProcs(field);
+	SlScatterArray(MapSize(), procs.size, procs.scatter);
+}
 
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m1;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+static void Load_MAPT()
+{
+	LoadMapField(MSF_TYPE);
+}
+
+static void Save_MAPT()
+{
+	SaveMapField(MSF_TYPE);
+}
+
+static void Load_MAPH()
+{
+	LoadMapField(MSF_HEIGHT);
+}
+
+static void Save_MAPH()
+{
+	SaveMapField(MSF_HEIGHT);
+}
+
+static void Load_MAP1()
+{
+	LoadMapField(MSF_M1);
+}
+
+static void Save_MAP1()
+{
+	SaveMapField(MSF_M1);
 }
 
+static const uint MAP_SL_BUF_SIZE = 4096;
+
 static void Load_MAP2()
 {
+	if (!IsSavegameVersionBefore(5)) {
+		LoadMapField(MSF_M2);
+		return;
+	}
+
+	/* In those versions the m2 was 8 bits */
 	SmallStackSafeStackAlloc<uint16, MAP_SL_BUF_SIZE> buf;
 	TileIndex size = MapSize();
 
 	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE,
-			/* In those versions the m2 was 8 bits */
-			IsSavegameVersionBefore(5) ? SLE_FILE_U8 | SLE_VAR_U16 : SLE_UINT16
-		);
+		SlArray(buf, MAP_SL_BUF_SIZE, SLE_FILE_U8 | SLE_VAR_U16);
 		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m2 = buf[j];
 	}
 }
 
 static void Save_MAP2()
 {
-	SmallStackSafeStackAlloc<uint16, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size * sizeof(uint16));
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m2;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT16);
-	}
+	SaveMapField(MSF_M2);
 }
 
 static void Load_MAP3()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m3 = buf[j];
-	}
+	LoadMapField(MSF_M3);
 }
 
 static void Save_MAP3()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m3;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapField(MSF_M3);
 }
 
 static void Load_MAP4()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m4 = buf[j];
-	}
+	LoadMapField(MSF_M4);
 }
 
 static void Save_MAP4()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m4;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapField(MSF_M4);
 }
 
 static void Load_MAP5()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _m[i++].m5 = buf[j];
-	}
+	LoadMapField(MSF_M5);
 }
 
 static void Save_MAP5()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _m[i++].m5;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapField(MSF_M5);
 }
 
 static void Load_MAP6()
 {
+	if (!IsSavegameVersionBefore(42)) {
+		LoadMapField(MSF_M6);
+		return;
+	}
+
 	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
 	TileIndex size = MapSize();
 
-	if (IsSavegameVersionBefore(42)) {
-		for (TileIndex i = 0; i != size;) {
-			/* 1024, otherwise we overflow on 64x64 maps! */
-			SlArray(buf, 1024, SLE_UINT8);
-			for (uint j = 0; j != 1024; j++) {
-				_me[i++].m6 = GB(buf[j], 0, 2);
-				_me[i++].m6 = GB(buf[j], 2, 2);
-				_me[i++].m6 = GB(buf[j], 4, 2);
-				_me[i++].m6 = GB(buf[j], 6, 2);
-			}
-		}
-	} else {
-		for (TileIndex i = 0; i != size;) {
-			SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-			for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _me[i++].m6 = buf[j];
+	for (TileIndex i = 0; i != size;) {
+		/* 1024, otherwise we overflow on 64x64 maps! */
+		SlArray(buf, 1024, SLE_UINT8);
+		for (uint j = 0; j != 1024; j++) {
+			_me[i++].m6 = GB(buf[j], 0, 2);
+			_me[i++].m6 = GB(buf[j], 2, 2);
+			_me[i++].m6 = GB(buf[j], 4, 2);
+			_me[i++].m6 = GB(buf[j], 6, 2);
 		}
 	}
 }
 
 static void Save_MAP6()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _me[i++].m6;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapField(MSF_M6);
 }
 
 static void Load_MAP7()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	for (TileIndex i = 0; i != size;) {
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) _me[i++].m7 = buf[j];
-	}
+	LoadMapField(MSF_M7);
 }
 
 static void Save_MAP7()
 {
-	SmallStackSafeStackAlloc<byte, MAP_SL_BUF_SIZE> buf;
-	TileIndex size = MapSize();
-
-	SlSetLength(size);
-	for (TileIndex i = 0; i != size;) {
-		for (uint j = 0; j != MAP_SL_BUF_SIZE; j++) buf[j] = _me[i++].m7;
-		SlArray(buf, MAP_SL_BUF_SIZE, SLE_UINT8);
-	}
+	SaveMapField(MSF_M7);
 }
 
 extern const ChunkHandler _map_chunk_handlers[] = {
@@ -284,3 +382,15 @@ extern const ChunkHandler _map_chunk_handlers[] = {
 	{ 'MAPE', Save_MAP6, Load_MAP6, nullptr, nullptr,       CH_RIFF },
 	{ 'MAP7', Save_MAP7, Load_MAP7, nullptr, nullptr,       CH_RIFF | CH_LAST },
 };
+
+/**
+ * Save the tile fields to memory and load them back, to measure the speed
+ * of the map chunks with the current implementation.
+ * @param[out] result The measurements.
+ * @return False if saving or loading is in progress.
+ */
+bool BenchmarkMapChunks(SlChunkBenchmark *result)
+{
+	/* Skip MAPS, loading that allocates a new map. */
+	return SlBenchmarkChunks(_map_chunk_handlers + 1, result);
+}
@@ -0,0 +1,54 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file map_sl.h Copying the fields of all tiles from and to the savegame in bulk. */
+
+#ifndef SAVELOAD_MAP_SL_H
+#define SAVELOAD_MAP_SL_H
+
+#include "saveload.h"
+
+/** The fields of a tile that are stored in a chunk of their own. */
+enum MapSlField {
+	MSF_TYPE,   ///< Tile::type, or TileTypeHeight::type with SPLIT_MAP_ARRAYS
+	MSF_HEIGHT, ///< Tile::height, or TileTypeHeight::height with SPLIT_MAP_ARRAYS
+	MSF_M1,     ///< Tile::m1
+	MSF_M2,     ///< Tile::m2
+	MSF_M3,     ///< Tile::m3
+	MSF_M4,     ///< Tile::m4
+	MSF_M5,     ///< Tile::m5
+	MSF_M6,     ///< TileExtended::m6
+	MSF_M7,     ///< TileExtended::m7
+	MSF_END,    ///< End marker
+};
+
+/** Functions to copy one field of consecutive tiles from and to the savegame format. */
+struct MapFieldProcs {
+	SlGatherProc *gather;   ///< Gathers the field of tiles into a buffer.
+	SlScatterProc *scatter; ///< Scatters the field from a buffer into the tiles.
+	byte size;              ///< Size of the field in the savegame.
+};
+
+/** Implementations of the field copying functions. */
+enum MapSlImplementation {
+	MSI_AUTO,   ///< The fastest the processor supports.
+	MSI_SCALAR, ///< Plain C++.
+	MSI_SSE2,   ///< SSE2 instructions.
+};
+
+#if defined(WITH_SSE) && !defined(SPLIT_MAP_ARRAYS)
+/* The SSE2 functions rely on the eight byte tiles of the default map layout. */
+#	define WITH_MAP_SL_SSE2
+extern const MapFieldProcs _map_field_procs_sse2[MSF_END];
+#endif
+
+bool SetMapSlImplementation(MapSlImplementation impl);
+bool BenchmarkMapChunks(SlChunkBenchmark *result);
+
+#endif /* SAVELOAD_MAP_SL_H */
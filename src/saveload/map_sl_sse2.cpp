@@ -0,0 +1,218 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file map_sl_sse2.cpp Copying the fields of all tiles from and to the savegame using SSE2. */
+
+#if defined(WITH_SSE) && !defined(SPLIT_MAP_ARRAYS)
+
+#include "../stdafx.h"
+#include "../map_func.h"
+#include "../core/bitmath_func.hpp"
+#include "map_sl.h"
+#include <emmintrin.h>
+
+#include "../safeguards.h"
+
+/*
+ * SSE2 only exists on little endian processors, so the field at byte offset
+ * N of a tile is found at bit N * 8 of the 64 bit lane holding that tile.
+ */
+assert_compile(sizeof(Tile) == 8);
+assert_compile(sizeof(TileExtended) == 2);
+
+/**
+ * Gather a byte field of tiles, 16 tiles per step.
+ * @tparam Toffset Offset of the field within Tile.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <uint Toffset>
+static void GatherTileByteSSE2(byte *buf, size_t first, size_t count)
+{
+	const __m128i mask = _mm_set_epi32(0, 0xFF, 0, 0xFF);
+	const __m128i *src = (const __m128i *)(_m + first);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16, src += 8) {
+		__m128i v[8];
+		for (uint j = 0; j < 8; j++) v[j] = _mm_and_si128(_mm_srli_epi64(_mm_loadu_si128(src + j), Toffset * 8), mask);
+
+		/* Every 64 bit lane holds a value; packing twice brings them to 16 bit lanes, then to bytes. */
+		__m128i lo = _mm_packs_epi32(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+		__m128i hi = _mm_packs_epi32(_mm_packs_epi32(v[4], v[5]), _mm_packs_epi32(v[6], v[7]));
+		_mm_storeu_si128((__m128i *)(buf + i), _mm_packus_epi16(lo, hi));
+	}
+	for (; i < count; i++) buf[i] = ((const byte *)&_m[first + i])[Toffset];
+}
+
+/**
+ * Scatter a byte field of tiles, 16 tiles per step.
+ * @tparam Toffset Offset of the field within Tile.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <uint Toffset>
+static void ScatterTileByteSSE2(const byte *buf, size_t first, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i keep = _mm_xor_si128(_mm_slli_epi64(_mm_set_epi32(0, 0xFF, 0, 0xFF), Toffset * 8), _mm_set1_epi32(-1));
+	__m128i *dst = (__m128i *)(_m + first);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16, dst += 8) {
+		/* Widen the bytes to 16, 32 and 64 bit lanes and merge them into the tiles. */
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(buf + i));
+		__m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+		for (uint j = 0; j < 2; j++) {
+			__m128i dwords[2] = { _mm_unpacklo_epi16(words[j], zero), _mm_unpackhi_epi16(words[j], zero) };
+			for (uint k = 0; k < 2; k++) {
+				__m128i qwords[2] = { _mm_unpacklo_epi32(dwords[k], zero), _mm_unpackhi_epi32(dwords[k], zero) };
+				for (uint l = 0; l < 2; l++) {
+					__m128i *d = dst + j * 4 + k * 2 + l;
+					__m128i tiles = _mm_and_si128(_mm_loadu_si128(d), keep);
+					_mm_storeu_si128(d, _mm_or_si128(tiles, _mm_slli_epi64(qwords[l], Toffset * 8)));
+				}
+			}
+		}
+	}
+	for (; i < count; i++) ((byte *)&_m[first + i])[Toffset] = buf[i];
+}
+
+/**
+ * Gather Tile::m2 as big endian words, 8 tiles per step.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+static void GatherTileM2SSE2(byte *buf, size_t first, size_t count)
+{
+	const __m128i mask = _mm_set_epi32(0, 0xFFFF, 0, 0xFFFF);
+	const __m128i *src = (const __m128i *)(_m + first);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8, src += 4) {
+		__m128i v[4];
+		for (uint j = 0; j < 4; j++) {
+			/* Move the values in the 64 bit lanes to the lower two 32 bit lanes. */
+			v[j] = _mm_shuffle_epi32(_mm_and_si128(_mm_srli_epi64(_mm_loadu_si128(src + j), 16), mask), _MM_SHUFFLE(3, 1, 2, 0));
+		}
+		__m128i lo = _mm_unpacklo_epi64(v[0], v[1]);
+		__m128i hi = _mm_unpacklo_epi64(v[2], v[3]);
+
+		/* Sign extend, so packing with signed saturation keeps all 16 bits. */
+		lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+		hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+		__m128i words = _mm_packs_epi32(lo, hi);
+		words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+		_mm_storeu_si128((__m128i *)(buf + i * 2), words);
+	}
+	for (; i < count; i++) {
+		buf[i * 2] = GB(_m[first + i].m2, 8, 8);
+		buf[i * 2 + 1] = GB(_m[first + i].m2, 0, 8);
+	}
+}
+
+/**
+ * Scatter Tile::m2 from big endian words, 8 tiles per step.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+static void ScatterTileM2SSE2(const byte *buf, size_t first, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i keep = _mm_set_epi32(-1, 0x0000FFFF, -1, 0x0000FFFF);
+	__m128i *dst = (__m128i *)(_m + first);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8, dst += 4) {
+		__m128i words = _mm_loadu_si128((const __m128i *)(buf + i * 2));
+		words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+		__m128i dwords[2] = { _mm_unpacklo_epi16(words, zero), _mm_unpackhi_epi16(words, zero) };
+		for (uint k = 0; k < 2; k++) {
+			__m128i qwords[2] = { _mm_unpacklo_epi32(dwords[k], zero), _mm_unpackhi_epi32(dwords[k], zero) };
+			for (uint l = 0; l < 2; l++) {
+				__m128i *d = dst + k * 2 + l;
+				__m128i tiles = _mm_and_si128(_mm_loadu_si128(d), keep);
+				_mm_storeu_si128(d, _mm_or_si128(tiles, _mm_slli_epi64(qwords[l], 16)));
+			}
+		}
+	}
+	for (; i < count; i++) _m[first + i].m2 = buf[i * 2] << 8 | buf[i * 2 + 1];
+}
+
+/**
+ * Gather a field of TileExtended, 16 tiles per step.
+ * @tparam Toffset Offset of the field within TileExtended.
+ * @param buf Buffer to write the fields to.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <uint Toffset>
+static void GatherTileExtendedSSE2(byte *buf, size_t first, size_t count)
+{
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	const __m128i *src = (const __m128i *)(_me + first);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16, src += 2) {
+		__m128i lo = _mm_and_si128(_mm_srli_epi16(_mm_loadu_si128(src), Toffset * 8), mask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(_mm_loadu_si128(src + 1), Toffset * 8), mask);
+		_mm_storeu_si128((__m128i *)(buf + i), _mm_packus_epi16(lo, hi));
+	}
+	for (; i < count; i++) buf[i] = ((const byte *)&_me[first + i])[Toffset];
+}
+
+/**
+ * Scatter a field of TileExtended, 16 tiles per step.
+ * @tparam Toffset Offset of the field within TileExtended.
+ * @param buf Buffer to read the fields from.
+ * @param first First tile.
+ * @param count Number of tiles.
+ */
+template <uint Toffset>
+static void ScatterTileExtendedSSE2(const byte *buf, size_t first, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i keep = _mm_set1_epi16((short)~(0xFF << (Toffset * 8)));
+	__m128i *dst = (__m128i *)(_me + first);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16, dst += 2) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(buf + i));
+		__m128i lo = _mm_slli_epi16(_mm_unpacklo_epi8(bytes, zero), Toffset * 8);
+		__m128i hi = _mm_slli_epi16(_mm_unpackhi_epi8(bytes, zero), Toffset * 8);
+		_mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst), keep), lo));
+		_mm_storeu_si128(dst + 1, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst + 1), keep), hi));
+	}
+	for (; i < count; i++) ((byte *)&_me[first + i])[Toffset] = buf[i];
+}
+
+#define MSF_TILE_BYTE(field) { &GatherTileByteSSE2<offsetof(Tile, field)>, &ScatterTileByteSSE2<offsetof(Tile, field)>, 1 }
+#define MSF_TILE_EXTENDED(field) { &GatherTileExtendedSSE2<offsetof(TileExtended, field)>, &ScatterTileExtendedSSE2<offsetof(TileExtended, field)>, 1 }
+
+/** Field copying functions using SSE2, indexed by #MapSlField. */
+extern const MapFieldProcs _map_field_procs_sse2[MSF_END] = {
+	MSF_TILE_BYTE(type),
+	MSF_TILE_BYTE(height),
+	MSF_TILE_BYTE(m1),
+	{ &GatherTileM2SSE2, &ScatterTileM2SSE2, 2 },
+	MSF_TILE_BYTE(m3),
+	MSF_TILE_BYTE(m4),
+	MSF_TILE_BYTE(m5),
+	MSF_TILE_EXTENDED(m6),
+	MSF_TILE_EXTENDED(m7),
+};
+
+#undef MSF_TILE_BYTE
+#undef MSF_TILE_EXTENDED
+
+#endif /* WITH_SSE */
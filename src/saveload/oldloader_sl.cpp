@@ -48,6 +48,9 @@ void FixOldMapArray()
 	/* TTO/TTD/TTDP savegames could have buoys at tile 0
 	 * (without assigned station struct) */
 	MemSetT(&_m[0], 0);
+#ifdef SPLIT_MAP_ARRAYS
+	MemSetT(&_mth[0], 0);
+#endif /* SPLIT_MAP_ARRAYS */
 	SetTileType(0, MP_WATER);
 	SetTileOwner(0, OWNER_WATER);
 }
@@ -1478,6 +1481,9 @@ static bool LoadOldMapPart1(LoadgameState *ls, int num)
 	if (_savegame_type == SGT_TTO) {
 		MemSetT(_m, 0, OLD_MAP_SIZE);
 		MemSetT(_me, 0, OLD_MAP_SIZE);
+#ifdef SPLIT_MAP_ARRAYS
+		MemSetT(_mth, 0, OLD_MAP_SIZE);
+#endif /* SPLIT_MAP_ARRAYS */
 	}
 
 	for (uint i = 0; i < OLD_MAP_SIZE; i++) {
@@ -1509,7 +1515,7 @@ static bool LoadOldMapPart2(LoadgameState *ls, int num)
 	uint i;
 
 	for (i = 0; i < OLD_MAP_SIZE; i++) {
-		_m[i].type = ReadByte(ls);
+		TileTypeByte(i) = ReadByte(ls);
 	}
 	for (i = 0; i < OLD_MAP_SIZE; i++) {
 		_m[i].m5 = ReadByte(ls);
@@ -55,6 +55,7 @@
 
 #include "../safeguards.h"
 
+#include <chrono>
 #include <deque>
 #include <vector>
 
@@ -1329,6 +1330,70 @@ void SlArray(void *array, size_t length, VarType conv)
 	}
 }
 
+/**
+ * Save an array whose elements are written in savegame format by a function.
+ * The function writes straight into the dump buffer, so the elements do not
+ * go through the buffer byte by byte like with #SlArray.
+ * @param length Number of elements.
+ * @param elem_size Size of an element in the savegame, at most 8 bytes.
+ * @param proc Function writing the elements.
+ */
+void SlGatherArray(size_t length, size_t elem_size, SlGatherProc *proc)
+{
+	assert(_sl.action == SLA_SAVE && _sl.need_length == NL_NONE);
+	assert(elem_size <= 8);
+
+	MemoryDumper *dumper = _sl.dumper;
+	for (size_t i = 0; i != length;) {
+		size_t space = dumper->bufe - dumper->buf;
+		if (space < elem_size) {
+			/* The element does not fit in the current block; write it byte by byte. */
+			byte elem[8];
+			proc(elem, i, 1);
+			for (size_t j = 0; j != elem_size; j++) dumper->WriteByte(elem[j]);
+			i++;
+			continue;
+		}
+
+		size_t count = min(length - i, space / elem_size);
+		proc(dumper->buf, i, count);
+		dumper->buf += count * elem_size;
+		i += count;
+	}
+}
+
+/**
+ * Load an array whose elements are read from their savegame format by a function.
+ * The function reads straight from the read buffer, so the elements do not
+ * go through the buffer byte by byte like with #SlArray.
+ * @param length Number of elements.
+ * @param elem_size Size of an element in the savegame, at most 8 bytes.
+ * @param proc Function reading the elements.
+ */
+void SlScatterArray(size_t length, size_t elem_size, SlScatterProc *proc)
+{
+	assert(_sl.action == SLA_LOAD || _sl.action == SLA_LOAD_CHECK);
+	assert(elem_size <= 8);
+
+	ReadBuffer *reader = _sl.reader;
+	for (size_t i = 0; i != length;) {
+		size_t available = reader->bufe - reader->bufp;
+		if (available < elem_size) {
+			/* The element is split over two reads from the file; read it byte by byte. */
+			byte elem[8];
+			for (size_t j = 0; j != elem_size; j++) elem[j] = reader->ReadByte();
+			proc(elem, i, 1);
+			i++;
+			continue;
+		}
+
+		size_t count = min(length - i, available / elem_size);
+		proc(reader->bufp, i, count);
+		reader->bufp += count * elem_size;
+		i += count;
+	}
+}
+
 
 /**
  * Pointers cannot be saved to a savegame, so this functions gets
@@ -1999,6 +2064,80 @@ static void SlSaveChunk(const ChunkHandler *ch)
 	}
 }
 
+/** Filter for reading back a memory dump. */
+struct MemoryDumpLoadFilter : LoadFilter {
+	const MemoryDumper *dumper; ///< The dump to read.
+	size_t pos;                 ///< Number of bytes read so far.
+
+	/**
+	 * Initialise this filter.
+	 * @param dumper The dump to read.
+	 */
+	MemoryDumpLoadFilter(const MemoryDumper *dumper) : LoadFilter(nullptr), dumper(dumper), pos(0)
+	{
+	}
+
+	/* virtual */ size_t Read(byte *buf, size_t size)
+	{
+		size = min(size, this->dumper->GetSize() - this->pos);
+		for (size_t done = 0; done != size;) {
+			size_t offset = this->pos % MEMORY_CHUNK_SIZE;
+			size_t part = min(size - done, MEMORY_CHUNK_SIZE - offset);
+			memcpy(buf + done, this->dumper->blocks[this->pos / MEMORY_CHUNK_SIZE] + offset, part);
+			done += part;
+			this->pos += part;
+		}
+		return size;
+	}
+};
+
+/**
+ * Save chunks to memory and load them back, measuring both. The chunks must
+ * restore exactly what they saved, as the loaded data replaces that of the game.
+ * @param chunks Chunks to measure, the last one with #CH_LAST set.
+ * @param[out] result The measurements.
+ * @return False if saving or loading is in progress.
+ */
+bool SlBenchmarkChunks(const ChunkHandler *chunks, SlChunkBenchmark *result)
+{
+	if (_sl.saveinprogress || _sl.dumper != nullptr || _sl.reader != nullptr) return false;
+
+	uint16 sl_version = _sl_version;
+	_sl_version = SAVEGAME_VERSION;
+
+	MemoryDumper dumper;
+	_sl.dumper = &dumper;
+	_sl.action = SLA_SAVE;
+	auto start = std::chrono::steady_clock::now();
+	for (const ChunkHandler *ch = chunks;; ch++) {
+		SlSaveChunk(ch);
+		if (ch->flags & CH_LAST) break;
+	}
+	auto saved = std::chrono::steady_clock::now();
+	result->bytes = dumper.GetSize();
+
+	ReadBuffer reader(new MemoryDumpLoadFilter(&dumper));
+	_sl.reader = &reader;
+	_sl.action = SLA_LOAD;
+	for (const ChunkHandler *ch = chunks;; ch++) {
+		if (ch->save_proc != nullptr) {
+			if (SlReadUint32() != ch->id) NOT_REACHED();
+			SlLoadChunk(ch);
+		}
+		if (ch->flags & CH_LAST) break;
+	}
+	auto loaded = std::chrono::steady_clock::now();
+	delete reader.reader;
+
+	_sl.dumper = nullptr;
+	_sl.reader = nullptr;
+	_sl_version = sl_version;
+
+	result->save_us = std::chrono::duration_cast<std::chrono::microseconds>(saved - start).count();
+	result->load_us = std::chrono::duration_cast<std::chrono::microseconds>(loaded - saved).count();
+	return true;
+}
+
 /** Save all chunks */
 static void SlSaveChunks()
 {
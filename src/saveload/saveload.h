@@ -62,6 +62,22 @@ SaveOrLoadResult LoadWithFilter(struct LoadFilter *reader);
 typedef void ChunkSaveLoadProc();
 typedef void AutolengthProc(void *arg);
 
+/**
+ * Function writing consecutive elements of an array in their savegame format.
+ * @param buf Buffer to write the elements to.
+ * @param first Index of the first element.
+ * @param count Number of elements.
+ */
+typedef void SlGatherProc(byte *buf, size_t first, size_t count);
+
+/**
+ * Function reading consecutive elements of an array from their savegame format.
+ * @param buf Buffer to read the elements from.
+ * @param first Index of the first element.
+ * @param count Number of elements.
+ */
+typedef void SlScatterProc(const byte *buf, size_t first, size_t count);
+
 /** Handlers and description of chunk. */
 struct ChunkHandler {
 	uint32 id;                          ///< Unique ID (4 letters).
@@ -688,11 +704,22 @@ void SlWriteByte(byte b);
 
 void SlGlobList(const SaveLoadGlobVarList *sldg);
 void SlArray(void *array, size_t length, VarType conv);
+void SlGatherArray(size_t length, size_t elem_size, SlGatherProc *proc);
+void SlScatterArray(size_t length, size_t elem_size, SlScatterProc *proc);
 void SlObject(void *object, const SaveLoad *sld);
 bool SlObjectMember(void *object, const SaveLoad *sld);
 void NORETURN SlError(StringID string, const char *extra_msg = nullptr);
 void NORETURN SlErrorCorrupt(const char *msg);
 
+/** Measurements of saving chunks to memory and loading them back. */
+struct SlChunkBenchmark {
+	size_t bytes;      ///< Size of the saved chunks.
+	uint64 save_us;    ///< Microseconds spent saving.
+	uint64 load_us;    ///< Microseconds spent loading.
+};
+
+bool SlBenchmarkChunks(const ChunkHandler *chunks, SlChunkBenchmark *result);
+
 bool SaveloadCrashWithMissingNewGRFs();
 
 extern char _savegame_format[8];
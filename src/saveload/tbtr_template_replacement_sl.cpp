@@ -28,6 +28,8 @@ static void Load_TMPL_RPLS()
 		TemplateReplacement *tr = new (index) TemplateReplacement();
 		SlObject(tr, _template_replacement_desc);
 	}
+
+	RebuildTemplateReplacementGroupIndex();
 }
 
 extern const ChunkHandler _template_replacement_chunk_handlers[] = {
@@ -21,10 +21,8 @@
 
 #include "../safeguards.h"
 
-/**
- * Rebuild all the cached variables of towns.
- */
-void RebuildTownCaches()
+/** Reset the cached variables of all towns before counting their houses. */
+static void ResetTownCaches()
 {
 	Town *town;
 	InitializeBuildingCounts();
@@ -34,20 +32,27 @@ void RebuildTownCaches()
 		town->cache.population = 0;
 		town->cache.num_houses = 0;
 	}
+}
 
-	for (TileIndex t = 0; t < MapSize(); t++) {
-		if (!IsTileType(t, MP_HOUSE)) continue;
-
-		HouseID house_id = GetHouseType(t);
-		town = Town::GetByTile(t);
-		IncreaseBuildingCount(town, house_id);
-		if (IsHouseCompleted(t)) town->cache.population += HouseSpec::Get(house_id)->population;
+/**
+ * Count a house tile in the cached variables of its town.
+ * @param t The house tile.
+ */
+static inline void AddHouseToTownCaches(TileIndex t)
+{
+	HouseID house_id = GetHouseType(t);
+	Town *town = Town::GetByTile(t);
+	IncreaseBuildingCount(town, house_id);
+	if (IsHouseCompleted(t)) town->cache.population += HouseSpec::Get(house_id)->population;
 
-		/* Increase the number of houses for every house, but only once. */
-		if (GetHouseNorthPart(house_id) == 0) town->cache.num_houses++;
-	}
+	/* Increase the number of houses for every house, but only once. */
+	if (GetHouseNorthPart(house_id) == 0) town->cache.num_houses++;
+}
 
-	/* Update the population and num_house dependent values */
+/** Update the population and num_house dependent values */
+static void FinishTownCaches()
+{
+	Town *town;
 	FOR_ALL_TOWNS(town) {
 		UpdateTownRadius(town);
 		UpdateTownCargoes(town);
@@ -55,6 +60,36 @@ void RebuildTownCaches()
 	UpdateTownCargoBitmap();
 }
 
+/**
+ * Rebuild all the cached variables of towns.
+ */
+void RebuildTownCaches()
+{
+	ResetTownCaches();
+
+	for (TileIndex t = 0; t < MapSize(); t++) {
+		if (IsTileType(t, MP_HOUSE)) AddHouseToTownCaches(t);
+	}
+
+	FinishTownCaches();
+}
+
+/**
+ * Get the type of a house tile, replacing a type whose specs are not available any more.
+ * @param t The house tile.
+ * @return The house type the tile has, or gets when it is checked.
+ */
+static HouseID GetAvailableHouseType(TileIndex t)
+{
+	HouseID house_id = GetCleanHouseType(t);
+	if (!HouseSpec::Get(house_id)->enabled && house_id >= NEW_HOUSE_OFFSET) {
+		/* The specs for this type of house are not available any more, so
+		 * replace it with the substitute original house type. */
+		house_id = _house_mngr.GetSubstituteID(house_id);
+	}
+	return house_id;
+}
+
 /**
  * Check and update town and house values.
  *
@@ -62,56 +97,59 @@ void RebuildTownCaches()
  * town population the number of houses per
  * town, the town radius and the max passengers
  * of the town.
+ *
+ * Replacing unavailable house types, removing incomplete houses and
+ * counting the houses only ever change the tile at hand, so all of them
+ * happen in one sweep over the map. Tiles further on are looked at with
+ * the house type they will get.
  */
 void UpdateHousesAndTowns()
 {
-	for (TileIndex t = 0; t < MapSize(); t++) {
-		if (!IsTileType(t, MP_HOUSE)) continue;
-
-		HouseID house_id = GetCleanHouseType(t);
-		if (!HouseSpec::Get(house_id)->enabled && house_id >= NEW_HOUSE_OFFSET) {
-			/* The specs for this type of house are not available any more, so
-			 * replace it with the substitute original house type. */
-			house_id = _house_mngr.GetSubstituteID(house_id);
-			SetHouseType(t, house_id);
-		}
-	}
+	ResetTownCaches();
 
-	/* Check for cases when a NewGRF has set a wrong house substitute type. */
 	for (TileIndex t = 0; t < MapSize(); t++) {
 		if (!IsTileType(t, MP_HOUSE)) continue;
 
-		HouseID house_type = GetCleanHouseType(t);
+		HouseID house_type = GetAvailableHouseType(t);
+		if (house_type != GetCleanHouseType(t)) SetHouseType(t, house_type);
+
+		/* Check for cases when a NewGRF has set a wrong house substitute type. */
 		TileIndex north_tile = t + GetHouseNorthPart(house_type); // modifies 'house_type'!
 		if (t == north_tile) {
 			const HouseSpec *hs = HouseSpec::Get(house_type);
 			bool valid_house = true;
 			if (hs->building_flags & TILE_SIZE_2x1) {
 				TileIndex tile = t + TileDiffXY(1, 0);
-				if (!IsTileType(tile, MP_HOUSE) || GetCleanHouseType(tile) != house_type + 1) valid_house = false;
+				if (!IsTileType(tile, MP_HOUSE) || GetAvailableHouseType(tile) != house_type + 1) valid_house = false;
 			} else if (hs->building_flags & TILE_SIZE_1x2) {
 				TileIndex tile = t + TileDiffXY(0, 1);
-				if (!IsTileType(tile, MP_HOUSE) || GetCleanHouseType(tile) != house_type + 1) valid_house = false;
+				if (!IsTileType(tile, MP_HOUSE) || GetAvailableHouseType(tile) != house_type + 1) valid_house = false;
 			} else if (hs->building_flags & TILE_SIZE_2x2) {
 				TileIndex tile = t + TileDiffXY(0, 1);
-				if (!IsTileType(tile, MP_HOUSE) || GetCleanHouseType(tile) != house_type + 1) valid_house = false;
+				if (!IsTileType(tile, MP_HOUSE) || GetAvailableHouseType(tile) != house_type + 1) valid_house = false;
 				tile = t + TileDiffXY(1, 0);
-				if (!IsTileType(tile, MP_HOUSE) || GetCleanHouseType(tile) != house_type + 2) valid_house = false;
+				if (!IsTileType(tile, MP_HOUSE) || GetAvailableHouseType(tile) != house_type + 2) valid_house = false;
 				tile = t + TileDiffXY(1, 1);
-				if (!IsTileType(tile, MP_HOUSE) || GetCleanHouseType(tile) != house_type + 3) valid_house = false;
+				if (!IsTileType(tile, MP_HOUSE) || GetAvailableHouseType(tile) != house_type + 3) valid_house = false;
 			}
 			/* If not all tiles of this house are present remove the house.
 			 * The other tiles will get removed later in this loop because
 			 * their north tile is not the correct type anymore. */
-			if (!valid_house) DoClearSquare(t);
+			if (!valid_house) {
+				DoClearSquare(t);
+				continue;
+			}
 		} else if (!IsTileType(north_tile, MP_HOUSE) || GetCleanHouseType(north_tile) != house_type) {
 			/* This tile should be part of a multi-tile building but the
 			 * north tile of this house isn't on the map. */
 			DoClearSquare(t);
+			continue;
 		}
+
+		AddHouseToTownCaches(t);
 	}
 
-	RebuildTownCaches();
+	FinishTownCaches();
 }
 
 /** Save and load of towns. */
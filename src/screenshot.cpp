@@ -28,6 +28,11 @@
 #include "smallmap_gui.h"
 #include "smallmap_colours.h"
 #include "industry.h"
+#include "thread/thread.h"
+#include "cpu.h"
+#include "core/mem_func.hpp"
+
+#include <vector>
 
 #include "table/strings.h"
 
@@ -254,6 +259,108 @@ static void PNGAPI png_my_warning(png_structp png_ptr, png_const_charp message)
 	DEBUG(misc, 1, "[libpng] warning: %s - %s", message, (const char *)png_get_error_ptr(png_ptr));
 }
 
+/**
+ * Two strip buffers passed back and forth between the thread rendering the
+ * image and the thread compressing it, so both can work at the same time.
+ * Strips are handed over in order, alternating between the buffers.
+ */
+struct PNGStripQueue {
+	png_structp png_ptr; ///< The image being written; only used by the writer thread once it runs.
+	png_infop info_ptr;  ///< Information about the image.
+	uint w;              ///< Width of the image in pixels.
+	uint h;              ///< Height of the image in pixels.
+	uint bpp;            ///< Bytes per pixel.
+	ThreadMutex *mutex;  ///< Guards #lines and #written.
+	uint8 *buffers[2];   ///< The strip buffers.
+	uint lines[2];       ///< Number of lines rendered into each buffer, 0 when the buffer is free.
+	uint written;        ///< Number of lines written to the image, or skipped after an error.
+	uint next;           ///< Buffer the writer thread takes next.
+	bool failed;         ///< Whether writing the image failed.
+
+	/**
+	 * Wait until a buffer has been written and can be rendered into again.
+	 * @param i The buffer.
+	 */
+	void WaitForFree(uint i)
+	{
+		ThreadMutexLocker lock(this->mutex);
+		while (this->lines[i] != 0) this->mutex->WaitForSignal();
+	}
+
+	/**
+	 * Hand a rendered buffer to the writer thread.
+	 * @param i The buffer.
+	 * @param n Number of lines in the buffer.
+	 */
+	void Submit(uint i, uint n)
+	{
+		ThreadMutexLocker lock(this->mutex);
+		this->lines[i] = n;
+		this->mutex->SendSignal();
+	}
+
+	/**
+	 * Wait until the next buffer has been rendered.
+	 * @return Number of lines in the buffer.
+	 */
+	uint WaitForNext()
+	{
+		ThreadMutexLocker lock(this->mutex);
+		while (this->lines[this->next] == 0) this->mutex->WaitForSignal();
+		return this->lines[this->next];
+	}
+
+	/** Give the next buffer back to the rendering thread. */
+	void Release()
+	{
+		ThreadMutexLocker lock(this->mutex);
+		this->written += this->lines[this->next];
+		this->lines[this->next] = 0;
+		this->next ^= 1;
+		this->mutex->SendSignal();
+	}
+};
+
+/**
+ * Write all strips of the queue to the image.
+ * libpng reports errors with a longjmp, which must stay within this thread.
+ * @param q The queue.
+ * @return Whether the image was written successfully.
+ */
+static bool WritePNGStrips(PNGStripQueue *q)
+{
+	if (setjmp(png_jmpbuf(q->png_ptr))) return false;
+
+	while (q->written != q->h) {
+		uint n = q->WaitForNext();
+		const uint8 *buff = q->buffers[q->next];
+		for (uint i = 0; i != n; i++) {
+			png_write_row(q->png_ptr, buff + i * q->w * q->bpp);
+		}
+		q->Release();
+	}
+
+	png_write_end(q->png_ptr, q->info_ptr);
+	return true;
+}
+
+/**
+ * Entry point of the thread compressing the strips of a PNG image.
+ * @param arg The #PNGStripQueue.
+ */
+static void PNGWriterThread(void *arg)
+{
+	PNGStripQueue *q = (PNGStripQueue *)arg;
+	if (WritePNGStrips(q)) return;
+
+	/* Keep taking the strips, so the rendering thread does not wait forever. */
+	q->failed = true;
+	while (q->written != q->h) {
+		q->WaitForNext();
+		q->Release();
+	}
+}
+
 /**
  * Generic .PNG file image writer.
  * @param name        Filename, including extension.
@@ -377,33 +484,70 @@ static bool MakePNGImage(const char *name, ScreenshotCallback *callb, void *user
 #endif /* TTD_ENDIAN == TTD_LITTLE_ENDIAN */
 	}
 
-	/* use by default 64k temp memory */
-	maxlines = Clamp(65536 / w, 16, 128);
-
-	/* now generate the bitmap bits */
-	void *buff = CallocT<uint8>(w * maxlines * bpp); // by default generate 128 lines at a time.
+	/* Use strips of up to 4 MiB; fewer strips means less sprites drawn over and over again at their edges. */
+	maxlines = Clamp((4 << 20) / (w * bpp), 16, 1024);
+
+	PNGStripQueue q;
+	q.png_ptr = png_ptr;
+	q.info_ptr = info_ptr;
+	q.w = w;
+	q.h = h;
+	q.bpp = bpp;
+	q.mutex = nullptr;
+	q.buffers[0] = CallocT<uint8>(w * maxlines * bpp);
+	q.buffers[1] = nullptr;
+	q.lines[0] = q.lines[1] = 0;
+	q.written = 0;
+	q.next = 0;
+	q.failed = false;
+
+	/* When the image has multiple strips, compress one strip while rendering the next. */
+	ThreadObject *writer = nullptr;
+	if (h > maxlines) {
+		q.mutex = ThreadMutex::New();
+		q.buffers[1] = CallocT<uint8>(w * maxlines * bpp);
+		if (!ThreadObject::New(&PNGWriterThread, &q, &writer, "ottd:png")) writer = nullptr;
+	}
 
 	y = 0;
+	uint cur = 0;
 	do {
 		/* determine # lines to write */
 		n = min(h - y, maxlines);
 
 		/* render the pixels into the buffer */
-		callb(userdata, buff, y, w, n);
+		if (writer != nullptr) q.WaitForFree(cur);
+		callb(userdata, q.buffers[cur], y, w, n);
 		y += n;
 
+		if (writer != nullptr) {
+			q.Submit(cur, n);
+			cur ^= 1;
+			continue;
+		}
+
 		/* write them to png */
 		for (i = 0; i != n; i++) {
-			png_write_row(png_ptr, (png_bytep)buff + i * w * bpp);
+			png_write_row(png_ptr, (png_bytep)q.buffers[cur] + i * w * bpp);
 		}
 	} while (y != h);
 
-	png_write_end(png_ptr, info_ptr);
+	/* Declared after the setjmp, as it could be clobbered by the longjmp otherwise. */
+	bool success = true;
+	if (writer != nullptr) {
+		writer->Join();
+		delete writer;
+		success = !q.failed;
+	} else {
+		png_write_end(png_ptr, info_ptr);
+	}
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	free(buff);
+	delete q.mutex;
+	free(q.buffers[0]);
+	free(q.buffers[1]);
 	fclose(f);
-	return true;
+	return success;
 }
 #endif /* WITH_PNG */
 
@@ -1134,6 +1278,187 @@ static bool MakeFlatMinimapScreenshot(ScreenshotType screenshotType)
 	return sf->proc(MakeScreenshotName("minimap", sf->extension), MinimapCallback, &screenshotType, MapSizeX(), MapSizeY(), 32, _cur_palette.palette);
 }
 
+/** Width and height in pixels of the images written by the minimap exporter. */
+static const uint MINIMAP_EXPORT_TILE_SIZE = 256;
+
+/**
+ * Colours of the whole map as last exported, kept up to date with the tiles
+ * marked dirty since then, so only the parts of the map that changed are
+ * written again. The layout matches the flat minimap screenshots: pixel x
+ * of a row shows tile MapSizeX() - 1 - x.
+ */
+struct MinimapExporter {
+	ScreenshotType type;       ///< Type of minimap the colours are for.
+	uint chunks_x;             ///< Number of level 0 image tiles along the x axis of the image.
+	uint chunks_y;             ///< Number of level 0 image tiles along the y axis of the image.
+	std::vector<byte> colours; ///< Palette index of every pixel, empty when not set up.
+	std::vector<bool> dirty;   ///< Level 0 image tiles with tiles marked dirty since the last export.
+	std::vector<bool> changed; ///< Level 0 image tiles whose colours changed in the current export.
+};
+
+static MinimapExporter _minimap_exporter;
+
+/**
+ * Mark a tile as possibly changed for the minimap exporter.
+ * @param tile The tile.
+ */
+void MarkMinimapExportDirty(TileIndex tile)
+{
+	MinimapExporter &e = _minimap_exporter;
+	if (e.colours.empty()) return;
+
+	uint x = (MapMaxX() - TileX(tile)) / MINIMAP_EXPORT_TILE_SIZE;
+	uint y = TileY(tile) / MINIMAP_EXPORT_TILE_SIZE;
+	e.dirty[y * e.chunks_x + x] = true;
+}
+
+/** Forget the exported minimap, e.g. because another map was loaded. */
+void ResetMinimapExport()
+{
+	_minimap_exporter.colours.clear();
+}
+
+/** An image tile written by the minimap exporter. */
+struct MinimapExportImage {
+	uint level; ///< Zoom level, every pixel shows 2^level by 2^level map tiles.
+	uint left;  ///< Leftmost pixel of the image at its zoom level.
+	uint top;   ///< Topmost pixel of the image at its zoom level.
+};
+
+/**
+ * Callback for writing an image tile of the minimap exporter in 8bpp.
+ * @see ScreenshotCallback
+ */
+static void MinimapExportCallback(void *userdata, void *buf, uint y, uint pitch, uint n)
+{
+	const MinimapExportImage *img = (const MinimapExportImage *)userdata;
+	const byte *colours = _minimap_exporter.colours.data();
+	byte *dst = (byte *)buf;
+
+	for (uint row = 0; row < n; row++) {
+		const byte *src = colours + (size_t)((img->top + y + row) << img->level) * MapSizeX();
+		for (uint x = 0; x < pitch; x++) {
+			*dst++ = src[(img->left + x) << img->level];
+		}
+	}
+}
+
+/**
+ * Recalculate the colours of a level 0 image tile of the minimap exporter.
+ * @param cx Column of the image tile.
+ * @param cy Row of the image tile.
+ * @return Whether any colour changed.
+ */
+static bool UpdateMinimapExportChunk(uint cx, uint cy)
+{
+	MinimapExporter &e = _minimap_exporter;
+	bool changed = false;
+
+	uint right = min((cx + 1) * MINIMAP_EXPORT_TILE_SIZE, MapSizeX());
+	uint bottom = min((cy + 1) * MINIMAP_EXPORT_TILE_SIZE, MapSizeY());
+	for (uint y = cy * MINIMAP_EXPORT_TILE_SIZE; y < bottom; y++) {
+		byte *row = e.colours.data() + (size_t)y * MapSizeX();
+		for (uint x = cx * MINIMAP_EXPORT_TILE_SIZE; x < right; x++) {
+			TileIndex tile = TileXY(MapMaxX() - x, y);
+			byte val = IsTileType(tile, MP_VOID) ? 0 : GetMinimapPixels(tile, e.type);
+			if (row[x] != val) {
+				row[x] = val;
+				changed = true;
+			}
+		}
+	}
+	return changed;
+}
+
+/**
+ * Write the parts of a minimap that changed since the last export as a pyramid
+ * of image tiles of #MINIMAP_EXPORT_TILE_SIZE pixels in a directory below the
+ * screenshot directory. The files are named "<level>_<column>_<row>.<ext>",
+ * where level 0 has a pixel per map tile and every next level halves the
+ * resolution, up to the level that fits the whole map in one image.
+ * Only tiles marked dirty since the last export are looked at, so changes
+ * that do not mark their tile dirty, like a new company colour, need \a full.
+ * @param type Type of minimap to export.
+ * @param dir Name of the directory to write to.
+ * @param full Recalculate and write everything.
+ * @param[out] result What was done.
+ * @return False if an image could not be written.
+ */
+bool ExportMinimapTiles(ScreenshotType type, const char *dir, bool full, MinimapExportResult *result)
+{
+	MinimapExporter &e = _minimap_exporter;
+	uint64 start = ottd_rdtsc();
+	MemSetT(result, 0);
+
+	if (full || e.colours.empty() || e.type != type) {
+		e.type = type;
+		e.chunks_x = CeilDiv(MapSizeX(), MINIMAP_EXPORT_TILE_SIZE);
+		e.chunks_y = CeilDiv(MapSizeY(), MINIMAP_EXPORT_TILE_SIZE);
+		e.colours.assign(MapSize(), 0);
+		e.dirty.assign(e.chunks_x * e.chunks_y, true);
+		full = true;
+	}
+
+	e.changed.assign(e.chunks_x * e.chunks_y, full);
+	for (uint cy = 0; cy < e.chunks_y; cy++) {
+		for (uint cx = 0; cx < e.chunks_x; cx++) {
+			uint i = cy * e.chunks_x + cx;
+			if (!e.dirty[i]) continue;
+			e.dirty[i] = false;
+			result->chunks_updated++;
+			if (UpdateMinimapExportChunk(cx, cy)) e.changed[i] = true;
+		}
+	}
+
+	char path[MAX_PATH];
+	seprintf(path, lastof(path), "%s%s" PATHSEP, FiosGetScreenshotDir(), dir);
+	FioCreateDirectory(path);
+
+	const ScreenshotFormat *sf = _screenshot_formats + _cur_screenshot_format;
+	bool success = true;
+	for (uint level = 0;; level++) {
+		uint width = CeilDiv(MapSizeX(), 1 << level);
+		uint height = CeilDiv(MapSizeY(), 1 << level);
+		uint tiles_x = CeilDiv(width, MINIMAP_EXPORT_TILE_SIZE);
+		uint tiles_y = CeilDiv(height, MINIMAP_EXPORT_TILE_SIZE);
+
+		for (uint ty = 0; ty < tiles_y; ty++) {
+			for (uint tx = 0; tx < tiles_x; tx++) {
+				/* Write the image when any of the level 0 images it covers changed. */
+				bool changed = false;
+				uint cx_end = min((tx + 1) << level, e.chunks_x);
+				uint cy_end = min((ty + 1) << level, e.chunks_y);
+				for (uint cy = ty << level; cy < cy_end && !changed; cy++) {
+					for (uint cx = tx << level; cx < cx_end && !changed; cx++) {
+						changed = e.changed[cy * e.chunks_x + cx];
+					}
+				}
+				if (!changed) continue;
+
+				MinimapExportImage img;
+				img.level = level;
+				img.left = tx * MINIMAP_EXPORT_TILE_SIZE;
+				img.top = ty * MINIMAP_EXPORT_TILE_SIZE;
+
+				char name[MAX_PATH];
+				seprintf(name, lastof(name), "%s%u_%u_%u.%s", path, level, tx, ty, sf->extension);
+				if (!sf->proc(name, MinimapExportCallback, &img, min(width - img.left, MINIMAP_EXPORT_TILE_SIZE), min(height - img.top, MINIMAP_EXPORT_TILE_SIZE), 8, _cur_palette.palette)) {
+					success = false;
+				}
+				result->images_written++;
+			}
+		}
+
+		if (tiles_x == 1 && tiles_y == 1) {
+			result->levels = level + 1;
+			break;
+		}
+	}
+
+	result->cycles = ottd_rdtsc() - start;
+	return success;
+}
+
 /**
  * Make an actual screenshot.
  * @param t    the type of screenshot to make.
@@ -12,6 +12,8 @@
 #ifndef SCREENSHOT_H
 #define SCREENSHOT_H
 
+#include "tile_type.h"
+
 void InitializeScreenshotFormats();
 
 const char *GetCurrentScreenshotExtension();
@@ -30,12 +32,23 @@ enum ScreenshotType {
 	SC_MINI_OWNERMAP,    ///< Flat screenshot of the minimap showing routes colored by owner.
 };
 
+/** What an export of minimap image tiles did. */
+struct MinimapExportResult {
+	uint chunks_updated; ///< Number of level 0 image tiles whose colours were recalculated.
+	uint images_written; ///< Number of image files written.
+	uint levels;         ///< Number of zoom levels.
+	uint64 cycles;       ///< Processor cycles spent.
+};
+
 class SmallMapWindow;
 
 void SetupScreenshotViewport(ScreenshotType t, struct ViewPort *vp);
 bool MakeHeightmapScreenshot(const char *filename);
 bool MakeSmallMapScreenshot(unsigned int width, unsigned int height, SmallMapWindow *window);
 bool MakeScreenshot(ScreenshotType t, const char *name);
+bool ExportMinimapTiles(ScreenshotType type, const char *dir, bool full, MinimapExportResult *result);
+void MarkMinimapExportDirty(TileIndex tile);
+void ResetMinimapExport();
 
 extern char _screenshot_format_name[8];
 extern uint _num_screenshot_formats;
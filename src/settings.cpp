@@ -65,6 +65,7 @@
 #include "fios.h"
 #include "strings_func.h"
 #include "statusbar_gui.h"
+#include "spritecache_disk.h"
 
 #include "void_map.h"
 #include "station_base.h"
@@ -274,6 +274,7 @@ struct NetworkSettings {
 	uint16 server_port;                                   ///< port the server listens on
 	uint16 server_admin_port;                             ///< port the server listens on for the admin network
 	bool   server_admin_chat;                             ///< allow private chat for the server to be distributed to the admin network
+	bool   server_use_epoll;                              ///< let a dedicated server wait for its game and admin sockets with epoll, when available
 	char   server_name[NETWORK_NAME_LENGTH];              ///< name of the server
 	char   server_password[NETWORK_PASSWORD_LENGTH];      ///< password for joining this server
 	char   rcon_password[NETWORK_PASSWORD_LENGTH];        ///< password for rconsole (server side)
@@ -810,6 +810,8 @@ void SmallMapWindow::DrawVehicles(const DrawPixelInfo *dpi, Blitter *blitter) co
  */
 void SmallMapWindow::DrawTowns(const DrawPixelInfo *dpi) const
 {
+	UpdateDeferredVirtCoords();
+
 	const Town *t;
 	FOR_ALL_TOWNS(t) {
 		/* Remap the town coordinate */
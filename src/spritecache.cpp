@@ -11,12 +11,13 @@
 
 #include "stdafx.h"
 #include "fileio_func.h"
+#include "spritecache_disk.h"
 #include "spriteloader/grf.hpp"
 #include "gfx_func.h"
-#include "error.h"
 #include "zoom_func.h"
 #include "settings_type.h"
 #include "blitter/factory.hpp"
+#include "error.h"
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
 
@@ -24,7 +25,6 @@
 #include "table/strings.h"
 #include "table/palette_convert.h"
 
-#include "3rdparty/cpp-btree/btree_map.h"
 
 #include "safeguards.h"
 
@@ -38,7 +38,6 @@ struct SpriteCache {
 	size_t file_pos;
 	uint32 id;
 	uint16 file_slot;
-	int16 lru;
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
@@ -78,18 +77,81 @@ static SpriteCache *AllocateSpriteCache(uint index)
 }
 
 
-struct MemBlock {
-	size_t size;
-	byte data[];
+/**
+ * Header in front of every block of sprite data in the sprite cache.
+ * A block is either in use, in which case it is linked into the LRU list
+ * unless it holds a recolour sprite, or free, in which case it is linked
+ * into the free list of its size class.
+ */
+struct SpriteCacheBlock {
+	struct SpriteCacheSlab *slab; ///< Slab the block is part of.
+	SpriteCacheBlock *prev;       ///< Previous (more recently used or free) block in the list this block is in.
+	SpriteCacheBlock *next;       ///< Next (less recently used or free) block in the list this block is in.
+	uint32 sprite;                ///< Sprite the data in this block belongs to.
+	uint32 padding;               ///< Keep #data aligned.
+	byte data[];                  ///< The sprite data.
+};
+
+/**
+ * A chunk of memory of the sprite cache. Slabs of the normal size classes
+ * are split into equally sized blocks, large sprites get a slab of their own.
+ */
+struct SpriteCacheSlab {
+	SpriteCacheSlab *prev; ///< Previous slab.
+	SpriteCacheSlab *next; ///< Next slab.
+	size_t size;           ///< Size of the slab in bytes, including this header.
+	uint32 size_class;     ///< Size class of the blocks in this slab.
+	uint32 used;           ///< Number of blocks of this slab in use.
+};
+
+/* Keep the sprite data aligned the same as the blocks themselves. */
+assert_compile(sizeof(SpriteCacheBlock) % sizeof(size_t) == 0);
+assert_compile(sizeof(SpriteCacheSlab) % sizeof(size_t) == 0);
+
+static const uint SPRITE_CACHE_SLAB_SIZE = 256 * 1024; ///< Size of the slabs of the normal size classes.
+static const uint SPRITE_CACHE_SIZE_CLASSES = 37;      ///< Number of normal size classes, ranging from 64 bytes up to 32 KiB.
+static const uint SPRITE_CACHE_LARGE_CLASS = SPRITE_CACHE_SIZE_CLASSES; ///< Size class of blocks too large for any normal size class.
+
+/** Intrusive doubly linked list of blocks. */
+struct SpriteCacheBlockList {
+	SpriteCacheBlock *first; ///< First block of the list.
+	SpriteCacheBlock *last;  ///< Last block of the list.
+
+	/**
+	 * Add a block to the front of the list.
+	 * @param block Block to add.
+	 */
+	inline void PushFront(SpriteCacheBlock *block)
+	{
+		block->prev = nullptr;
+		block->next = this->first;
+		if (this->first != nullptr) this->first->prev = block;
+		this->first = block;
+		if (this->last == nullptr) this->last = block;
+	}
+
+	/**
+	 * Remove a block from the list.
+	 * @param block Block to remove.
+	 */
+	inline void Remove(SpriteCacheBlock *block)
+	{
+		if (block->prev != nullptr) block->prev->next = block->next; else this->first = block->next;
+		if (block->next != nullptr) block->next->prev = block->prev; else this->last = block->prev;
+		block->prev = nullptr;
+		block->next = nullptr;
+	}
 };
 
-static uint _sprite_lru_counter;
-static MemBlock *_spritecache_ptr;
-static uint _allocated_sprite_cache_size = 0;
-static int _compact_cache_counter;
+static SpriteCacheBlockList _sprite_lru;                                    ///< Evictable blocks, most recently used first.
+static SpriteCacheBlockList _sprite_free_blocks[SPRITE_CACHE_SIZE_CLASSES]; ///< Free blocks of each normal size class.
+static SpriteCacheSlab *_sprite_slabs = nullptr;                            ///< All slabs of the sprite cache.
+static size_t _sprite_cache_budget = 0;                                     ///< Maximum number of bytes of blocks in use, except those of recolour sprites.
+static SpriteCacheStats _sprite_cache_stats;                                ///< Statistics of the sprite cache.
 
-static void CompactSpriteCache();
 static void *AllocSprite(size_t mem_req);
+static void AddRecolourSpriteToCache(SpriteID sprite, void *data);
+static void FreeSpriteCacheEntry(SpriteCache *sc);
 
 /**
  * Skip the given amount of sprite graphics data.
@@ -393,6 +455,20 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
 	return dest;
 }
 
+static AllocatorProc *_encode_allocator; ///< Allocator #EncodeRecordingAllocator passes requests on to.
+static size_t _encode_size;              ///< Size of the last allocation done with #EncodeRecordingAllocator.
+
+/**
+ * Allocator recording the size of the allocation, for use when encoding a sprite.
+ * @param size Number of bytes to allocate.
+ * @return The memory.
+ */
+static void *EncodeRecordingAllocator(size_t size)
+{
+	_encode_size = size;
+	return _encode_allocator(size);
+}
+
 /**
  * Read a sprite from disk.
  * @param sc          Location of sprite.
@@ -412,6 +488,14 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 
 	DEBUG(sprite, 9, "Load sprite %d", id);
 
+	if (sprite_type != ST_MAPGEN) {
+		void *cached = LoadSpriteFromDiskCache(file_slot, file_pos, sprite_type, allocator);
+		if (cached != nullptr) {
+			_sprite_cache_stats.disk_hits++;
+			return cached;
+		}
+	}
+
 	SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];
 	uint8 sprite_avail = 0;
 	sprite[ZOOM_LVL_NORMAL].type = sprite_type;
@@ -473,12 +557,18 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		sprite[ZOOM_LVL_NORMAL].data   = sprite[ZOOM_LVL_GUI].data;
 	}
 
-	return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
+	if (!_sprite_disk_cache) return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
+
+	/* Remember how much memory the blitter needed, so the encoded sprite can be stored on disk. */
+	_encode_allocator = allocator;
+	Sprite *encoded = BlitterFactory::GetCurrentBlitter()->Encode(sprite, EncodeRecordingAllocator);
+	StoreSpriteInDiskCache(file_slot, file_pos, sprite_type, encoded, _encode_size);
+	return encoded;
 }
 
 
-/** Map from sprite numbers to position in the GRF file. */
-static btree::btree_map<uint32, size_t> _grf_sprite_offsets;
+static GRFSpriteOffsets _grf_sprite_offsets_read; ///< Sprite offsets of the current GRF, when read by #ReadGRFSpriteOffsets itself.
+static const GRFSpriteOffsets *_grf_sprite_offsets = &_grf_sprite_offsets_read; ///< Sprite offsets of the current GRF.
 
 /**
  * Get the file offset for a specific sprite in the sprite section of a GRF.
@@ -487,21 +577,25 @@ static btree::btree_map<uint32, size_t> _grf_sprite_offsets;
  */
 size_t GetGRFSpriteOffset(uint32 id)
 {
-	auto iter = _grf_sprite_offsets.find(id);
-	return iter != _grf_sprite_offsets.end() ? iter->second : SIZE_MAX;
+	auto iter = _grf_sprite_offsets->find(id);
+	return iter != _grf_sprite_offsets->end() ? iter->second : SIZE_MAX;
 }
 
 /**
  * Parse the sprite section of GRFs.
  * @param container_version Container version of the GRF we're currently processing.
+ * @param offsets Sprite offsets of the GRF as found by #IndexGRFSpriteOffsets, or \c nullptr to scan the sprite section now.
  */
-void ReadGRFSpriteOffsets(byte container_version)
+void ReadGRFSpriteOffsets(byte container_version, const GRFSpriteOffsets *offsets)
 {
-	_grf_sprite_offsets.clear();
+	_grf_sprite_offsets_read.clear();
+	_grf_sprite_offsets = offsets != nullptr ? offsets : &_grf_sprite_offsets_read;
 
 	if (container_version >= 2) {
 		/* Seek to sprite section of the GRF. */
 		size_t data_offset = FioReadDword();
+		if (offsets != nullptr) return;
+
 		size_t old_pos = FioGetPos();
 		FioSeekTo(data_offset, SEEK_CUR);
 
@@ -509,7 +603,7 @@ void ReadGRFSpriteOffsets(byte container_version)
 		 * offset for each newly encountered ID. */
 		uint32 id, prev_id = 0;
 		while ((id = FioReadDword()) != 0) {
-			if (id != prev_id) _grf_sprite_offsets[id] = FioGetPos() - 4;
+			if (id != prev_id) _grf_sprite_offsets_read[id] = FioGetPos() - 4;
 			prev_id = id;
 			FioSkipBytes(FioReadDword());
 		}
@@ -519,6 +613,136 @@ void ReadGRFSpriteOffsets(byte container_version)
 	}
 }
 
+/**
+ * Sequential reader of a GRF outside of the Fio file slots,
+ * so multiple GRFs can be read at the same time.
+ */
+struct GRFIndexReader {
+	FILE *f;           ///< The file to read from.
+	size_t pos;        ///< Position in the file of the first byte in the buffer.
+	size_t end;        ///< Position in the file after the last byte of the GRF.
+	size_t cur;        ///< Number of bytes of the buffer already consumed.
+	size_t filled;     ///< Number of valid bytes in the buffer.
+	byte buffer[65536]; ///< Data read from the file.
+
+	/**
+	 * Read the next byte.
+	 * @param[out] b The byte.
+	 * @return False when the end of the GRF has been reached.
+	 */
+	inline bool ReadByte(byte *b)
+	{
+		if (this->cur == this->filled && !this->Fill()) return false;
+		*b = this->buffer[this->cur++];
+		return true;
+	}
+
+	/**
+	 * Read the next little endian dword.
+	 * @param[out] d The dword.
+	 * @return False when the end of the GRF has been reached.
+	 */
+	bool ReadDword(uint32 *d)
+	{
+		byte b[4];
+		for (uint i = 0; i < lengthof(b); i++) {
+			if (!this->ReadByte(&b[i])) return false;
+		}
+		*d = b[0] | b[1] << 8 | b[2] << 16 | (uint32)b[3] << 24;
+		return true;
+	}
+
+	/**
+	 * Skip bytes. They are read anyway, so the loading stages find them in the cache of the OS.
+	 * @param n Number of bytes to skip.
+	 * @return False when the end of the GRF has been reached before skipping all bytes.
+	 */
+	bool Skip(size_t n)
+	{
+		while (n > this->filled - this->cur) {
+			n -= this->filled - this->cur;
+			this->cur = this->filled;
+			if (!this->Fill()) return false;
+		}
+		this->cur += n;
+		return true;
+	}
+
+	/** @return Position in the file of the next byte to read. */
+	inline size_t GetPos() const
+	{
+		return this->pos + this->cur;
+	}
+
+private:
+	/** Read the next block of the file into the buffer. */
+	bool Fill()
+	{
+		this->pos += this->filled;
+		this->cur = 0;
+		this->filled = fread(this->buffer, 1, min(sizeof(this->buffer), this->end - this->pos), this->f);
+		return this->filled != 0;
+	}
+};
+
+/**
+ * Read a GRF outside of the Fio file slots and find the position of all
+ * sprites in its sprite section, like #ReadGRFSpriteOffsets does for the
+ * GRF being loaded. Does not touch any global state, so it can be called
+ * from any thread.
+ * @param f The GRF, at its start.
+ * @param size Size of the GRF.
+ * @param[out] offsets The position of every sprite in the GRF.
+ * @return Container version of the GRF, or 0 if it could not be read.
+ */
+byte IndexGRFSpriteOffsets(FILE *f, size_t size, GRFSpriteOffsets *offsets)
+{
+	extern const byte _grf_cont_v2_sig[8];
+
+	GRFIndexReader *reader = new GRFIndexReader();
+	reader->f = f;
+	reader->pos = ftell(f);
+	reader->end = reader->pos + size;
+	reader->cur = 0;
+	reader->filled = 0;
+
+	byte container_version = 1;
+	byte b[2];
+	if (!reader->ReadByte(&b[0]) || !reader->ReadByte(&b[1])) container_version = 0;
+	if (container_version != 0 && b[0] == 0 && b[1] == 0) {
+		container_version = 2;
+		for (uint i = 0; i < lengthof(_grf_cont_v2_sig); i++) {
+			if (!reader->ReadByte(&b[0]) || b[0] != _grf_cont_v2_sig[i]) {
+				container_version = 0;
+				break;
+			}
+		}
+	}
+
+	if (container_version >= 2) {
+		uint32 data_size, id, prev_id = 0;
+		if (!reader->ReadDword(&data_size) || !reader->Skip(data_size)) container_version = 0;
+
+		while (container_version != 0) {
+			if (!reader->ReadDword(&id)) {
+				container_version = 0;
+				break;
+			}
+			if (id == 0) break;
+			if (id != prev_id) (*offsets)[id] = reader->GetPos() - 4;
+			prev_id = id;
+
+			uint32 len;
+			if (!reader->ReadDword(&len) || !reader->Skip(len)) container_version = 0;
+		}
+	} else if (container_version == 1) {
+		/* There is no sprite section, but read the file for the loading stages anyway. */
+		reader->Skip(size);
+	}
+
+	delete reader;
+	return container_version;
+}
 
 /**
  * Load a real or recolour sprite.
@@ -578,10 +802,12 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	if (sc->ptr != nullptr) FreeSpriteCacheEntry(sc);
+	if (type == ST_RECOLOUR) AddRecolourSpriteToCache(load_index, data);
+
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
-	sc->lru = 0;
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
@@ -596,6 +822,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
 	SpriteCache *scold = GetSpriteCache(old_spr);
 
+	if (scnew->ptr != nullptr) FreeSpriteCacheEntry(scnew);
 	scnew->file_slot = scold->file_slot;
 	scnew->file_pos = scold->file_pos;
 	scnew->ptr = nullptr;
@@ -606,106 +833,176 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 }
 
 /**
- * S_FREE_MASK is used to mask-out lower bits of MemBlock::size
- * If they are non-zero, the block is free.
- * S_FREE_MASK has to ensure MemBlock is correctly aligned -
- * it means 8B (S_FREE_MASK == 7) on 64bit systems!
+ * Get the block holding some sprite data.
+ * @param ptr The sprite data.
+ * @return The block.
  */
-static const size_t S_FREE_MASK = sizeof(size_t) - 1;
-
-/* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
-/* make sure it's a power of two */
-assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
+static inline SpriteCacheBlock *GetSpriteCacheBlock(void *ptr)
+{
+	return (SpriteCacheBlock *)ptr - 1;
+}
 
-static inline MemBlock *NextBlock(MemBlock *block)
+/**
+ * Get the size of the blocks of a size class.
+ * @param size_class The normal size class.
+ * @return Size of the blocks, including their header.
+ */
+static inline size_t GetSizeClassBlockSize(uint size_class)
 {
-	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
+	assert(size_class < SPRITE_CACHE_SIZE_CLASSES);
+	/* Four size classes per power of two, starting at 64 bytes. */
+	return (size_t)(4 + size_class % 4) << (size_class / 4 + 4);
 }
 
-static size_t GetSpriteCacheUsage()
+/**
+ * Get the smallest size class that fits a block.
+ * @param size Size of the block, including its header.
+ * @return The size class, SPRITE_CACHE_LARGE_CLASS if no normal size class is large enough.
+ */
+static inline uint GetSizeClass(size_t size)
 {
-	size_t tot_size = 0;
-	MemBlock *s;
+	if (size <= GetSizeClassBlockSize(0)) return 0;
+	if (size > GetSizeClassBlockSize(SPRITE_CACHE_SIZE_CLASSES - 1)) return SPRITE_CACHE_LARGE_CLASS;
 
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
-	}
+	/* The highest bit and the two bits below it of 'size - 1' determine the class. */
+	uint msb = FindLastBit(size - 1);
+	uint top = (uint)((size - 1) >> (msb - 2));
+	return 4 * (msb - 6) + top - 3;
+}
 
-	return tot_size;
+/**
+ * Get the number of bytes a block takes from its slab.
+ * @param block The block.
+ * @return Size of the block, including its header.
+ */
+static inline size_t GetSpriteCacheBlockSize(const SpriteCacheBlock *block)
+{
+	const SpriteCacheSlab *slab = block->slab;
+	return slab->size_class == SPRITE_CACHE_LARGE_CLASS ? slab->size : GetSizeClassBlockSize(slab->size_class);
 }
 
+/**
+ * Get the maximum number of bytes the slabs may take from the system.
+ * Partially used slabs of other size classes may hold free blocks, so this
+ * leaves some room on top of the budget, but it bounds that fragmentation.
+ * @return The maximum size of all slabs together.
+ */
+static inline size_t GetSpriteCacheAllocationLimit()
+{
+	return _sprite_cache_budget + _sprite_cache_budget / 2 + _sprite_cache_stats.recolour;
+}
 
-void IncreaseSpriteLRU()
+static void DeleteEntryFromSpriteCache();
+
+/**
+ * Lower the budget of the sprite cache to what it uses now, as the system
+ * could not provide more memory, and tell the user about it once.
+ */
+static void ReduceSpriteCacheBudget()
 {
-	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
+	static const size_t MIN_BUDGET = 2 * 1024 * 1024;
+	if (_sprite_cache_budget <= MIN_BUDGET) return;
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
+	size_t target_size = _sprite_cache_budget;
+	_sprite_cache_budget = max(MIN_BUDGET, _sprite_cache_stats.used);
+	if (_sprite_cache_budget >= target_size) return;
 
-		for (i = 0; i != _spritecache_items; i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->ptr != nullptr) {
-				if (sc->lru >= 0) {
-					sc->lru = -1;
-				} else if (sc->lru != -32768) {
-					sc->lru--;
-				}
-			}
-		}
-		_sprite_lru_counter = 0;
-	}
+	DEBUG(misc, 0, "Not enough memory to allocate " PRINTF_SIZE " MiB of spritecache. Spritecache was reduced to " PRINTF_SIZE " MiB.", target_size / 1024 / 1024, _sprite_cache_budget / 1024 / 1024);
 
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
-		_compact_cache_counter = 0;
-	}
+	ErrorMessageData msg(STR_CONFIG_ERROR_OUT_OF_MEMORY, STR_CONFIG_ERROR_SPRITECACHE_TOO_BIG);
+	msg.SetDParam(0, target_size);
+	msg.SetDParam(1, _sprite_cache_budget);
+	ScheduleErrorMessage(msg);
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
- * That is accomplished by moving the cached data.
+ * Allocate a new slab and link it into the list of slabs. When the system
+ * runs out of memory, sprites are evicted and the budget is lowered.
+ * @param size Size of the slab, including its header.
+ * @param size_class Size class of the blocks of the slab.
+ * @return The slab.
  */
-static void CompactSpriteCache()
+static SpriteCacheSlab *AllocateSpriteCacheSlab(size_t size, uint size_class)
 {
-	MemBlock *s;
+	SpriteCacheSlab *slab = (SpriteCacheSlab *)new (std::nothrow) byte[size];
+	while (slab == nullptr) {
+		if (_sprite_lru.last == nullptr) MallocError(size);
+		ReduceSpriteCacheBudget();
+		DeleteEntryFromSpriteCache();
+		slab = (SpriteCacheSlab *)new (std::nothrow) byte[size];
+	}
+	slab->size = size;
+	slab->size_class = size_class;
+	slab->used = 0;
+	slab->prev = nullptr;
+	slab->next = _sprite_slabs;
+	if (_sprite_slabs != nullptr) _sprite_slabs->prev = slab;
+	_sprite_slabs = slab;
+
+	_sprite_cache_stats.allocated += size;
+	_sprite_cache_stats.slabs++;
+	return slab;
+}
 
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+/**
+ * Return a slab of which no block is in use anymore to the system.
+ * @param slab The slab.
+ */
+static void FreeSpriteCacheSlab(SpriteCacheSlab *slab)
+{
+	assert(slab->used == 0);
 
-	for (s = _spritecache_ptr; s->size != 0;) {
-		if (s->size & S_FREE_MASK) {
-			MemBlock *next = NextBlock(s);
-			MemBlock temp;
-			SpriteID i;
+	if (slab->size_class != SPRITE_CACHE_LARGE_CLASS) {
+		/* All blocks of the slab are in the free list; take them out. */
+		const size_t block_size = GetSizeClassBlockSize(slab->size_class);
+		for (byte *b = (byte *)(slab + 1); b + block_size <= (byte *)slab + slab->size; b += block_size) {
+			_sprite_free_blocks[slab->size_class].Remove((SpriteCacheBlock *)b);
+		}
+	}
 
-			/* Since free blocks are automatically coalesced, this should hold true. */
-			assert(!(next->size & S_FREE_MASK));
+	if (slab->prev != nullptr) slab->prev->next = slab->next; else _sprite_slabs = slab->next;
+	if (slab->next != nullptr) slab->next->prev = slab->prev;
 
-			/* If the next block is the sentinel block, we can safely return */
-			if (next->size == 0) break;
+	_sprite_cache_stats.allocated -= slab->size;
+	_sprite_cache_stats.slabs--;
+	delete[] (byte *)slab;
+}
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+/**
+ * Split a new slab of a normal size class into blocks and put them into the free list.
+ * @param size_class The size class.
+ */
+static void AddSpriteCacheSlab(uint size_class)
+{
+	SpriteCacheSlab *slab = AllocateSpriteCacheSlab(SPRITE_CACHE_SLAB_SIZE, size_class);
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
-			/* Swap this and the next block */
-			temp = *s;
-			memmove(s, next, next->size);
-			s = NextBlock(s);
-			*s = temp;
+	const size_t block_size = GetSizeClassBlockSize(size_class);
+	for (byte *b = (byte *)(slab + 1); b + block_size <= (byte *)slab + slab->size; b += block_size) {
+		SpriteCacheBlock *block = (SpriteCacheBlock *)b;
+		block->slab = slab;
+		_sprite_free_blocks[size_class].PushFront(block);
+	}
+}
 
-			/* Coalesce free blocks */
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		} else {
-			s = NextBlock(s);
-		}
+/**
+ * Release a block; the sprite owning it must already have forgotten about it.
+ * @param block The block.
+ */
+static void FreeSpriteCacheBlock(SpriteCacheBlock *block)
+{
+	SpriteCacheSlab *slab = block->slab;
+	assert(slab->used > 0);
+	slab->used--;
+
+	if (slab->size_class == SPRITE_CACHE_LARGE_CLASS) {
+		_sprite_cache_stats.used -= slab->size;
+		FreeSpriteCacheSlab(slab);
+		return;
 	}
+
+	_sprite_cache_stats.used -= GetSizeClassBlockSize(slab->size_class);
+	_sprite_free_blocks[slab->size_class].PushFront(block);
+	if (slab->used == 0) FreeSpriteCacheSlab(slab);
 }
 
 /**
@@ -714,80 +1011,97 @@ static void CompactSpriteCache()
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	/* Mark the block as free (the block must be in use) */
-	MemBlock *s = (MemBlock*)GetSpriteCache(item)->ptr - 1;
-	assert(!(s->size & S_FREE_MASK));
-	s->size |= S_FREE_MASK;
-	GetSpriteCache(item)->ptr = nullptr;
-
-	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (s->size & S_FREE_MASK) {
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		}
-	}
+	SpriteCache *sc = GetSpriteCache(item);
+	SpriteCacheBlock *block = GetSpriteCacheBlock(sc->ptr);
+	_sprite_lru.Remove(block);
+	sc->ptr = nullptr;
+	FreeSpriteCacheBlock(block);
 }
 
-static void DeleteEntryFromSpriteCache()
+/**
+ * Keep a just read recolour sprite in the sprite cache. Recolour sprites are never
+ * evicted, as pointers to them are kept, so they do not count against the budget.
+ * @param sprite The sprite.
+ * @param data The data of the sprite, allocated with #AllocSprite.
+ */
+static void AddRecolourSpriteToCache(SpriteID sprite, void *data)
 {
-	uint best = UINT_MAX;
-	int cur_lru;
+	SpriteCacheBlock *block = GetSpriteCacheBlock(data);
+	block->sprite = sprite;
 
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+	size_t size = GetSpriteCacheBlockSize(block);
+	_sprite_cache_stats.used -= size;
+	_sprite_cache_stats.recolour += size;
+}
 
-	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != nullptr && sc->lru < cur_lru) {
-			cur_lru = sc->lru;
-			best = i;
-		}
+/**
+ * Release the data of a sprite that is being replaced by another one.
+ * @param sc The sprite.
+ */
+static void FreeSpriteCacheEntry(SpriteCache *sc)
+{
+	SpriteCacheBlock *block = GetSpriteCacheBlock(sc->ptr);
+	if (sc->type == ST_RECOLOUR) {
+		size_t size = GetSpriteCacheBlockSize(block);
+		_sprite_cache_stats.recolour -= size;
+		_sprite_cache_stats.used += size;
+	} else {
+		_sprite_lru.Remove(block);
 	}
+	sc->ptr = nullptr;
+	FreeSpriteCacheBlock(block);
+}
 
+/** Evict the least recently used sprite from the sprite cache. */
+static void DeleteEntryFromSpriteCache()
+{
 	/* Display an error message and die, in case we found no sprite at all.
 	 * This shouldn't really happen, unless all sprites are locked. */
-	if (best == UINT_MAX) error("Out of sprite memory");
+	if (_sprite_lru.last == nullptr) error("Out of sprite memory");
 
-	DeleteEntryFromSpriteCache(best);
+	DeleteEntryFromSpriteCache(_sprite_lru.last->sprite);
+	_sprite_cache_stats.evictions++;
 }
 
 static void *AllocSprite(size_t mem_req)
 {
-	mem_req += sizeof(MemBlock);
-
-	/* Align this to correct boundary. This also makes sure at least one
-	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
-
-	for (;;) {
-		MemBlock *s;
-
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
-
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
-
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
+	mem_req += sizeof(SpriteCacheBlock);
+
+	uint size_class = GetSizeClass(mem_req);
+	SpriteCacheBlock *block;
+	if (size_class == SPRITE_CACHE_LARGE_CLASS) {
+		mem_req = Align(mem_req + sizeof(SpriteCacheSlab), sizeof(size_t));
+		while ((_sprite_cache_stats.used + mem_req > _sprite_cache_budget ||
+				_sprite_cache_stats.allocated + mem_req > GetSpriteCacheAllocationLimit()) && _sprite_lru.last != nullptr) {
+			DeleteEntryFromSpriteCache();
+		}
 
-					return s->data;
-				}
+		SpriteCacheSlab *slab = AllocateSpriteCacheSlab(mem_req, size_class);
+		block = (SpriteCacheBlock *)(slab + 1);
+		block->slab = slab;
+		_sprite_cache_stats.used += mem_req;
+	} else {
+		/* Evict sprites until either a block of the right size class got freed, or
+		 * both the budget and the allocation limit allow for another slab. Evicting
+		 * returns slabs of which no block is in use anymore to the system. */
+		const size_t block_size = GetSizeClassBlockSize(size_class);
+		while (_sprite_free_blocks[size_class].first == nullptr) {
+			if ((_sprite_cache_stats.used + block_size <= _sprite_cache_budget &&
+					_sprite_cache_stats.allocated + SPRITE_CACHE_SLAB_SIZE <= GetSpriteCacheAllocationLimit()) || _sprite_lru.last == nullptr) {
+				AddSpriteCacheSlab(size_class);
+			} else {
+				DeleteEntryFromSpriteCache();
 			}
 		}
 
-		/* Reached sentinel, but no block found yet. Delete some old entry. */
-		DeleteEntryFromSpriteCache();
+		block = _sprite_free_blocks[size_class].first;
+		_sprite_free_blocks[size_class].Remove(block);
+		_sprite_cache_stats.used += block_size;
 	}
+
+	block->slab->used++;
+	block->sprite = 0;
+	return block->data;
 }
 
 /**
@@ -862,11 +1176,27 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	if (allocator == nullptr) {
 		/* Load sprite into/from spritecache */
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
-
-		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == nullptr) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		if (sc->ptr == nullptr) {
+			/* Load the sprite, if it is not loaded, yet */
+			_sprite_cache_stats.misses++;
+			sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+			if (sc->ptr == nullptr) return nullptr;
+
+			/* Recolour sprites are read when loading the GRF, so this is never one of those. */
+			SpriteCacheBlock *block = GetSpriteCacheBlock(sc->ptr);
+			block->sprite = sprite;
+			_sprite_lru.PushFront(block);
+		} else if (type != ST_RECOLOUR) {
+			/* Update LRU; recolour sprites are never evicted so they are not part of it. */
+			_sprite_cache_stats.hits++;
+			SpriteCacheBlock *block = GetSpriteCacheBlock(sc->ptr);
+			if (_sprite_lru.first != block) {
+				_sprite_lru.Remove(block);
+				_sprite_lru.PushFront(block);
+			}
+		} else {
+			_sprite_cache_stats.hits++;
+		}
 
 		return sc->ptr;
 	} else {
@@ -974,67 +1304,62 @@ uint32 GetSpriteMainColour(SpriteID sprite_id, PaletteID palette_id)
 	return 0;
 }
 
-static void GfxInitSpriteCache()
+/**
+ * Get the statistics of the sprite cache.
+ * @return The statistics.
+ */
+const SpriteCacheStats &GetSpriteCacheStats()
 {
-	/* initialize sprite cache heap */
-	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
-	uint target_size = (bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
+	_sprite_cache_stats.budget = _sprite_cache_budget;
+	return _sprite_cache_stats;
+}
 
-	/* Remember 'target_size' from the previous allocation attempt, so we do not try to reach the target_size multiple times in case of failure. */
-	static uint last_alloc_attempt = 0;
+/** Reset the hit, miss and eviction counters of the sprite cache. */
+void ResetSpriteCacheStats()
+{
+	_sprite_cache_stats.hits = 0;
+	_sprite_cache_stats.disk_hits = 0;
+	_sprite_cache_stats.misses = 0;
+	_sprite_cache_stats.evictions = 0;
+}
 
-	if (_spritecache_ptr == nullptr || (_allocated_sprite_cache_size != target_size && target_size != last_alloc_attempt)) {
-		delete[] reinterpret_cast<byte *>(_spritecache_ptr);
+static void GfxInitSpriteCache()
+{
+	/* Return all memory of the sprite cache; the sprites referring to it are reset by the caller. */
+	while (_sprite_slabs != nullptr) {
+		SpriteCacheSlab *slab = _sprite_slabs;
+		_sprite_slabs = slab->next;
+		delete[] (byte *)slab;
+	}
+	_sprite_lru = {};
+	for (uint i = 0; i < SPRITE_CACHE_SIZE_CLASSES; i++) _sprite_free_blocks[i] = {};
+	_sprite_cache_stats.allocated = 0;
+	_sprite_cache_stats.used = 0;
+	_sprite_cache_stats.recolour = 0;
+	_sprite_cache_stats.slabs = 0;
+
+	/* Memory is only taken from the system when needed, so just remember the budget. When
+	 * the system has less memory than that, the budget is lowered once it runs out. */
+	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
+	size_t target_size = (size_t)(bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
 
+	/* Remember 'target_size' from the previous attempt, so we do not try to reach the target_size multiple times in case of failure. */
+	static size_t last_alloc_attempt = 0;
+	if (_sprite_cache_budget == 0 || target_size != last_alloc_attempt) {
 		last_alloc_attempt = target_size;
-		_allocated_sprite_cache_size = target_size;
-
-		do {
-			try {
-				/* Try to allocate 50% more to make sure we do not allocate almost all available. */
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2]);
-			} catch (std::bad_alloc &) {
-				_spritecache_ptr = nullptr;
-			}
-
-			if (_spritecache_ptr != nullptr) {
-				/* Allocation succeeded, but we wanted less. */
-				delete[] reinterpret_cast<byte *>(_spritecache_ptr);
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size]);
-			} else if (_allocated_sprite_cache_size < 2 * 1024 * 1024) {
-				usererror("Cannot allocate spritecache");
-			} else {
-				/* Try again to allocate half. */
-				_allocated_sprite_cache_size >>= 1;
-			}
-		} while (_spritecache_ptr == nullptr);
-
-		if (_allocated_sprite_cache_size != target_size) {
-			DEBUG(misc, 0, "Not enough memory to allocate %d MiB of spritecache. Spritecache was reduced to %d MiB.", target_size / 1024 / 1024, _allocated_sprite_cache_size / 1024 / 1024);
-
-			ErrorMessageData msg(STR_CONFIG_ERROR_OUT_OF_MEMORY, STR_CONFIG_ERROR_SPRITECACHE_TOO_BIG);
-			msg.SetDParam(0, target_size);
-			msg.SetDParam(1, _allocated_sprite_cache_size);
-			ScheduleErrorMessage(msg);
-		}
+		_sprite_cache_budget = target_size;
 	}
-
-	/* A big free block */
-	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
-	/* Sentinel block (identified by size == 0) */
-	NextBlock(_spritecache_ptr)->size = 0;
 }
 
 void GfxInitSpriteMem()
 {
 	GfxInitSpriteCache();
+	OpenSpriteDiskCache();
 
 	/* Reset the spritecache 'pool' */
 	free(_spritecache);
 	_spritecache_items = 0;
 	_spritecache = nullptr;
-
-	_compact_cache_counter = 0;
 }
 
 /**
@@ -1043,11 +1368,13 @@ void GfxInitSpriteMem()
  */
 void GfxClearSpriteCache()
 {
-	/* Clear sprite ptr for all cached items */
-	for (uint i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != nullptr) DeleteEntryFromSpriteCache(i);
+	/* Only recolour sprites are not part of the LRU, and those are kept. */
+	while (_sprite_lru.first != nullptr) {
+		DeleteEntryFromSpriteCache(_sprite_lru.first->sprite);
 	}
+
+	/* The sprites are about to be encoded for a different blitter or zoom levels. */
+	OpenSpriteDiskCache();
 }
 
 /* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
@@ -13,6 +13,7 @@
 #define SPRITECACHE_H
 
 #include "gfx_type.h"
+#include "3rdparty/cpp-btree/btree_map.h"
 
 /** Data structure describing a sprite. */
 struct Sprite {
@@ -23,6 +24,19 @@ struct Sprite {
 	byte data[];   ///< Sprite data.
 };
 
+/** Statistics of the sprite cache. */
+struct SpriteCacheStats {
+	uint64 hits;      ///< Number of sprite requests served from the cache.
+	uint64 misses;    ///< Number of sprite requests that needed the sprite to be read.
+	uint64 disk_hits; ///< Number of sprites read that were copied from the sprite cache file instead of being decoded.
+	uint64 evictions; ///< Number of sprites removed from the cache to make room for others.
+	size_t used;      ///< Number of bytes of the blocks in use, except those of recolour sprites.
+	size_t recolour;  ///< Number of bytes of the blocks of recolour sprites, which are never evicted.
+	size_t allocated; ///< Number of bytes taken from the system.
+	size_t budget;    ///< Maximum number of bytes of the blocks in use, except those of recolour sprites.
+	uint slabs;       ///< Number of slabs the memory is taken in.
+};
+
 extern uint _sprite_cache_size;
 
 typedef void *AllocatorProc(size_t size);
@@ -50,9 +64,14 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+const SpriteCacheStats &GetSpriteCacheStats();
+void ResetSpriteCacheStats();
+
+/** Map from sprite numbers to position in the GRF file. */
+typedef btree::btree_map<uint32, size_t> GRFSpriteOffsets;
 
-void ReadGRFSpriteOffsets(byte container_version);
+byte IndexGRFSpriteOffsets(FILE *f, size_t size, GRFSpriteOffsets *offsets);
+void ReadGRFSpriteOffsets(byte container_version, const GRFSpriteOffsets *offsets = nullptr);
 size_t GetGRFSpriteOffset(uint32 id);
 bool LoadNextSprite(int load_index, byte file_index, uint file_sprite_id, byte container_version);
 bool SkipSpriteData(byte type, uint16 num);
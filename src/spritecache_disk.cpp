@@ -0,0 +1,372 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file spritecache_disk.cpp Persistent cache of sprites already encoded for the blitter.
+ *
+ * Decoding GRF sprites, creating the missing zoom levels and encoding them
+ * for the blitter is done again every session. When enabled, the result of
+ * that is appended to a file in the personal directory, so the next session
+ * can copy it straight from there. On systems that support it the file is
+ * memory mapped.
+ *
+ * The file starts with a #SpriteDiskCacheHeader, which records the blitter
+ * and zoom configuration the sprites were encoded for, followed by any number
+ * of #SpriteDiskCacheRecord each followed by the encoded sprite. Sprites are
+ * identified by the MD5 checksum of their GRF and their position in it.
+ *
+ * That configuration is part of the file name as well, so sessions with a
+ * different configuration use different files. A file is only ever appended
+ * to; a new file is written under a temporary name and then renamed, so other
+ * processes that have the old file mapped are not affected. Only the process
+ * holding the lock of the file appends to it; the others only read the sprites
+ * that were completely written when they opened it. As that needs file locks,
+ * the cache is only available on systems with flock.
+ */
+
+#include "stdafx.h"
+#include "spritecache_disk.h"
+#include "blitter/factory.hpp"
+#include "fileio_func.h"
+#include "fios.h"
+#include "gfx_func.h"
+#include "settings_type.h"
+#include "string_func.h"
+#include "zoom_func.h"
+#include "debug.h"
+#include "core/alloc_func.hpp"
+#include "core/math_func.hpp"
+#include "core/mem_func.hpp"
+
+#include <map>
+
+#if defined(UNIX)
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "safeguards.h"
+
+bool _sprite_disk_cache; ///< Whether encoded sprites are kept on disk between sessions.
+
+static const uint32 SPRITE_DISK_CACHE_MAGIC   = 0x4353544F; ///< "OTSC" in little endian.
+static const uint32 SPRITE_DISK_CACHE_VERSION = 1;          ///< Version of the file format.
+static const size_t SPRITE_DISK_CACHE_MAX_SIZE = (size_t)INT32_MAX; ///< Stop adding sprites when the file reaches this size.
+
+/** Header of the sprite cache file. */
+struct SpriteDiskCacheHeader {
+	uint32 magic;    ///< Always #SPRITE_DISK_CACHE_MAGIC; also catches files written on machines with a different endianness.
+	uint32 version;  ///< Always #SPRITE_DISK_CACHE_VERSION.
+	char config[56]; ///< The blitter and zoom configuration the sprites were encoded for.
+};
+
+/** Identification of a sprite in the sprite cache file. */
+struct SpriteDiskCacheKey {
+	uint8 md5sum[16];    ///< MD5 checksum of the GRF the sprite is from.
+	uint32 file_pos;     ///< Position of the sprite in the GRF.
+	uint8 type;          ///< The #SpriteType the sprite was read as.
+	uint8 palette_remap; ///< Whether the colours of the GRF were remapped to the other palette.
+	uint16 padding;      ///< Always zero.
+
+	bool operator <(const SpriteDiskCacheKey &other) const
+	{
+		return memcmp(this, &other, sizeof(*this)) < 0;
+	}
+};
+
+/** Header in front of every sprite in the sprite cache file. */
+struct SpriteDiskCacheRecord {
+	SpriteDiskCacheKey key; ///< The sprite the data belongs to.
+	uint32 size;            ///< Size of the encoded sprite; the data is padded to a multiple of eight bytes.
+	uint32 padding;         ///< Always zero.
+};
+
+assert_compile(sizeof(SpriteDiskCacheHeader) % 8 == 0);
+assert_compile(sizeof(SpriteDiskCacheRecord) % 8 == 0);
+
+/** Location of a sprite in the sprite cache file. */
+struct SpriteDiskCacheEntry {
+	size_t offset; ///< Offset of the encoded sprite in the file.
+	uint32 size;   ///< Size of the encoded sprite.
+};
+
+static FILE *_sprite_disk_cache_file = nullptr;      ///< The sprite cache file, or \c nullptr when not in use.
+static byte *_sprite_disk_cache_map = nullptr;       ///< The sprite cache file as it was when opened, when it could be mapped.
+static size_t _sprite_disk_cache_map_size = 0;       ///< Size of #_sprite_disk_cache_map.
+static size_t _sprite_disk_cache_file_size = 0;      ///< Size of the sprite cache file, including the sprites added this session.
+static bool _sprite_disk_cache_read_only = false;    ///< Whether another process is appending to the sprite cache file, so this one may not.
+static SpriteDiskCacheHeader _sprite_disk_cache_header; ///< Header of the opened sprite cache file.
+static std::map<SpriteDiskCacheKey, SpriteDiskCacheEntry> _sprite_disk_cache_index; ///< Location of all sprites in the sprite cache file.
+
+static uint8 _sprite_file_md5sum[MAX_FILE_SLOTS][16]; ///< MD5 checksum of the GRF loaded in each file slot.
+static bool _sprite_file_md5sum_known[MAX_FILE_SLOTS]; ///< Whether the MD5 checksum of the GRF in each file slot is known.
+
+/**
+ * Read from the sprite cache file.
+ * @param offset Position in the file to read from.
+ * @param[out] dest Buffer to read into.
+ * @param size Number of bytes to read.
+ * @return Whether all bytes could be read.
+ */
+static bool ReadSpriteDiskCache(size_t offset, void *dest, size_t size)
+{
+	if (offset + size <= _sprite_disk_cache_map_size) {
+		memcpy(dest, _sprite_disk_cache_map + offset, size);
+		return true;
+	}
+	if (fseek(_sprite_disk_cache_file, (long)offset, SEEK_SET) != 0) return false;
+	return fread(dest, 1, size, _sprite_disk_cache_file) == size;
+}
+
+/**
+ * Build the index of the sprites in the just opened sprite cache file.
+ * When another process is appending to the file, the last sprite might not be
+ * completely written yet; the index then ends before it.
+ * @return False if the file is corrupt or was written for a different configuration.
+ */
+static bool IndexSpriteDiskCache()
+{
+	SpriteDiskCacheHeader header;
+	if (_sprite_disk_cache_file_size < sizeof(header) || !ReadSpriteDiskCache(0, &header, sizeof(header))) return false;
+	if (memcmp(&header, &_sprite_disk_cache_header, sizeof(header)) != 0) return false;
+
+	size_t offset = sizeof(header);
+	while (offset < _sprite_disk_cache_file_size) {
+		SpriteDiskCacheRecord record;
+		size_t data_size = 0;
+		bool complete = offset + sizeof(record) <= _sprite_disk_cache_file_size;
+		if (complete) {
+			if (!ReadSpriteDiskCache(offset, &record, sizeof(record))) return false;
+			data_size = Align(record.size, 8);
+			complete = offset + sizeof(record) + data_size <= _sprite_disk_cache_file_size;
+		}
+
+		if (!complete) {
+			/* With the lock nobody else appends, so a partially written sprite makes all of the file suspect. */
+			if (!_sprite_disk_cache_read_only) return false;
+			_sprite_disk_cache_file_size = offset;
+			break;
+		}
+		offset += sizeof(record);
+
+		SpriteDiskCacheEntry &entry = _sprite_disk_cache_index[record.key];
+		entry.offset = offset;
+		entry.size = record.size;
+		offset += data_size;
+	}
+	return true;
+}
+
+/**
+ * Open the sprite cache file for the current blitter and zoom configuration,
+ * if it is enabled and not open already.
+ */
+void OpenSpriteDiskCache()
+{
+	Blitter *blitter = BlitterFactory::GetCurrentBlitter();
+	if (!_sprite_disk_cache || blitter == nullptr || blitter->GetScreenDepth() == 0) {
+		CloseSpriteDiskCache();
+		return;
+	}
+
+	SpriteDiskCacheHeader header;
+	MemSetT(&header, 0);
+	header.magic = SPRITE_DISK_CACHE_MAGIC;
+	header.version = SPRITE_DISK_CACHE_VERSION;
+	seprintf(header.config, lastof(header.config), "%s:%u:%u:%u", blitter->GetName(), (uint)_settings_client.gui.zoom_min, (uint)_settings_client.gui.zoom_max, (uint)_gui_zoom);
+
+	if (_sprite_disk_cache_file != nullptr && memcmp(&header, &_sprite_disk_cache_header, sizeof(header)) == 0) return;
+	CloseSpriteDiskCache();
+	_sprite_disk_cache_header = header;
+
+	char filename[MAX_PATH];
+	seprintf(filename, lastof(filename), "%ssprites_%s_%u-%u_%u_v%u.cache", _personal_dir, blitter->GetName(),
+			(uint)_settings_client.gui.zoom_min, (uint)_settings_client.gui.zoom_max, (uint)_gui_zoom, SPRITE_DISK_CACHE_VERSION);
+
+	_sprite_disk_cache_file = fopen(filename, "r+b");
+	if (_sprite_disk_cache_file != nullptr) {
+#if defined(UNIX)
+		/* Sprites are only appended by one process at a time; the others only read what was there when they opened it. */
+		_sprite_disk_cache_read_only = flock(fileno(_sprite_disk_cache_file), LOCK_EX | LOCK_NB) != 0;
+#endif
+		fseek(_sprite_disk_cache_file, 0, SEEK_END);
+		_sprite_disk_cache_file_size = ftell(_sprite_disk_cache_file);
+
+#if defined(UNIX)
+		if (_sprite_disk_cache_file_size > 0) {
+			void *map = mmap(nullptr, _sprite_disk_cache_file_size, PROT_READ, MAP_SHARED, fileno(_sprite_disk_cache_file), 0);
+			if (map != MAP_FAILED) {
+				_sprite_disk_cache_map = (byte *)map;
+				_sprite_disk_cache_map_size = _sprite_disk_cache_file_size;
+			}
+		}
+#endif
+
+		if (IndexSpriteDiskCache()) {
+			DEBUG(sprite, 1, "Using sprite cache file '%s' with " PRINTF_SIZE " sprites%s", filename, _sprite_disk_cache_index.size(), _sprite_disk_cache_read_only ? " read-only" : "");
+			return;
+		}
+
+		if (_sprite_disk_cache_read_only) {
+			/* The process holding the lock is using the file; leave it alone. */
+			DEBUG(sprite, 1, "Sprite cache file '%s' is corrupt and in use by another process; not using it", filename);
+			CloseSpriteDiskCache();
+			return;
+		}
+
+		DEBUG(sprite, 1, "Sprite cache file '%s' is corrupt or of an older version; starting anew", filename);
+		CloseSpriteDiskCache();
+		_sprite_disk_cache_header = header;
+	}
+
+	/* Never truncate the file, as other processes may have it mapped; replace it instead. */
+	char tmp_filename[MAX_PATH];
+#if defined(UNIX)
+	seprintf(tmp_filename, lastof(tmp_filename), "%s.%d.tmp", filename, (int)getpid());
+#else
+	seprintf(tmp_filename, lastof(tmp_filename), "%s.tmp", filename);
+#endif
+
+	_sprite_disk_cache_file = fopen(tmp_filename, "w+b");
+	if (_sprite_disk_cache_file == nullptr || fwrite(&header, sizeof(header), 1, _sprite_disk_cache_file) != 1 || fflush(_sprite_disk_cache_file) != 0) {
+		DEBUG(sprite, 0, "Could not create sprite cache file '%s'", tmp_filename);
+		CloseSpriteDiskCache();
+		remove(tmp_filename);
+		return;
+	}
+#if defined(UNIX)
+	flock(fileno(_sprite_disk_cache_file), LOCK_EX | LOCK_NB);
+#else
+	/* Renaming does not replace existing files on all systems. */
+	remove(filename);
+#endif
+	if (rename(tmp_filename, filename) != 0) {
+		DEBUG(sprite, 0, "Could not rename sprite cache file '%s' to '%s'", tmp_filename, filename);
+		CloseSpriteDiskCache();
+		remove(tmp_filename);
+		return;
+	}
+	_sprite_disk_cache_file_size = sizeof(header);
+}
+
+/** Close the sprite cache file. */
+void CloseSpriteDiskCache()
+{
+#if defined(UNIX)
+	if (_sprite_disk_cache_map != nullptr) munmap(_sprite_disk_cache_map, _sprite_disk_cache_map_size);
+#endif
+	_sprite_disk_cache_map = nullptr;
+	_sprite_disk_cache_map_size = 0;
+
+	if (_sprite_disk_cache_file != nullptr) fclose(_sprite_disk_cache_file);
+	_sprite_disk_cache_file = nullptr;
+	_sprite_disk_cache_file_size = 0;
+	_sprite_disk_cache_read_only = false;
+
+	_sprite_disk_cache_index.clear();
+	MemSetT(&_sprite_disk_cache_header, 0);
+}
+
+/**
+ * Set the MD5 checksum of a GRF, so its sprites can be found in the sprite cache file.
+ * @param file_slot The file slot the GRF is loaded in.
+ * @param md5sum The checksum, or \c nullptr when it is not known; the sprites of such GRFs are not cached.
+ */
+void SetSpriteFileMD5(uint file_slot, const uint8 *md5sum)
+{
+	assert(file_slot < MAX_FILE_SLOTS);
+	_sprite_file_md5sum_known[file_slot] = md5sum != nullptr;
+	if (md5sum != nullptr) memcpy(_sprite_file_md5sum[file_slot], md5sum, sizeof(_sprite_file_md5sum[file_slot]));
+}
+
+/**
+ * Get the key of a sprite in the sprite cache file.
+ * @param file_slot The file slot of the GRF of the sprite.
+ * @param file_pos The position of the sprite in the GRF.
+ * @param type The type the sprite is read as.
+ * @param[out] key The key.
+ * @return Whether the sprite can be in the sprite cache file.
+ */
+static bool GetSpriteDiskCacheKey(uint file_slot, size_t file_pos, SpriteType type, SpriteDiskCacheKey &key)
+{
+	if (_sprite_disk_cache_file == nullptr || !_sprite_file_md5sum_known[file_slot] || file_pos > UINT32_MAX) return false;
+
+	MemSetT(&key, 0);
+	memcpy(key.md5sum, _sprite_file_md5sum[file_slot], sizeof(key.md5sum));
+	key.file_pos = (uint32)file_pos;
+	key.type = type;
+	key.palette_remap = _palette_remap_grf[file_slot];
+	return true;
+}
+
+/**
+ * Get an encoded sprite from the sprite cache file.
+ * @param file_slot The file slot of the GRF of the sprite.
+ * @param file_pos The position of the sprite in the GRF.
+ * @param type The type the sprite is read as.
+ * @param allocator Allocator for the memory to copy the sprite to.
+ * @return The sprite, or \c nullptr if it is not in the sprite cache file.
+ */
+void *LoadSpriteFromDiskCache(uint file_slot, size_t file_pos, SpriteType type, AllocatorProc *allocator)
+{
+	SpriteDiskCacheKey key;
+	if (!GetSpriteDiskCacheKey(file_slot, file_pos, type, key)) return nullptr;
+
+	auto iter = _sprite_disk_cache_index.find(key);
+	if (iter == _sprite_disk_cache_index.end()) return nullptr;
+
+	void *dest = allocator(iter->second.size);
+	if (!ReadSpriteDiskCache(iter->second.offset, dest, iter->second.size)) {
+		/* The memory is only lost until the sprite cache is reset, and this only happens on I/O errors. */
+		DEBUG(sprite, 0, "Reading from the sprite cache file failed; no longer using it");
+		CloseSpriteDiskCache();
+		return nullptr;
+	}
+	return dest;
+}
+
+/**
+ * Add an encoded sprite to the sprite cache file.
+ * @param file_slot The file slot of the GRF of the sprite.
+ * @param file_pos The position of the sprite in the GRF.
+ * @param type The type the sprite was read as.
+ * @param data The encoded sprite.
+ * @param size The size of the encoded sprite.
+ */
+void StoreSpriteInDiskCache(uint file_slot, size_t file_pos, SpriteType type, const void *data, size_t size)
+{
+	if (_sprite_disk_cache_read_only) return;
+
+	SpriteDiskCacheKey key;
+	if (!GetSpriteDiskCacheKey(file_slot, file_pos, type, key)) return;
+	if (_sprite_disk_cache_index.find(key) != _sprite_disk_cache_index.end()) return;
+
+	const size_t data_size = Align(size, 8);
+	if (_sprite_disk_cache_file_size + sizeof(SpriteDiskCacheRecord) + data_size > SPRITE_DISK_CACHE_MAX_SIZE) return;
+
+	SpriteDiskCacheRecord record;
+	MemSetT(&record, 0);
+	record.key = key;
+	record.size = (uint32)size;
+
+	static const byte padding[8] = {};
+	if (fseek(_sprite_disk_cache_file, (long)_sprite_disk_cache_file_size, SEEK_SET) != 0 ||
+			fwrite(&record, sizeof(record), 1, _sprite_disk_cache_file) != 1 ||
+			fwrite(data, 1, size, _sprite_disk_cache_file) != size ||
+			fwrite(padding, 1, data_size - size, _sprite_disk_cache_file) != data_size - size) {
+		DEBUG(sprite, 0, "Writing to the sprite cache file failed; no longer using it");
+		CloseSpriteDiskCache();
+		return;
+	}
+
+	SpriteDiskCacheEntry &entry = _sprite_disk_cache_index[key];
+	entry.offset = _sprite_disk_cache_file_size + sizeof(record);
+	entry.size = record.size;
+	_sprite_disk_cache_file_size += sizeof(record) + data_size;
+}
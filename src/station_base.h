@@ -20,7 +20,7 @@
 #include "linkgraph/linkgraph_type.h"
 #include "newgrf_storage.h"
 #include "core/smallvec_type.hpp"
-#include "3rdparty/cpp-btree/btree_map.h"
+#include "core/flatmap_type.hpp"
 #include <map>
 #include <set>
 #include <vector>
@@ -32,21 +32,21 @@ static const byte INITIAL_STATION_RATING = 175;
 
 /**
  * Flow statistics telling how much flow should be sent along a link. This is
- * done by creating "flow shares" and using std::map's upper_bound() method to
+ * done by creating "flow shares" and using the map's upper_bound() method to
  * look them up with a random number. A flow share is the difference between a
  * key in a map and the previous key. So one key in the map doesn't actually
  * mean anything by itself.
  */
 class FlowStat {
 public:
-	typedef btree::btree_map<uint32, StationID> SharesMap;
+	typedef FlatMap<uint32, StationID> SharesMap;
 
 	static const SharesMap empty_sharesmap;
 
 	/**
 	 * Invalid constructor. This can't be called as a FlowStat must not be
 	 * empty. However, the constructor must be defined and reachable for
-	 * FlwoStat to be used in a std::map.
+	 * FlowStat to be used in a map.
 	 */
 	inline FlowStat() {NOT_REACHED();}
 
@@ -152,8 +152,12 @@ private:
 	uint unrestricted; ///< Limit for unrestricted shares.
 };
 
-/** Flow descriptions by origin stations. */
-class FlowStatMap : public std::map<StationID, FlowStat> {
+/**
+ * Flow descriptions by origin stations, sorted by origin. Stations rarely have
+ * more than a few hundred origins, so a sorted vector beats a tree for both
+ * the lookups done when routing cargo and the memory used.
+ */
+class FlowStatMap : public FlatMap<StationID, FlowStat> {
 public:
 	uint GetFlow() const;
 	uint GetFlowVia(StationID via) const;
@@ -4795,13 +4795,11 @@ StationID FlowStat::GetVia(StationID excluded, StationID excluded2) const
 void FlowStat::Invalidate()
 {
 	assert(!this->shares.empty());
-	SharesMap new_shares;
 	uint i = 0;
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
-		new_shares[++i] = it->second;
-		if (it->first == this->unrestricted) this->unrestricted = i;
+		if (it->first == this->unrestricted) this->unrestricted = i + 1;
+		it->first = ++i; // Keys only get smaller, so the order is kept.
 	}
-	this->shares.swap(new_shares);
 	assert(!this->shares.empty() && this->unrestricted <= (--this->shares.end())->first);
 }
 
@@ -4820,7 +4818,8 @@ void FlowStat::ChangeShare(StationID st, int flow)
 	uint removed_shares = 0;
 	uint added_shares = 0;
 	uint last_share = 0;
-	SharesMap new_shares;
+	/* The shares are rewritten in place; "out" is where the next kept share goes. */
+	SharesMap::iterator out = this->shares.begin();
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
 		if (it->second == st) {
 			if (flow < 0) {
@@ -4842,18 +4841,21 @@ void FlowStat::ChangeShare(StationID st, int flow)
 			 * removed. */
 			flow = 0;
 		}
-		new_shares[it->first + added_shares - removed_shares] = it->second;
 		last_share = it->first;
+		out->first = it->first + added_shares - removed_shares;
+		out->second = it->second;
+		++out;
 	}
+	this->shares.erase(out, this->shares.end());
 	if (flow > 0) {
-		new_shares[last_share + (uint)flow] = st;
+		/* The station wasn't found, so the shares are still unchanged here. */
 		if (this->unrestricted < last_share) {
 			this->ReleaseShare(st);
 		} else {
 			this->unrestricted += flow;
 		}
+		this->shares.push_back(SharesMap::value_type(last_share + (uint)flow, st));
 	}
-	this->shares.swap(new_shares);
 }
 
 /**
@@ -4866,7 +4868,8 @@ void FlowStat::RestrictShare(StationID st)
 	assert(!this->shares.empty());
 	uint flow = 0;
 	uint last_share = 0;
-	SharesMap new_shares;
+	/* The shares are rewritten in place; "out" is where the next kept share goes. */
+	SharesMap::iterator out = this->shares.begin();
 	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
 		if (flow == 0) {
 			if (it->first > this->unrestricted) return; // Not present or already restricted.
@@ -4874,16 +4877,18 @@ void FlowStat::RestrictShare(StationID st)
 				flow = it->first - last_share;
 				this->unrestricted -= flow;
 			} else {
-				new_shares[it->first] = it->second;
+				++out;
 			}
 		} else {
-			new_shares[it->first - flow] = it->second;
+			out->first = it->first - flow;
+			out->second = it->second;
+			++out;
 		}
 		last_share = it->first;
 	}
 	if (flow == 0) return;
-	new_shares[last_share + flow] = st;
-	this->shares.swap(new_shares);
+	this->shares.erase(out, this->shares.end());
+	this->shares.push_back(SharesMap::value_type(last_share + flow, st));
 	assert(!this->shares.empty());
 }
 
@@ -4911,16 +4916,17 @@ void FlowStat::ReleaseShare(StationID st)
 		next_share = it->first;
 	}
 	if (flow == 0) return;
-	SharesMap new_shares;
-	new_shares[flow] = st;
-	for (SharesMap::iterator it(this->shares.begin()); it != this->shares.end(); ++it) {
-		if (it->second != st) {
-			new_shares[flow + it->first] = it->second;
-		} else {
-			flow = 0;
-		}
+
+	/* Move the share to the front, shifting the shares before it up by its flow. */
+	SharesMap::iterator it(this->shares.begin());
+	while (it->second != st) ++it;
+	for (; it != this->shares.begin(); --it) {
+		SharesMap::iterator prev = it - 1;
+		it->first = prev->first + flow;
+		it->second = prev->second;
 	}
-	this->shares.swap(new_shares);
+	it->first = flow;
+	it->second = st;
 	assert(!this->shares.empty());
 }
 
@@ -4932,14 +4938,12 @@ void FlowStat::ReleaseShare(StationID st)
 void FlowStat::ScaleToMonthly(uint runtime)
 {
 	assert(runtime > 0);
-	SharesMap new_shares;
 	uint share = 0;
 	for (SharesMap::iterator i = this->shares.begin(); i != this->shares.end(); ++i) {
 		share = max(share + 1, i->first * 30 / runtime);
-		new_shares[share] = i->second;
 		if (this->unrestricted == i->first) this->unrestricted = share;
+		i->first = share; // Strictly increasing, so the order is kept.
 	}
-	this->shares.swap(new_shares);
 }
 
 /**
@@ -4950,9 +4954,9 @@ void FlowStat::ScaleToMonthly(uint runtime)
  */
 void FlowStatMap::AddFlow(StationID origin, StationID via, uint flow)
 {
-	FlowStatMap::iterator origin_it = this->find(origin);
-	if (origin_it == this->end()) {
-		this->insert(std::make_pair(origin, FlowStat(via, flow)));
+	FlowStatMap::iterator origin_it = this->lower_bound(origin);
+	if (origin_it == this->end() || origin_it->first != origin) {
+		this->Base::insert(origin_it, value_type(origin, FlowStat(via, flow)));
 	} else {
 		origin_it->second.ChangeShare(via, flow);
 		assert(!origin_it->second.GetShares()->empty());
@@ -4969,11 +4973,11 @@ void FlowStatMap::AddFlow(StationID origin, StationID via, uint flow)
  */
 void FlowStatMap::PassOnFlow(StationID origin, StationID via, uint flow)
 {
-	FlowStatMap::iterator prev_it = this->find(origin);
-	if (prev_it == this->end()) {
+	FlowStatMap::iterator prev_it = this->lower_bound(origin);
+	if (prev_it == this->end() || prev_it->first != origin) {
 		FlowStat fs(via, flow);
 		fs.AppendShare(INVALID_STATION, flow);
-		this->insert(std::make_pair(origin, fs));
+		this->Base::insert(prev_it, value_type(origin, fs));
 	} else {
 		prev_it->second.ChangeShare(via, flow);
 		prev_it->second.ChangeShare(INVALID_STATION, flow);
@@ -5013,16 +5017,19 @@ void FlowStatMap::FinalizeLocalConsumption(StationID self)
 StationIDStack FlowStatMap::DeleteFlows(StationID via)
 {
 	StationIDStack ret;
-	for (FlowStatMap::iterator f_it = this->begin(); f_it != this->end();) {
+	/* Compact the remaining flows in place instead of erasing them one by one. */
+	FlowStatMap::iterator keep = this->begin();
+	for (FlowStatMap::iterator f_it = this->begin(); f_it != this->end(); ++f_it) {
 		FlowStat &s_flows = f_it->second;
 		s_flows.ChangeShare(via, INT_MIN);
 		if (s_flows.GetShares()->empty()) {
 			ret.Push(f_it->first);
-			this->erase(f_it++);
 		} else {
-			++f_it;
+			if (keep != f_it) *keep = std::move(*f_it);
+			++keep;
 		}
 	}
+	this->erase(keep, this->end());
 	return ret;
 }
 
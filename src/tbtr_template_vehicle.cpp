@@ -32,6 +32,8 @@
 #include "newgrf_engine.h"
 #include "newgrf_cargo.h"
 
+#include <unordered_map>
+
 TemplatePool _template_pool("TemplatePool");
 INSTANTIATE_POOL_METHODS(Template)
 
@@ -100,14 +102,54 @@ int TemplateVehicle::Length() const
 	return l;
 }
 
-TemplateReplacement* GetTemplateReplacementByGroupID(GroupID gid)
+/** The template replacement of each group that has one. */
+static std::unordered_map<GroupID, TemplateReplacement *> _template_replacement_by_group;
+
+TemplateReplacement::TemplateReplacement(GroupID gid, TemplateID tid)
+{
+	this->group = gid;
+	this->sel_template = tid;
+	_template_replacement_by_group[gid] = this;
+}
+
+TemplateReplacement::~TemplateReplacement()
 {
+	auto it = _template_replacement_by_group.find(this->group);
+	if (it != _template_replacement_by_group.end() && it->second == this) _template_replacement_by_group.erase(it);
+}
+
+void TemplateReplacement::SetGroup(GroupID gid)
+{
+	auto it = _template_replacement_by_group.find(this->group);
+	if (it != _template_replacement_by_group.end() && it->second == this) _template_replacement_by_group.erase(it);
+	this->group = gid;
+	_template_replacement_by_group[gid] = this;
+}
+
+/**
+ * Rebuild the index of template replacements by group, after they have been loaded.
+ * Older savegames can have more than one replacement for a group; only the first
+ * one was ever used, so the others are removed.
+ */
+void RebuildTemplateReplacementGroupIndex()
+{
+	_template_replacement_by_group.clear();
+
 	TemplateReplacement *tr;
 	FOR_ALL_TEMPLATE_REPLACEMENTS(tr) {
-		if ( tr->Group() == gid )
-			return tr;
+		if (!_template_replacement_by_group.emplace(tr->Group(), tr).second) delete tr;
 	}
-	return 0;
+}
+
+/**
+ * Get the template replacement of a group.
+ * @param gid The group.
+ * @return The template replacement, or \c nullptr if the group has none.
+ */
+TemplateReplacement* GetTemplateReplacementByGroupID(GroupID gid)
+{
+	auto it = _template_replacement_by_group.find(gid);
+	return it != _template_replacement_by_group.end() ? it->second : nullptr;
 }
 
 bool IssueTemplateReplacement(GroupID gid, TemplateID tid) {
@@ -141,15 +183,12 @@ short TemplateVehicle::NumGroupsUsingTemplate() const
 
 short DeleteTemplateReplacementsByGroupID(GroupID g_id)
 {
-	short del_amount = 0;
-	const TemplateReplacement *tr;
-	FOR_ALL_TEMPLATE_REPLACEMENTS(tr) {
-		if ( tr->group == g_id ) {
-			delete tr;
-			del_amount++;
-		}
-	}
-	return del_amount;
+	/* There is at most one template replacement per group, see RebuildTemplateReplacementGroupIndex. */
+	TemplateReplacement *tr = GetTemplateReplacementByGroupID(g_id);
+	if (tr == nullptr) return 0;
+
+	delete tr;
+	return 1;
 }
 
 
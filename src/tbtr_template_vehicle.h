@@ -151,14 +151,14 @@ struct TemplateReplacement : TemplateReplacementPool::PoolItem<&_template_replac
 	GroupID group;
 	TemplateID sel_template;
 
-	TemplateReplacement(GroupID gid, TemplateID tid) { this->group=gid; this->sel_template=tid; }
+	TemplateReplacement(GroupID gid, TemplateID tid);
 	TemplateReplacement() {}
-	~TemplateReplacement() {}
+	~TemplateReplacement();
 
 	inline GroupID Group() { return this->group; }
 	inline GroupID Template() { return this->sel_template; }
 
-	inline void SetGroup(GroupID gid) { this->group = gid; }
+	void SetGroup(GroupID gid);
 	inline void SetTemplate(TemplateID tid) { this->sel_template = tid; }
 
 	inline TemplateID GetTemplateVehicleID() { return sel_template; }
@@ -174,6 +174,7 @@ struct TemplateReplacement : TemplateReplacementPool::PoolItem<&_template_replac
 
 TemplateReplacement* GetTemplateReplacementByGroupID(GroupID);
 bool IssueTemplateReplacement(GroupID, TemplateID);
+void RebuildTemplateReplacementGroupIndex();
 
 short DeleteTemplateReplacementsByGroupID(GroupID);
 
@@ -214,16 +214,9 @@ Train* DeleteVirtualTrain(Train *chain, Train *to_del) {
 // retrieve template vehicle from template replacement that belongs to the given group
 TemplateVehicle* GetTemplateVehicleByGroupID(GroupID gid) {
 	if (gid >= NEW_GROUP) return nullptr;
-	
-	TemplateReplacement *tr;
-	
-	FOR_ALL_TEMPLATE_REPLACEMENTS(tr) {
-		if (tr->Group() == gid) {
-			return TemplateVehicle::GetIfValid(tr->Template());		// there can be only one
-		}
-	}
-	
-	return 0;
+
+	TemplateReplacement *tr = GetTemplateReplacementByGroupID(gid);
+	return tr != nullptr ? TemplateVehicle::GetIfValid(tr->Template()) : nullptr;
 }
 
 /**
@@ -267,21 +260,53 @@ Train* ChainContainsEngine(EngineID eid, Train *chain) {
 	return 0;
 }
 
-// has O(n^2)
-Train* DepotContainsEngine(TileIndex tile, EngineID eid, Train *not_in=0) {
-	Train *t;
-	FOR_ALL_TRAINS(t) {
-		// conditions: v is stopped in the given depot, has the right engine and if 'not_in' is given v must not be contained within 'not_in'
-		// if 'not_in' is nullptr, no check is needed
-		if ( t->tile==tile
-				// If the veh belongs to a chain, wagons will not return true on IsStoppedInDepot(), only primary vehicles will
-				// in case of t not a primary veh, we demand it to be a free wagon to consider it for replacement
-				&& ((t->IsPrimaryVehicle() && t->IsStoppedInDepot()) || t->IsFreeWagon())
-				&& t->engine_type==eid
-				&& (not_in==0 || ChainContainsVehicle(not_in, t)==0))
-			return t;
+TemplateReplacementStats _template_replacement_stats; ///< Counters of the template replacement passes.
+
+/** Reset the counters of the template replacement passes. */
+void ResetTemplateReplacementStats()
+{
+	memset(&_template_replacement_stats, 0, sizeof(_template_replacement_stats));
+}
+
+/** Search state for #DepotContainsEngine. */
+struct DepotEngineSearch {
+	EngineID eid;  ///< Engine type to look for.
+	Train *not_in; ///< Chain the found vehicle may not be part of, or \c nullptr.
+	Train *found;  ///< Matching train with the lowest index so far.
+};
+
+static Vehicle *DepotContainsEngineEnum(Vehicle *v, void *data)
+{
+	DepotEngineSearch *search = (DepotEngineSearch *)data;
+	if (v->type != VEH_TRAIN) return nullptr;
+
+	Train *t = Train::From(v);
+	// conditions: v is stopped in the given depot, has the right engine and if 'not_in' is given v must not be contained within 'not_in'
+	// if 'not_in' is nullptr, no check is needed
+	// If the veh belongs to a chain, wagons will not return true on IsStoppedInDepot(), only primary vehicles will
+	// in case of t not a primary veh, we demand it to be a free wagon to consider it for replacement
+	if (((t->IsPrimaryVehicle() && t->IsStoppedInDepot()) || t->IsFreeWagon())
+			&& t->engine_type == search->eid
+			&& (search->not_in == nullptr || ChainContainsVehicle(search->not_in, t) == 0)
+			&& (search->found == nullptr || t->index < search->found->index)) {
+		search->found = t;
 	}
-	return 0;
+	return nullptr;
+}
+
+/**
+ * Find a vehicle of the given engine type that is available for reuse in a depot.
+ * Only the vehicles on the depot tile are considered; of those the one with the
+ * lowest index is returned, as the tile hash has no deterministic order.
+ * @param tile Depot tile.
+ * @param eid Engine type to look for.
+ * @param not_in Chain the found vehicle may not be part of, or \c nullptr.
+ * @return The found train, or \c nullptr if there is none.
+ */
+Train* DepotContainsEngine(TileIndex tile, EngineID eid, Train *not_in=0) {
+	DepotEngineSearch search = { eid, not_in, nullptr };
+	FindVehicleOnPos(tile, &search, &DepotContainsEngineEnum);
+	return search.found;
 }
 
 void NeutralizeStatus(Train *t) {
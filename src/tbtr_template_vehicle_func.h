@@ -53,4 +53,16 @@ void NeutralizeStatus(Train *t);
 bool TrainMatchesTemplate(const Train *t, TemplateVehicle *tv);
 bool TrainMatchesTemplateRefit(const Train *t, TemplateVehicle *tv);
 
+/** Counters of the per tick template replacement passes. */
+struct TemplateReplacementStats {
+	uint64 passes;     ///< Number of ticks in which trains were template replaced.
+	uint64 depots;     ///< Number of depot batches processed.
+	uint64 trains;     ///< Number of trains for which template replacement was attempted.
+	uint64 succeeded;  ///< Number of those attempts that succeeded.
+	uint64 cycles;     ///< CPU cycles spent in the replacement passes.
+};
+
+extern TemplateReplacementStats _template_replacement_stats;
+void ResetTemplateReplacementStats();
+
 #endif
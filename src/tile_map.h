@@ -31,7 +31,7 @@
 static inline uint TileHeight(TileIndex tile)
 {
 	assert(tile < MapSize());
-	return _m[tile].height;
+	return TileHeightByte(tile);
 }
 
 uint TileHeightOutsideMap(int x, int y);
@@ -50,7 +50,7 @@ static inline void SetTileHeight(TileIndex tile, uint height)
 {
 	assert(tile < MapSize());
 	assert(height <= MAX_TILE_HEIGHT);
-	_m[tile].height = height;
+	TileHeightByte(tile) = height;
 }
 
 /**
@@ -89,7 +89,7 @@ static inline uint TilePixelHeightOutsideMap(int x, int y)
 static inline TileType GetTileType(TileIndex tile)
 {
 	assert(tile < MapSize());
-	return (TileType)GB(_m[tile].type, 4, 4);
+	return (TileType)GB(TileTypeByte(tile), 4, 4);
 }
 
 /**
@@ -128,7 +128,7 @@ static inline void SetTileType(TileIndex tile, TileType type)
 	 * edges of the map. If _settings_game.construction.freeform_edges is true,
 	 * the upper edges of the map are also VOID tiles. */
 	assert(IsInnerTile(tile) == (type != MP_VOID));
-	SB(_m[tile].type, 4, 4, type);
+	SB(TileTypeByte(tile), 4, 4, type);
 }
 
 /**
@@ -219,7 +219,7 @@ static inline void SetTropicZone(TileIndex tile, TropicZone type)
 {
 	assert(tile < MapSize());
 	assert(!IsTileType(tile, MP_VOID) || type == TROPICZONE_NORMAL);
-	SB(_m[tile].type, 0, 2, type);
+	SB(TileTypeByte(tile), 0, 2, type);
 }
 
 /**
@@ -231,7 +231,7 @@ static inline void SetTropicZone(TileIndex tile, TropicZone type)
 static inline TropicZone GetTropicZone(TileIndex tile)
 {
 	assert(tile < MapSize());
-	return (TropicZone)GB(_m[tile].type, 0, 2);
+	return (TropicZone)GB(TileTypeByte(tile), 0, 2);
 }
 
 /**
@@ -41,6 +41,7 @@
 #include "autoreplace_func.h"
 #include "bridge_signal_map.h"
 #include "tunnelbridge.h"
+#include "vehiclelist.h"
 
 #include "table/strings.h"
 #include "table/train_cmd.h"
@@ -1013,6 +1014,9 @@ static void NormaliseSubtypes(Train *chain)
 	/* We must be the first in the chain. */
 	assert(chain->Previous() == nullptr);
 
+	/* Whether the vehicles are primary vehicles may change. */
+	MarkVehicleListIndexDirty(chain);
+
 	/* Set the appropriate bits for the first in the chain. */
 	if (chain->IsWagon()) {
 		chain->SetFreeWagon();
@@ -1023,6 +1027,7 @@ static void NormaliseSubtypes(Train *chain)
 
 	/* Now clear the bits for the rest of the chain */
 	for (Train *t = chain->Next(); t != nullptr; t = t->Next()) {
+		if (t->IsFrontEngine()) MarkVehicleListIndexDirty(t);
 		t->ClearFreeWagon();
 		t->ClearFrontEngine();
 	}
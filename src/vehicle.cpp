@@ -41,6 +41,7 @@
 #include "station_base.h"
 #include "strings_func.h"
 #include "tbtr_template_vehicle_func.h"
+#include "cpu.h"
 #include "timetable.h"
 #include "tracerestrict.h"
 #include "train.h"
@@ -416,6 +417,8 @@ Vehicle::Vehicle(VehicleType type)
 	this->cargo_age_counter  = 1;
 	this->last_station_visited = INVALID_STATION;
 	this->last_loading_station = INVALID_STATION;
+
+	MarkVehicleListIndexDirty(this);
 }
 
 /**
@@ -762,6 +765,7 @@ static TemplateReplacementMap _vehicles_to_templatereplace;
 
 void InitializeVehicles()
 {
+	InvalidateVehicleListIndex();
 	_vehicles_to_autoreplace.Reset();
 	ResetVehicleHash();
 }
@@ -874,6 +878,8 @@ void Vehicle::PreDestructor()
 {
 	if (CleaningPool()) return;
 
+	MarkVehicleListIndexDirty(this);
+
 	if (Station::IsValidID(this->last_station_visited)) {
 		Station *st = Station::Get(this->last_station_visited);
 		st->loading_vehicles.erase(std::remove(st->loading_vehicles.begin(), st->loading_vehicles.end(), this), st->loading_vehicles.end());
@@ -1108,6 +1114,88 @@ static void ShowAutoReplaceAdviceMessage(const CommandCost &res, const Vehicle *
 	AddVehicleAdviceNewsItem(message, v->index);
 }
 
+/** A train queued for template replacement in this tick. */
+struct TemplateReplacementJob {
+	TileIndex tile;      ///< Depot the train is in.
+	VehicleID index;     ///< The train.
+	bool stay_in_depot;  ///< Whether the train has to stay in the depot after replacement.
+
+	bool operator<(const TemplateReplacementJob &other) const
+	{
+		if (this->tile != other.tile) return this->tile < other.tile;
+		return this->index < other.index;
+	}
+};
+
+/**
+ * Template replace all trains that entered a depot this tick.
+ * The trains are processed per depot, and within a depot in order of their index,
+ * so the order does not depend on the order in which the trains happened to arrive.
+ * Each train is still replaced by a command of its own.
+ */
+static void RunTemplateReplacement()
+{
+	const uint64 start = ottd_rdtsc();
+
+	std::vector<TemplateReplacementJob> jobs;
+	jobs.reserve(_vehicles_to_templatereplace.Length());
+	for (TemplateReplacementMap::iterator it = _vehicles_to_templatereplace.Begin(); it != _vehicles_to_templatereplace.End(); it++) {
+		_vehicles_to_autoreplace.Erase(it->first);
+		jobs.push_back({ it->first->tile, it->first->index, it->second });
+	}
+	std::sort(jobs.begin(), jobs.end());
+
+	Backup<CompanyByte> tmpl_cur_company(_current_company, FILE_LINE);
+	TileIndex depot = INVALID_TILE;
+	for (const TemplateReplacementJob &job : jobs) {
+		/* An earlier replacement in the same depot may have taken this train apart. */
+		Train *t = Train::GetIfValid(job.index);
+		if (t == nullptr || !t->IsPrimaryVehicle() || t->tile != job.tile) continue;
+
+		if (job.tile != depot) {
+			depot = job.tile;
+			_template_replacement_stats.depots++;
+		}
+		_template_replacement_stats.trains++;
+
+		/* Store the position of the effect as the vehicle pointer will become invalid later */
+		int x = t->x_pos;
+		int y = t->y_pos;
+		int z = t->z_pos;
+
+		tmpl_cur_company.Change(t->owner);
+
+		t->vehstatus |= VS_STOPPED;
+		CommandCost res = DoCommand(t->tile, t->index, job.stay_in_depot ? 1 : 0, DC_EXEC, CMD_TEMPLATE_REPLACE_VEHICLE);
+
+		if (res.Succeeded()) {
+			_template_replacement_stats.succeeded++;
+			VehicleID t_new = _new_vehicle_id;
+			t = Train::From(Vehicle::Get(t_new));
+			const Company *c = Company::Get(_current_company);
+			SubtractMoneyFromCompany(CommandCost(EXPENSES_NEW_VEHICLES, (Money)c->settings.engine_renew_money));
+			CommandCost res2 = DoCommand(0, t_new, 1, DC_EXEC, CMD_AUTOREPLACE_VEHICLE);
+			SubtractMoneyFromCompany(CommandCost(EXPENSES_NEW_VEHICLES, -(Money)c->settings.engine_renew_money));
+			if (res2.Succeeded() || res.GetCost() == 0) res.AddCost(res2);
+		}
+
+		if (!IsLocalCompany()) continue;
+
+		if (res.Succeeded()) {
+			if (res.GetCost() != 0) {
+				ShowCostOrIncomeAnimation(x, y, z, res.GetCost());
+			}
+			continue;
+		}
+
+		ShowAutoReplaceAdviceMessage(res, t);
+	}
+	tmpl_cur_company.Restore();
+
+	_template_replacement_stats.passes++;
+	_template_replacement_stats.cycles += ottd_rdtsc() - start;
+}
+
 void CallVehicleTicks()
 {
 	_vehicles_to_autoreplace.Clear();
@@ -1189,46 +1277,7 @@ void CallVehicleTicks()
 	}
  
 	/* do Template Replacement */
-	Backup<CompanyByte> tmpl_cur_company(_current_company, FILE_LINE);
-	for (TemplateReplacementMap::iterator it = _vehicles_to_templatereplace.Begin(); it != _vehicles_to_templatereplace.End(); it++) {
-		Train *t = it->first;
-
-		_vehicles_to_autoreplace.Erase(t);
-
-		/* Store the position of the effect as the vehicle pointer will become invalid later */
-		int x = t->x_pos;
-		int y = t->y_pos;
-		int z = t->z_pos;
-
-		tmpl_cur_company.Change(t->owner);
-
-		bool stayInDepot = it->second;
-
-		it->first->vehstatus |= VS_STOPPED;
-		CommandCost res = DoCommand(t->tile, t->index, stayInDepot ? 1 : 0, DC_EXEC, CMD_TEMPLATE_REPLACE_VEHICLE);
- 
-		if (res.Succeeded()) {
-			VehicleID t_new = _new_vehicle_id;
-			t = Train::From(Vehicle::Get(t_new));
-			const Company *c = Company::Get(_current_company);
-			SubtractMoneyFromCompany(CommandCost(EXPENSES_NEW_VEHICLES, (Money)c->settings.engine_renew_money));
-			CommandCost res2 = DoCommand(0, t_new, 1, DC_EXEC, CMD_AUTOREPLACE_VEHICLE);
-			SubtractMoneyFromCompany(CommandCost(EXPENSES_NEW_VEHICLES, -(Money)c->settings.engine_renew_money));
-			if (res2.Succeeded() || res.GetCost() == 0) res.AddCost(res2);
-		}
-
-		if (!IsLocalCompany()) continue;
-
-		if (res.Succeeded()) {
-			if (res.GetCost() != 0) {
-				ShowCostOrIncomeAnimation(x, y, z, res.GetCost());
-			}
-			continue;
-		}
-
-		ShowAutoReplaceAdviceMessage(res, t);
-	}
-	tmpl_cur_company.Restore();
+	if (_vehicles_to_templatereplace.Length() > 0) RunTemplateReplacement();
 
 	/* do Auto Replacement */
 	Backup<CompanyByte> cur_company(_current_company, FILE_LINE);
@@ -3245,6 +3294,7 @@ void Vehicle::AddToShared(Vehicle *shared_chain)
 
 	shared_chain->orders.list->AddVehicle(this);
 	shared_chain->orders.list->MarkSeparationInvalid();
+	MarkVehicleListIndexDirty(this);
 }
 
 /**
@@ -3257,6 +3307,7 @@ void Vehicle::RemoveFromShared()
 	bool were_first = (this->FirstShared() == this);
 	VehicleListIdentifier vli(VL_SHARED_ORDERS, this->type, this->owner, this->FirstShared()->index);
 
+	MarkVehicleListIndexDirty(this);
 	this->orders.list->MarkSeparationInvalid();
 	this->orders.list->RemoveVehicle(this);
 
@@ -15,8 +15,253 @@
 #include "group.h"
 #include "tracerestrict.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
 #include "safeguards.h"
 
+/** A vehicle and something it relates to, e.g. a station it has orders to. */
+typedef std::pair<uint32, VehicleID> VehicleListIndexEntry;
+
+/** What a primary vehicle is listed under in the reverse indices. */
+struct VehicleListIndexRecord {
+	GroupID group;                   ///< Group of the vehicle.
+	std::vector<StationID> stations; ///< Stations and waypoints the vehicle has (implicit) orders to.
+	std::vector<DepotID> depots;     ///< Depots the vehicle has orders to.
+};
+
+/**
+ * Reverse indices to build the station, depot and group lists from without
+ * looking at every vehicle and order. They are built on first use; after that
+ * the vehicles whose orders, group or existence changed are marked, and only
+ * those are looked at again on the next use.
+ */
+struct VehicleListIndex {
+	std::set<VehicleListIndexEntry> stations;            ///< Stations and waypoints each primary vehicle has (implicit) orders to.
+	std::set<VehicleListIndexEntry> depots;              ///< Depots each primary vehicle has orders to.
+	std::set<VehicleListIndexEntry> groups;              ///< Group of each primary vehicle.
+	std::map<VehicleID, VehicleListIndexRecord> records; ///< What each primary vehicle is listed under.
+	std::vector<VehicleID> dirty;                        ///< Vehicles that changed since the last update.
+	bool valid;                                          ///< Whether the indices have been built.
+
+	void Build();
+	void Update();
+	void MarkDirty(VehicleID index);
+	void Add(VehicleID index, VehicleListIndexRecord &record);
+	void Remove(VehicleID index);
+
+	/**
+	 * Add the vehicles related to \a key in \a index to a list.
+	 * @param index The index to look in.
+	 * @param key The station, depot or group.
+	 * @param[out] list The list to add the vehicles to.
+	 */
+	static void Find(const std::set<VehicleListIndexEntry> &index, uint32 key, std::vector<VehicleID> *list)
+	{
+		for (auto it = index.lower_bound(VehicleListIndexEntry(key, 0)); it != index.end() && it->first == key; ++it) list->push_back(it->second);
+	}
+};
+
+static VehicleListIndex _vehicle_list_index; ///< Reverse indices of the vehicle lists.
+
+/**
+ * Throw away the reverse indices of the vehicle lists, so they are built anew
+ * on their next use; to be called when (nearly) all vehicles change at once.
+ */
+void InvalidateVehicleListIndex()
+{
+	_vehicle_list_index.valid = false;
+	_vehicle_list_index.dirty.clear();
+}
+
+/**
+ * Mark a vehicle for being looked at again by the reverse indices of the vehicle
+ * lists; to be called when it is built or deleted, or when it changes group, orders
+ * or whether it is a primary vehicle.
+ * @param v The vehicle.
+ */
+void MarkVehicleListIndexDirty(const Vehicle *v)
+{
+	_vehicle_list_index.MarkDirty(v->index);
+}
+
+/**
+ * Mark all vehicles sharing an order list for being looked at again by the
+ * reverse indices of the vehicle lists; to be called when the orders change.
+ * @param list The order list.
+ */
+void MarkVehicleListIndexDirty(const OrderList *list)
+{
+	for (const Vehicle *v = list->GetFirstSharedVehicle(); v != nullptr; v = v->NextShared()) {
+		_vehicle_list_index.MarkDirty(v->index);
+	}
+}
+
+/**
+ * Get the stations and depots a chain of orders goes to.
+ * @param first The first order of the chain, may be \c nullptr.
+ * @param[out] stations The stations and waypoints, sorted and without duplicates.
+ * @param[out] depots The depots, sorted and without duplicates.
+ */
+static void GetOrderDestinations(const Order *first, std::vector<StationID> &stations, std::vector<DepotID> &depots)
+{
+	stations.clear();
+	depots.clear();
+
+	for (const Order *order = first; order != nullptr; order = order->next) {
+		if (order->IsType(OT_GOTO_STATION) || order->IsType(OT_GOTO_WAYPOINT) || order->IsType(OT_IMPLICIT)) {
+			stations.push_back(order->GetDestination());
+		} else if (order->IsType(OT_GOTO_DEPOT) && !(order->GetDepotActionType() & ODATFB_NEAREST_DEPOT)) {
+			depots.push_back(order->GetDestination());
+		}
+	}
+	std::sort(stations.begin(), stations.end());
+	stations.erase(std::unique(stations.begin(), stations.end()), stations.end());
+	std::sort(depots.begin(), depots.end());
+	depots.erase(std::unique(depots.begin(), depots.end()), depots.end());
+}
+
+/**
+ * Add a primary vehicle to the indices.
+ * @param index The vehicle.
+ * @param record What the vehicle is listed under; its contents are taken over.
+ */
+void VehicleListIndex::Add(VehicleID index, VehicleListIndexRecord &record)
+{
+	this->groups.emplace(record.group, index);
+	for (StationID st : record.stations) this->stations.emplace(st, index);
+	for (DepotID dep : record.depots) this->depots.emplace(dep, index);
+	this->records[index] = std::move(record);
+}
+
+/**
+ * Remove a vehicle from the indices, if it is in them.
+ * @param index The vehicle.
+ */
+void VehicleListIndex::Remove(VehicleID index)
+{
+	auto it = this->records.find(index);
+	if (it == this->records.end()) return;
+
+	const VehicleListIndexRecord &record = it->second;
+	this->groups.erase(VehicleListIndexEntry(record.group, index));
+	for (StationID st : record.stations) this->stations.erase(VehicleListIndexEntry(st, index));
+	for (DepotID dep : record.depots) this->depots.erase(VehicleListIndexEntry(dep, index));
+	this->records.erase(it);
+}
+
+/**
+ * Remember that a vehicle has to be looked at again on the next use.
+ * @param index The vehicle.
+ */
+void VehicleListIndex::MarkDirty(VehicleID index)
+{
+	if (!this->valid) return;
+
+	/* When the indices are not used for a long time, building them anew becomes cheaper than updating them. */
+	if (this->dirty.size() >= Vehicle::GetNumItems()) {
+		InvalidateVehicleListIndex();
+		return;
+	}
+	this->dirty.push_back(index);
+}
+
+/** Build the reverse indices from all vehicles and orders. */
+void VehicleListIndex::Build()
+{
+	this->stations.clear();
+	this->depots.clear();
+	this->groups.clear();
+	this->records.clear();
+	this->dirty.clear();
+
+	/* Vehicles with shared orders share the order list, so each list is only looked at once. */
+	std::vector<StationID> stations;
+	std::vector<DepotID> depots;
+	const OrderList *ol;
+	FOR_ALL_ORDER_LISTS(ol) {
+		GetOrderDestinations(ol->GetFirstOrder(), stations, depots);
+		for (const Vehicle *u = ol->GetFirstSharedVehicle(); u != nullptr; u = u->NextShared()) {
+			if (!u->IsPrimaryVehicle()) continue;
+			VehicleListIndexRecord record = { u->group_id, stations, depots };
+			this->Add(u->index, record);
+		}
+	}
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (v->IsPrimaryVehicle() && !v->HasOrdersList()) {
+			VehicleListIndexRecord record = { v->group_id, {}, {} };
+			this->Add(v->index, record);
+		}
+	}
+	this->valid = true;
+}
+
+/** Bring the vehicles that changed since the last use up to date in the reverse indices. */
+void VehicleListIndex::Update()
+{
+	if (this->dirty.empty()) return;
+
+	std::sort(this->dirty.begin(), this->dirty.end());
+	this->dirty.erase(std::unique(this->dirty.begin(), this->dirty.end()), this->dirty.end());
+
+	/* Vehicles sharing orders are usually marked together; look at their orders only once. */
+	const Vehicle *last_first_shared = nullptr;
+	std::vector<StationID> stations;
+	std::vector<DepotID> depots;
+	for (VehicleID index : this->dirty) {
+		this->Remove(index);
+
+		const Vehicle *v = Vehicle::GetIfValid(index);
+		if (v == nullptr || !v->IsPrimaryVehicle()) continue;
+
+		const Vehicle *first_shared = v->HasOrdersList() ? v->FirstShared() : nullptr;
+		if (first_shared == nullptr || first_shared != last_first_shared) {
+			last_first_shared = first_shared;
+			GetOrderDestinations(v->GetFirstOrder(), stations, depots);
+		}
+		VehicleListIndexRecord record = { v->group_id, stations, depots };
+		this->Add(index, record);
+	}
+	this->dirty.clear();
+}
+
+/**
+ * Get the vehicles related to a station, depot or group.
+ * @param type VL_STATION_LIST, VL_DEPOT_LIST or VL_GROUP_LIST.
+ * @param key The station, depot or group; for groups, vehicles in subgroups of it are included.
+ * @param[out] list The vehicles, ordered by their index like a scan over all vehicles.
+ */
+static void FindVehiclesInIndex(VehicleListType type, uint32 key, std::vector<VehicleID> *list)
+{
+	if (_vehicle_list_index.valid) {
+		_vehicle_list_index.Update();
+	} else {
+		_vehicle_list_index.Build();
+	}
+
+	list->clear();
+	switch (type) {
+		case VL_STATION_LIST: VehicleListIndex::Find(_vehicle_list_index.stations, key, list); break;
+		case VL_DEPOT_LIST:   VehicleListIndex::Find(_vehicle_list_index.depots, key, list); break;
+
+		case VL_GROUP_LIST: {
+			VehicleListIndex::Find(_vehicle_list_index.groups, key, list);
+			const Group *g;
+			FOR_ALL_GROUPS(g) {
+				if (g->index != key && GroupIsInGroup(g->index, key)) VehicleListIndex::Find(_vehicle_list_index.groups, g->index, list);
+			}
+			std::sort(list->begin(), list->end());
+			break;
+		}
+
+		default: NOT_REACHED();
+	}
+}
+
 /**
  * Pack a VehicleListIdentifier in a single uint32.
  * @return The packed identifier.
@@ -119,7 +364,8 @@ bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &vli
 	list->Clear();
 
 	const Vehicle *v;
- 
+	std::vector<VehicleID> found;
+
 	auto fill_all_vehicles = [&]() {
 		FOR_ALL_VEHICLES(v) {
 			if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->type == vli.vtype && v->owner == vli.company && v->IsPrimaryVehicle()) {
@@ -130,18 +376,10 @@ bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &vli
 
 	switch (vli.type) {
 		case VL_STATION_LIST:
-			FOR_ALL_VEHICLES(v) {
-				if (v->type == vli.vtype && v->IsPrimaryVehicle()) {
-					const Order *order;
-
-					FOR_VEHICLE_ORDERS(v, order) {
-						if ((order->IsType(OT_GOTO_STATION) || order->IsType(OT_GOTO_WAYPOINT) || order->IsType(OT_IMPLICIT))
-								&& order->GetDestination() == vli.index) {
-							*list->Append() = v;
-							break;
-						}
-					}
-				}
+			FindVehiclesInIndex(VL_STATION_LIST, vli.index, &found);
+			for (VehicleID id : found) {
+				v = Vehicle::Get(id);
+				if (v->type == vli.vtype) *list->Append() = v;
 			}
 			break;
 
@@ -157,9 +395,10 @@ bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &vli
 
 		case VL_GROUP_LIST:
 			if (vli.index != ALL_GROUP) {
-				FOR_ALL_VEHICLES(v) {
-					if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->type == vli.vtype && v->IsPrimaryVehicle() &&
-							v->owner == vli.company && GroupIsInGroup(v->group_id, vli.index)) {
+				FindVehiclesInIndex(VL_GROUP_LIST, vli.index, &found);
+				for (VehicleID id : found) {
+					v = Vehicle::Get(id);
+					if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->type == vli.vtype && v->owner == vli.company) {
 						*list->Append() = v;
 					}
 				}
@@ -173,20 +412,13 @@ bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &vli
 			break;
 
 		case VL_DEPOT_LIST:
-			FOR_ALL_VEHICLES(v) {
-				if (v->type == vli.vtype && v->IsPrimaryVehicle()) {
-					const Order *order;
-
-					FOR_VEHICLE_ORDERS(v, order) {
-						if (order->IsType(OT_GOTO_DEPOT) && !(order->GetDepotActionType() & ODATFB_NEAREST_DEPOT) && order->GetDestination() == vli.index) {
-							*list->Append() = v;
-							break;
-						}
-					}
-				}
+			FindVehiclesInIndex(VL_DEPOT_LIST, vli.index, &found);
+			for (VehicleID id : found) {
+				v = Vehicle::Get(id);
+				if (v->type == vli.vtype) *list->Append() = v;
 			}
 			break;
- 
+
 		case VL_SLOT_LIST: {
 			if (vli.index == ALL_TRAINS_TRACE_RESTRICT_SLOT_ID) {
 				fill_all_vehicles();
@@ -16,6 +16,7 @@
 #include "vehicle_type.h"
 #include "company_type.h"
 #include "tile_type.h"
+#include "order_type.h"
 
 /** Vehicle List type flags */
 enum VehicleListType {
@@ -76,5 +77,8 @@ typedef SmallVector<const Vehicle *, 32> VehicleList;
 bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &identifier);
 void BuildDepotVehicleList(VehicleType type, TileIndex tile, VehicleList *engine_list, VehicleList *wagon_list, bool individual_wagons = false);
 uint GetUnitNumberDigits(VehicleList &vehicles);
+void InvalidateVehicleListIndex();
+void MarkVehicleListIndexDirty(const Vehicle *v);
+void MarkVehicleListIndexDirty(const OrderList *list);
 
 #endif /* VEHICLELIST_H */
@@ -108,6 +108,7 @@
 #include "tunnelbridge_map.h"
 #include "gui.h"
 #include "core/container_func.hpp"
+#include "screenshot.h"
 
 #include "table/strings.h"
 #include "table/string_colours.h"
@@ -2563,6 +2564,8 @@ void ViewportMapDraw(const ViewPort * const vp)
 
 void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
 {
+	UpdateDeferredVirtCoords();
+
 	DrawPixelInfo *old_dpi = _cur_dpi;
 	_cur_dpi = &_vd.dpi;
 
@@ -3025,6 +3028,8 @@ void ConstrainAllViewportsZoom()
  */
 void MarkTileDirtyByTile(const TileIndex tile, const ZoomLevel mark_dirty_if_zoomlevel_is_below, int bridge_level_offset)
 {
+	MarkMinimapExportDirty(tile);
+
 	Point pt = RemapCoords(TileX(tile) * TILE_SIZE, TileY(tile) * TILE_SIZE, TilePixelHeight(tile));
 	MarkAllViewportsDirty(
 		pt.x - MAX_TILE_EXTENT_LEFT,
@@ -3409,6 +3414,8 @@ bool HandleViewportDoubleClicked(Window *w, int x, int y)
 
 bool HandleViewportClicked(const ViewPort *vp, int x, int y, bool double_click)
 {
+	UpdateDeferredVirtCoords();
+
 	/* No click in smallmap mode except for plan making. */
 	if (vp->zoom >= ZOOM_LVL_DRAW_MAP && !(_thd.place_mode == HT_POINT && _thd.select_proc == DDSP_DRAW_PLANLINE)) return true;
 
@@ -3462,6 +3469,8 @@ void HandleViewportToolTip(Window *w, int x, int y)
 	const ViewportData *vp = w->viewport;
 	if (vp == nullptr || _game_mode == GM_MENU || HasModalProgress()) return;
 
+	UpdateDeferredVirtCoords();
+
 	TooltipCloseCondition close_cond = (_settings_client.gui.hover_delay_ms == 0) ? TCC_RIGHT_CLICK : TCC_HOVER;
 
 	const BaseStation *st;